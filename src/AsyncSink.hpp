@@ -0,0 +1,101 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "SpscQueue.hpp"
+
+/**
+ * @brief 异步批量写出
+ *
+ * 事件循环线程将记录放入SPSC队列后立即返回，后台线程定期醒来一次性写出队列中的所有记录，
+ * 磁盘变慢或日志轮转不会阻塞探测。队列满时丢弃新记录并计数。
+ */
+template <typename TRecord>
+class AsyncSink
+{
+public:
+    using WriterType = std::function<void(const TRecord&)>;
+
+    /**
+     * @brief 后台线程的唤醒周期
+     */
+    static const uint32_t kFlushIntervalMs = 100;
+
+public:
+    /**
+     * @param capacity 队列容量，必须为2的幂
+     * @param writer 在后台线程上调用的写出函数
+     */
+    AsyncSink(size_t capacity, const WriterType& writer)
+        : m_stQueue(capacity), m_stWriter(writer), m_stThread(&AsyncSink::ThreadMain, this) {}
+
+    AsyncSink(const AsyncSink&) = delete;
+    AsyncSink& operator=(const AsyncSink&) = delete;
+
+    ~AsyncSink()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_stMutex);
+            m_bStopping = true;
+        }
+        m_stCondition.notify_one();
+        m_stThread.join();
+    }
+
+public:
+    /**
+     * @brief 提交记录（仅生产者线程）
+     * @return 队列已满时丢弃并返回false
+     */
+    bool Push(const TRecord& record)noexcept
+    {
+        if (m_stQueue.TryPush(record))
+            return true;
+        ++m_ullDropCount;
+        return false;
+    }
+
+    /**
+     * @brief 获取队列深度（近似值）
+     */
+    size_t GetDepth()const noexcept { return m_stQueue.GetSize(); }
+
+    size_t GetCapacity()const noexcept { return m_stQueue.GetCapacity(); }
+
+    /**
+     * @brief 获取累计丢弃的记录数（仅生产者线程）
+     */
+    uint64_t GetDropCount()const noexcept { return m_ullDropCount; }
+
+private:
+    void ThreadMain()
+    {
+        TRecord record;
+        while (true)
+        {
+            while (m_stQueue.TryPop(record))
+                m_stWriter(record);
+
+            std::unique_lock<std::mutex> lock(m_stMutex);
+            if (m_bStopping)
+                break;
+            m_stCondition.wait_for(lock, std::chrono::milliseconds(static_cast<uint32_t>(kFlushIntervalMs)));
+        }
+
+        // 退出前写出剩余记录
+        while (m_stQueue.TryPop(record))
+            m_stWriter(record);
+    }
+
+private:
+    SpscQueue<TRecord> m_stQueue;
+    WriterType m_stWriter;
+    uint64_t m_ullDropCount = 0;
+
+    std::mutex m_stMutex;
+    std::condition_variable m_stCondition;
+    bool m_bStopping = false;
+    std::thread m_stThread;  // 最后初始化，线程启动时其他成员已构造完成
+};
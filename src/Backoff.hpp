@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <algorithm>
+
+#include <Moe.Core/Time.hpp>
+
+/**
+ * @brief 带抖动的指数退避
+ *
+ * 第n次重试的上限为min(maxDelay, minDelay * 2^n)，实际延迟在[上限/2, 上限]之间均匀分布，
+ * 大量客户端同时断线时重连会被打散，不会同时冲击服务端。
+ */
+class ReconnectBackoff
+{
+public:
+    ReconnectBackoff(moe::Time::Tick minDelay, moe::Time::Tick maxDelay)
+        : m_ullMinDelay(std::max<moe::Time::Tick>(minDelay, 1)), m_ullMaxDelay(std::max(maxDelay, m_ullMinDelay)) {}
+
+public:
+    uint32_t GetAttempts()const noexcept { return m_uAttempts; }
+
+    /**
+     * @brief 计算下一次重试的延迟
+     * @param random 均匀随机数发生器
+     */
+    template <typename TRandom>
+    moe::Time::Tick Next(TRandom& random)
+    {
+        auto cap = m_ullMaxDelay;
+        if (m_uAttempts < 32 && (m_ullMinDelay << m_uAttempts) < m_ullMaxDelay)
+            cap = m_ullMinDelay << m_uAttempts;
+        ++m_uAttempts;
+        return cap - cap / 2 + static_cast<moe::Time::Tick>(random()) % (cap / 2 + 1);
+    }
+
+    void Reset()noexcept
+    {
+        m_uAttempts = 0;
+    }
+
+private:
+    const moe::Time::Tick m_ullMinDelay;
+    const moe::Time::Tick m_ullMaxDelay;
+    uint32_t m_uAttempts = 0;
+};
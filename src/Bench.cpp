@@ -0,0 +1,1127 @@
+#include <Moe.Core/Logging.hpp>
+#include <Moe.Core/CmdParser.hpp>
+#include <Moe.Core/Mdr.hpp>
+
+#include <Moe.UV/Timer.hpp>
+#include <Moe.UV/RunLoop.hpp>
+#include <Moe.UV/TcpSocket.hpp>
+#include <Moe.UV/UdpSocket.hpp>
+
+#include <new>
+#include <atomic>
+#include <thread>
+#include <cstdlib>
+
+#include "SocketUtils.hpp"
+#include "HiResClock.hpp"
+#include "Histogram.hpp"
+#include "TcpFraming.hpp"
+#include "PingPacket.hpp"
+#include "Pinger.hpp"
+#include "TimerWheel.hpp"
+#include "IntrusiveList.hpp"
+#include "SlabAllocator.hpp"
+#include "UdpRing.hpp"
+
+using namespace std;
+using namespace moe;
+using namespace UV;
+
+struct Configure
+{
+    std::string Mode;
+    std::string ServerAddr;
+    uint16_t ServerPort;
+    uint32_t Concurrency;
+    uint32_t Duration;
+    uint32_t Threads;
+    uint32_t Sockets;
+    uint32_t Rate;
+    uint32_t RateStep;
+    uint32_t Steps;
+    uint32_t TcpInterval;
+    uint32_t Iterations;
+    uint32_t Repeat;
+    std::string Filter;
+};
+
+//////////////////////////////////////////////////////////////////////////////// AllocCounter
+
+// 统计本进程的堆分配次数，供微基准计算allocs/op
+static std::atomic<uint64_t> g_ullAllocCount { 0 };
+
+void* operator new(size_t size)
+{
+    g_ullAllocCount.fetch_add(1, memory_order_relaxed);
+    auto p = ::malloc(size == 0 ? 1 : size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p)noexcept
+{
+    ::free(p);
+}
+
+//////////////////////////////////////////////////////////////////////////////// ChurnBench
+
+/**
+ * @brief 连接抖动测试
+ *
+ * 维持Concurrency个并发连接，每个连接建立后发送一个字节，收到回射即关闭并立即重连，
+ * 用于测量PingServer每秒可以接受并释放的会话数。出错的连接等待kRetryDelay后再重连，避免服务端不可用时空转。
+ */
+class ChurnBench
+{
+    static const Time::Tick kTickInterval = 100;
+    static const Time::Tick kReportInterval = 1000;
+    static const Time::Tick kRetryDelay = 100;
+
+    struct Connection
+    {
+        ChurnBench* Owner = nullptr;
+        TcpSocket Socket;
+        uint64_t StartTime = 0;  // HiResClock::Now()
+        Time::Tick RetryTime = 0;  // 非0时等待到该时间后重连
+    };
+
+public:
+    ChurnBench(const Configure& cfg)
+        : m_stConfig(cfg), m_stServerEndPoint(cfg.ServerAddr, cfg.ServerPort), m_stRunLoop(m_stObjectPool),
+        m_stTimer(Timer::CreateTickTimer(kTickInterval)), m_stConnections(cfg.Concurrency)
+    {
+        m_stTimer.SetOnTimeCallback(bind(&ChurnBench::OnTick, this));
+    }
+
+public:
+    void Run()
+    {
+        m_ullStartTime = m_ullLastReportTime = RunLoop::Now();
+        for (auto& conn : m_stConnections)
+        {
+            conn.Owner = this;
+            Reconnect(conn);
+        }
+
+        m_stTimer.Start();
+        m_stRunLoop.Run();
+    }
+
+protected:
+    void Reconnect(Connection& conn)
+    {
+        conn.Socket = TcpSocket::Create();
+        conn.Socket.SetOnConnectCallback(bind(&ChurnBench::OnConnected, this, std::ref(conn), placeholders::_1));
+        conn.Socket.SetOnErrorCallback(bind(&ChurnBench::OnError, this, std::ref(conn), placeholders::_1));
+        conn.Socket.SetOnDataCallback(bind(&ChurnBench::OnData, this, std::ref(conn), placeholders::_1));
+        conn.Socket.SetOnEofCallback(bind(&ChurnBench::OnError, this, std::ref(conn), 0));
+
+        conn.RetryTime = 0;
+        conn.StartTime = HiResClock::Now();
+        conn.Socket.Connect(m_stServerEndPoint);
+    }
+
+    void OnConnected(Connection& conn, int err)
+    {
+        if (err != 0)
+        {
+            OnError(conn, err);
+            return;
+        }
+
+        auto latency = HiResClock::Now() - conn.StartTime;
+        ++m_ullConnects;
+        m_ullConnectLatencyTotal += latency;
+        m_ullMaxConnectLatency = std::max(m_ullMaxConnectLatency, latency);
+
+        static const uint8_t kProbe = 0;
+        conn.Socket.StartRead();
+        conn.Socket.Write(BytesView(&kProbe, 1));
+    }
+
+    void OnData(Connection& conn, BytesView)
+    {
+        ++m_ullCycles;
+        conn.Socket.Close();
+        Reconnect(conn);
+    }
+
+    void OnError(Connection& conn, int)
+    {
+        ++m_ullErrors;
+        conn.Socket.Close();
+        conn.RetryTime = RunLoop::Now() + kRetryDelay;
+    }
+
+    void OnTick()
+    {
+        auto now = RunLoop::Now();
+        for (auto& conn : m_stConnections)
+        {
+            if (conn.RetryTime != 0 && now >= conn.RetryTime)
+                Reconnect(conn);
+        }
+        if (now - m_ullLastReportTime < kReportInterval)
+            return;
+
+        auto seconds = (now - m_ullLastReportTime) / 1000.;
+        MOE_LOG_INFO("Churn {0:F1} sessions/s, errors {1}", (m_ullCycles - m_ullLastCycles) / seconds, m_ullErrors);
+        m_ullLastReportTime = now;
+        m_ullLastCycles = m_ullCycles;
+
+        if (now - m_ullStartTime >= m_stConfig.Duration * 1000ull)
+        {
+            auto total = (now - m_ullStartTime) / 1000.;
+            MOE_LOG_INFO("Churn summary: {0} sessions in {1:F1}s ({2:F1} sessions/s), errors {3}, connect avg {4:F3}ms, "
+                "max {5:F3}ms", m_ullCycles, total, m_ullCycles / total, m_ullErrors,
+                m_ullConnects == 0 ? 0. : m_ullConnectLatencyTotal / 1000000. / m_ullConnects, m_ullMaxConnectLatency / 1000000.);
+            m_stRunLoop.Stop();
+        }
+    }
+
+private:
+    Configure m_stConfig;
+    EndPoint m_stServerEndPoint;
+
+    ObjectPool m_stObjectPool;
+    RunLoop m_stRunLoop;
+    Timer m_stTimer;
+    std::vector<Connection> m_stConnections;
+
+    Time::Tick m_ullStartTime = 0;
+    Time::Tick m_ullLastReportTime = 0;
+    uint64_t m_ullCycles = 0;  // 完成的连接-回射-关闭次数
+    uint64_t m_ullLastCycles = 0;
+    uint64_t m_ullErrors = 0;
+    uint64_t m_ullConnects = 0;  // 成功的建连次数，包括之后出错的
+    uint64_t m_ullConnectLatencyTotal = 0;  // 纳秒
+    uint64_t m_ullMaxConnectLatency = 0;
+};
+
+//////////////////////////////////////////////////////////////////////////////// LoadBench
+
+/**
+ * @brief 单个负载档位的结果
+ */
+struct LoadStepResult
+{
+    uint64_t Sent = 0;
+    uint64_t Received = 0;
+    LatencyHistogram Latency;  // 微秒
+
+    void Merge(const LoadStepResult& rhs)noexcept
+    {
+        Sent += rhs.Sent;
+        Received += rhs.Received;
+        Latency.Merge(rhs.Latency);
+    }
+};
+
+/**
+ * @brief 负载生成线程
+ *
+ * 每个线程持有独立的RunLoop、若干UDP socket（不同源端口，便于服务端按REUSEPORT分散）和一部分TCP会话。
+ * 所有线程按共同的起始时间推算当前档位，无需同步；探测包的TargetId记录发送时的档位，回包按此归属。
+ * 结果只由本线程写入，线程退出后由主线程汇总。
+ */
+class LoadWorker
+{
+    static const uint64_t kGraceTimeNs = 1000000000ull;  // 最后一档结束后继续接收回包的时间
+
+    struct Session
+    {
+        TcpSocket Socket;
+        TcpFraming::Decoder Decoder;
+        bool Connected = false;
+        Time::Tick NextConnectTime = 0;
+    };
+
+public:
+    enum
+    {
+        CHANNEL_UDP = 0,
+        CHANNEL_TCP = 1,
+        CHANNEL_COUNT = 2,
+    };
+
+public:
+    /**
+     * @param index 线程编号
+     * @param startTime 第一档开始的时间（HiResClock::Now()）
+     * @param results 输出，按[档位][通道]排列
+     *
+     * 必须在运行该线程的线程上构造。
+     */
+    LoadWorker(const Configure& cfg, uint32_t index, uint64_t startTime, std::vector<LoadStepResult>& results)
+        : m_stConfig(cfg), m_stServerEndPoint(cfg.ServerAddr, cfg.ServerPort), m_ullStartTime(startTime),
+        m_stResults(results), m_stRunLoop(m_stObjectPool), m_stTimer(Timer::CreateTickTimer(1))
+    {
+        m_stTimer.SetOnTimeCallback(bind(&LoadWorker::OnTick, this));
+        m_stResults.resize(cfg.Steps * CHANNEL_COUNT);
+
+        m_stUdpSockets.reserve(cfg.Sockets);
+        for (uint32_t i = 0; i < cfg.Sockets; ++i)
+        {
+            m_stUdpSockets.emplace_back(UdpSocket::Create());
+            m_stUdpSockets.back().SetOnDataCallback(bind(&LoadWorker::OnUdpData, this, placeholders::_2));
+            m_stUdpSockets.back().SetOnErrorCallback(bind(&LoadWorker::OnError, this, placeholders::_1));
+        }
+
+        // TCP会话均分到各线程
+        auto sessions = cfg.Concurrency / cfg.Threads + (index < cfg.Concurrency % cfg.Threads ? 1 : 0);
+        m_stSessions.resize(sessions);
+    }
+
+public:
+    void Run()
+    {
+        static const uint8_t kHello = 0;
+
+        // 先发一个字节使socket绑定，之后才能开始接收
+        for (auto& socket : m_stUdpSockets)
+        {
+            socket.Send(m_stServerEndPoint, BytesView(&kHello, 1));
+            socket.StartRead();
+        }
+        for (auto& session : m_stSessions)
+            Connect(session);
+
+        m_stTimer.Start();
+        m_stRunLoop.Run();
+    }
+
+    uint64_t GetErrorCount()const noexcept { return m_ullErrors; }
+
+protected:
+    void Connect(Session& session)
+    {
+        session.Socket = TcpSocket::Create();
+        session.Decoder.Reset();
+        session.Connected = false;
+        session.Socket.SetOnConnectCallback(bind(&LoadWorker::OnTcpConnected, this, std::ref(session), placeholders::_1));
+        session.Socket.SetOnErrorCallback(bind(&LoadWorker::OnTcpError, this, std::ref(session)));
+        session.Socket.SetOnEofCallback(bind(&LoadWorker::OnTcpError, this, std::ref(session)));
+        session.Socket.SetOnDataCallback(bind(&LoadWorker::OnTcpData, this, std::ref(session), placeholders::_1));
+        session.Socket.Connect(m_stServerEndPoint);
+    }
+
+    void OnTick()
+    {
+        auto now = HiResClock::Now();
+        if (now < m_ullStartTime)
+            return;
+
+        auto stepDuration = m_stConfig.Duration * 1000000000ull;
+        auto elapsed = now - m_ullStartTime;
+        auto step = elapsed / stepDuration;
+        if (step >= m_stConfig.Steps)
+        {
+            if (elapsed >= m_stConfig.Steps * stepDuration + kGraceTimeNs)
+                m_stRunLoop.Stop();
+            return;
+        }
+
+        if (step != m_ullCurrentStep)
+        {
+            m_ullCurrentStep = step;
+            m_ullStepUdpSent = 0;
+            m_ullStepTcpSent = 0;
+        }
+
+        // 按档位开始以来应发的包数补齐，定时器抖动不影响平均速率
+        auto stepElapsed = elapsed - step * stepDuration;
+        auto udpRate = (m_stConfig.Rate + step * m_stConfig.RateStep) / static_cast<double>(m_stConfig.Threads);
+        auto udpExpected = static_cast<uint64_t>(udpRate * stepElapsed / 1e9);
+        while (m_ullStepUdpSent < udpExpected && !m_stUdpSockets.empty())
+        {
+            auto& socket = m_stUdpSockets[m_ullStepUdpSent % m_stUdpSockets.size()];
+            socket.Send(m_stServerEndPoint, EncodeProbe(static_cast<uint32_t>(step), HiResClock::Now()));
+            ++m_ullStepUdpSent;
+            ++m_stResults[step * CHANNEL_COUNT + CHANNEL_UDP].Sent;
+        }
+
+        // 每个会话每TcpInterval毫秒一个探测，在已连接的会话间轮转
+        auto tcpRate = m_stSessions.size() * 1000. / std::max(m_stConfig.TcpInterval, 1u);
+        auto tcpExpected = static_cast<uint64_t>(tcpRate * stepElapsed / 1e9);
+        auto tick = RunLoop::Now();
+        for (size_t tries = 0; m_ullStepTcpSent < tcpExpected && tries < m_stSessions.size(); ++tries)
+        {
+            auto& session = m_stSessions[m_uNextSession++ % m_stSessions.size()];
+            if (!session.Connected)
+            {
+                if (session.NextConnectTime != 0 && tick >= session.NextConnectTime)
+                {
+                    session.NextConnectTime = 0;
+                    Connect(session);
+                }
+                continue;
+            }
+
+            tries = 0;
+            auto payload = EncodeProbe(static_cast<uint32_t>(step), HiResClock::Now());
+            m_stFrameBuffer.clear();
+            TcpFraming::AppendFrame(m_stFrameBuffer, payload.GetBuffer(), payload.GetSize());
+            session.Socket.Write(ToArrayView<uint8_t>(m_stFrameBuffer));
+            ++m_ullStepTcpSent;
+            ++m_stResults[step * CHANNEL_COUNT + CHANNEL_TCP].Sent;
+        }
+    }
+
+    BytesView EncodeProbe(uint32_t step, uint64_t now)noexcept
+    {
+        PingPacket packet {};
+        packet.Seq = m_uSeq++;
+        packet.SendTimeNs = now;
+        packet.TargetId = step;
+        return BytesView(m_stPacketBuffer, PingPacketCodec::Encode(packet, m_stPacketBuffer));
+    }
+
+    void RecordReply(int channel, BytesView data, uint64_t now)noexcept
+    {
+        PingPacket packet {};
+        if (PingPacketCodec::Decode(data.GetBuffer(), data.GetSize(), packet) != PingPacketCodec::DecodeResult::Ok)
+            return;
+        if (packet.TargetId >= m_stConfig.Steps || packet.SendTimeNs > now)
+            return;
+
+        auto& result = m_stResults[packet.TargetId * CHANNEL_COUNT + channel];
+        ++result.Received;
+        result.Latency.Record((now - packet.SendTimeNs) / 1000);
+    }
+
+    void OnUdpData(BytesView data)
+    {
+        RecordReply(CHANNEL_UDP, data, HiResClock::Now());
+    }
+
+    void OnError(int)
+    {
+        ++m_ullErrors;
+    }
+
+    void OnTcpConnected(Session& session, int err)
+    {
+        if (err != 0)
+        {
+            OnTcpError(session);
+            return;
+        }
+        session.Connected = true;
+        session.Socket.SetNoDelay(true);
+        session.Socket.StartRead();
+    }
+
+    void OnTcpError(Session& session)
+    {
+        ++m_ullErrors;
+        session.Connected = false;
+        session.Socket.Close();
+        session.NextConnectTime = RunLoop::Now() + 1000;
+    }
+
+    void OnTcpData(Session& session, BytesView data)
+    {
+        auto now = HiResClock::Now();
+        auto ok = session.Decoder.Feed(data, [&](BytesView payload) { RecordReply(CHANNEL_TCP, payload, now); });
+        if (!ok)
+            OnTcpError(session);
+    }
+
+private:
+    const Configure& m_stConfig;
+    EndPoint m_stServerEndPoint;
+    const uint64_t m_ullStartTime;
+    std::vector<LoadStepResult>& m_stResults;
+
+    ObjectPool m_stObjectPool;
+    RunLoop m_stRunLoop;
+    Timer m_stTimer;
+    std::vector<UdpSocket> m_stUdpSockets;
+    std::vector<Session> m_stSessions;
+
+    uint8_t m_stPacketBuffer[PingPacketCodec::kMaxSize];
+    std::vector<uint8_t> m_stFrameBuffer;
+    uint32_t m_uSeq = 0;
+    uint64_t m_ullCurrentStep = UINT64_MAX;
+    uint64_t m_ullStepUdpSent = 0;
+    uint64_t m_ullStepTcpSent = 0;
+    size_t m_uNextSession = 0;
+    uint64_t m_ullErrors = 0;
+};
+
+/**
+ * @brief 阶梯负载测试
+ *
+ * UDP速率从Rate开始每档增加RateStep，每档持续Duration秒，同时维持Concurrency个TCP会话。
+ * 输出每档的实际吞吐和时延分位数，并给出服务端饱和的拐点：
+ * 丢包率超过kKneeLossRate，或p99超过第一档的kKneeLatencyFactor倍。
+ */
+class LoadBench
+{
+    static constexpr double kKneeLossRate = 0.01;
+    static constexpr double kKneeLatencyFactor = 2.;
+    static const uint64_t kStartDelayNs = 500000000ull;  // 留给各线程建立连接
+
+public:
+    LoadBench(const Configure& cfg)
+        : m_stConfig(cfg)
+    {
+        if (cfg.Threads == 0 || cfg.Steps == 0 || cfg.Duration == 0)
+            MOE_THROW(BadArgumentException, "Threads, steps and duration must be greater than 0");
+    }
+
+public:
+    void Run()
+    {
+        MOE_LOG_INFO("Load {0} step(s) of {1}s, UDP {2} pps +{3} per step over {4} thread(s) x {5} socket(s), "
+            "TCP {6} session(s) every {7}ms", m_stConfig.Steps, m_stConfig.Duration, m_stConfig.Rate, m_stConfig.RateStep,
+            m_stConfig.Threads, m_stConfig.Sockets, m_stConfig.Concurrency, m_stConfig.TcpInterval);
+
+        auto startTime = HiResClock::Now() + kStartDelayNs;
+        std::vector<std::vector<LoadStepResult>> results(m_stConfig.Threads);
+        std::vector<uint64_t> errors(m_stConfig.Threads);
+        std::vector<std::thread> threads;
+        for (uint32_t i = 0; i < m_stConfig.Threads; ++i)
+        {
+            threads.emplace_back([&, i]() {
+                try
+                {
+                    LoadWorker worker(m_stConfig, i, startTime, results[i]);
+                    worker.Run();
+                    errors[i] = worker.GetErrorCount();
+                }
+                catch (const ExceptionBase& ex)
+                {
+                    MOE_LOG_EXCEPTION(ex);
+                    MOE_LOG_FATAL("Load thread {0} exited unexpectedly", i);
+                    ::abort();
+                }
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+
+        std::vector<LoadStepResult> total(m_stConfig.Steps * LoadWorker::CHANNEL_COUNT);
+        for (const auto& result : results)
+        {
+            for (size_t i = 0; i < result.size(); ++i)
+                total[i].Merge(result[i]);
+        }
+
+        uint64_t errorCount = 0;
+        for (auto count : errors)
+            errorCount += count;
+        Report(total, errorCount);
+    }
+
+protected:
+    void Report(const std::vector<LoadStepResult>& results, uint64_t errors)
+    {
+        auto seconds = static_cast<double>(m_stConfig.Duration);
+        uint64_t baseline = 0;
+        int knee = -1;
+        const char* kneeReason = nullptr;
+        for (uint32_t step = 0; step < m_stConfig.Steps; ++step)
+        {
+            const auto& udp = results[step * LoadWorker::CHANNEL_COUNT + LoadWorker::CHANNEL_UDP];
+            const auto& tcp = results[step * LoadWorker::CHANNEL_COUNT + LoadWorker::CHANNEL_TCP];
+            auto loss = udp.Sent == 0 ? 0. : 1. - static_cast<double>(std::min(udp.Received, udp.Sent)) / udp.Sent;
+            auto p99 = udp.Latency.GetPercentile(99);
+
+            MOE_LOG_INFO("Step {0}: target {1} pps, sent {2:F0}/s, received {3:F0}/s, loss {4:F2}%, p50 {5}us, p90 {6}us, "
+                "p99 {7}us, p99.9 {8}us, max {9}us; TCP received {10:F0}/s, p50 {11}us, p99 {12}us", step,
+                m_stConfig.Rate + step * m_stConfig.RateStep, udp.Sent / seconds, udp.Received / seconds, loss * 100.,
+                udp.Latency.GetPercentile(50), udp.Latency.GetPercentile(90), p99, udp.Latency.GetPercentile(99.9),
+                udp.Latency.GetMax(), tcp.Received / seconds, tcp.Latency.GetPercentile(50), tcp.Latency.GetPercentile(99));
+
+            if (step == 0)
+                baseline = std::max<uint64_t>(p99, 1);
+            if (knee < 0 && udp.Sent > 0)
+            {
+                if (loss > kKneeLossRate)
+                    kneeReason = "loss";
+                else if (p99 > baseline * kKneeLatencyFactor)
+                    kneeReason = "p99 latency";
+                if (kneeReason)
+                    knee = static_cast<int>(step);
+            }
+        }
+
+        if (knee < 0)
+        {
+            MOE_LOG_INFO("No saturation up to {0} pps, errors {1}", m_stConfig.Rate + (m_stConfig.Steps - 1) * m_stConfig.RateStep,
+                errors);
+        }
+        else
+        {
+            MOE_LOG_INFO("Knee at step {0} ({1} pps) by {2}, last healthy rate {3}, errors {4}", knee,
+                m_stConfig.Rate + knee * m_stConfig.RateStep, kneeReason,
+                knee == 0 ? string("none") : StringUtils::Format("{0} pps", m_stConfig.Rate + (knee - 1) * m_stConfig.RateStep),
+                errors);
+        }
+    }
+
+private:
+    Configure m_stConfig;
+};
+
+//////////////////////////////////////////////////////////////////////////////// MicroBench
+
+/**
+ * @brief 热路径微基准
+ *
+ * 每个用例先预热一轮，再重复Repeat轮，输出最好和中位的ns/op以及allocs/op。
+ * 每轮先在计时之外构造被测对象（Setup），只对返回的Body计时和统计分配。
+ * 输入由固定种子生成，同一机器上的结果可以直接比较。
+ */
+class MicroBench
+{
+    /**
+     * @brief 用例，参数为建议的迭代次数，返回实际执行的操作数
+     */
+    using CaseType = std::function<uint64_t(uint64_t iterations)>;
+
+    /**
+     * @brief 构造被测对象并返回持有它的用例，不计入耗时和分配
+     */
+    using SetupType = std::function<CaseType()>;
+
+    struct Case
+    {
+        std::string Name;
+        SetupType Setup;
+    };
+
+    /**
+     * @brief 模拟PingServer的TCP会话
+     */
+    struct Session :
+        public TimerWheelNode,
+        public IntrusiveListNode
+    {
+        Time::Tick LastAlive = 0;
+    };
+
+    static const Time::Tick kIdleTimeout = 60 * 1000;
+
+#ifdef __linux__
+    static const size_t kEchoBatch = 32;
+    static const size_t kEchoPayloadSize = 64;
+    static const uint64_t kMaxEchoSpins = 1000000;  // 单批等待上限，防止回环丢包时卡死
+
+    /**
+     * @brief 回环上的一对UDP socket
+     */
+    struct EchoSockets
+    {
+        int Server = -1;
+        int Client = -1;
+        sockaddr_storage ServerAddr;
+        socklen_t ServerAddrLength = sizeof(sockaddr_storage);
+
+        EchoSockets()
+        {
+            Server = SocketUtils::CreateBoundSocket(SOCK_DGRAM, "127.0.0.1", 0, false);
+            Client = SocketUtils::CreateBoundSocket(SOCK_DGRAM, "127.0.0.1", 0, false);
+            ::getsockname(Server, reinterpret_cast<sockaddr*>(&ServerAddr), &ServerAddrLength);
+        }
+
+        ~EchoSockets()
+        {
+            ::close(Server);
+            ::close(Client);
+        }
+    };
+#endif
+
+public:
+    MicroBench(const Configure& cfg)
+        : m_stConfig(cfg)
+    {
+        AddSetupCase("pinger.record", SetupPingerRecord);
+        AddCase("codec.binary.encode", BenchBinaryEncode);
+        AddCase("codec.binary.decode", BenchBinaryDecode);
+        AddCase("codec.mdr.encode", BenchMdrEncode);
+        AddCase("codec.mdr.decode", BenchMdrDecode);
+        AddCase("window.advance", BenchWindowAdvance);
+        for (size_t sessions : { 1000u, 10000u, 100000u })
+        {
+            AddSetupCase(StringUtils::Format("session.reap/{0}", sessions), bind(&MicroBench::SetupSessionReap, sessions));
+        }
+#ifdef __linux__
+        AddSetupCase("udp.echo/syscall", SetupUdpEchoSyscall);
+#endif
+#ifdef HAVE_IO_URING
+        if (UdpRing::IsSupported())
+            AddSetupCase("udp.echo/io_uring", SetupUdpEchoRing);
+#endif
+    }
+
+public:
+    void Run()
+    {
+        for (const auto& c : m_stCases)
+        {
+            if (!m_stConfig.Filter.empty() && c.Name.find(m_stConfig.Filter) == string::npos)
+                continue;
+
+            c.Setup()(std::max<uint64_t>(m_stConfig.Iterations / 10, 1));
+
+            std::vector<double> samples;
+            double allocs = 0;
+            uint64_t ops = 0;
+            for (uint32_t i = 0; i < std::max(m_stConfig.Repeat, 1u); ++i)
+            {
+                // 被测对象在计时之后才析构
+                auto body = c.Setup();
+                auto allocStart = g_ullAllocCount.load(memory_order_relaxed);
+                auto start = HiResClock::Now();
+                ops = body(m_stConfig.Iterations);
+                auto elapsed = HiResClock::Now() - start;
+                auto allocCount = g_ullAllocCount.load(memory_order_relaxed) - allocStart;
+
+                ops = std::max<uint64_t>(ops, 1);
+                samples.push_back(static_cast<double>(elapsed) / ops);
+                allocs = static_cast<double>(allocCount) / ops;
+            }
+            std::sort(samples.begin(), samples.end());
+
+            MOE_LOG_INFO("{0}: best {1:F1} ns/op, median {2:F1} ns/op, {3:F3} allocs/op, {4} ops x {5}", c.Name, samples.front(),
+                samples[samples.size() / 2], allocs, ops, samples.size());
+        }
+    }
+
+protected:
+    void AddCase(const std::string& name, const CaseType& body)
+    {
+        m_stCases.push_back(Case { name, [body]() { return body; } });
+    }
+
+    void AddSetupCase(const std::string& name, const SetupType& setup)
+    {
+        m_stCases.push_back(Case { name, setup });
+    }
+
+    /**
+     * @brief 防止编译器消除被测代码
+     */
+    template <typename T>
+    static void DoNotOptimize(const T& value)noexcept
+    {
+        static volatile uint64_t s_ullSink = 0;
+        s_ullSink = s_ullSink + static_cast<uint64_t>(value);
+    }
+
+    static PingPacket MakePacket(uint32_t seq)noexcept
+    {
+        PingPacket packet {};
+        packet.Seq = seq;
+        packet.SendTime = 1000000 + seq;
+        packet.SendTimeNs = 1000000000000ull + seq * 1000000ull;
+        packet.TargetId = seq % 1024;
+        return packet;
+    }
+
+    /**
+     * @brief 一次发包加一次回包，1%的探测丢失
+     */
+    static CaseType SetupPingerRecord()
+    {
+        static const std::vector<uint32_t> kWindows { 10 * 1000, 60 * 1000, 300 * 1000 };
+        auto pinger = std::make_shared<Pinger>(1000, 1000, true, kWindows);
+
+        return [pinger](uint64_t iterations) {
+            uint64_t now = 1000000000000ull;
+            for (uint64_t i = 0; i < iterations; ++i)
+            {
+                now += 1000000;
+                auto packet = pinger->Send(now / 1000000, now);
+                if (i % 100 != 0)
+                    pinger->Recv(packet, now / 1000000, now + 50000 + (i % 7) * 1000);
+            }
+            DoNotOptimize(pinger->GetStatistic().AvailablePacket);
+            return iterations;
+        };
+    }
+
+    static uint64_t BenchBinaryEncode(uint64_t iterations)
+    {
+        uint8_t buffer[PingPacketCodec::kMaxSize];
+        uint64_t total = 0;
+        for (uint64_t i = 0; i < iterations; ++i)
+            total += PingPacketCodec::Encode(MakePacket(static_cast<uint32_t>(i)), buffer, (i & 1) != 0);
+        DoNotOptimize(total);
+        return iterations;
+    }
+
+    static uint64_t BenchBinaryDecode(uint64_t iterations)
+    {
+        uint8_t buffer[PingPacketCodec::kMaxSize];
+        auto length = PingPacketCodec::Encode(MakePacket(1), buffer, true);
+
+        uint64_t total = 0;
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            PingPacket packet;
+            PingPacketCodec::Decode(buffer, length, packet);
+            total += packet.Seq;
+        }
+        DoNotOptimize(total);
+        return iterations;
+    }
+
+    static uint64_t BenchMdrEncode(uint64_t iterations)
+    {
+        std::vector<uint8_t> buffer;
+        uint64_t total = 0;
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            buffer.clear();
+            Mdr::WriteStruct(MakePacket(static_cast<uint32_t>(i)), buffer);
+            total += buffer.size();
+        }
+        DoNotOptimize(total);
+        return iterations;
+    }
+
+    static uint64_t BenchMdrDecode(uint64_t iterations)
+    {
+        std::vector<uint8_t> buffer;
+        Mdr::WriteStruct(MakePacket(1), buffer);
+
+        uint64_t total = 0;
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            PingPacket packet;
+            Mdr::ReadStruct(packet, ToArrayView<uint8_t>(buffer));
+            total += packet.Seq;
+        }
+        DoNotOptimize(total);
+        return iterations;
+    }
+
+    /**
+     * @brief 在途窗口的稳态推进：入队、确认并淘汰超时的槽位，同时推进滑动窗口
+     */
+    static uint64_t BenchWindowAdvance(uint64_t iterations)
+    {
+        static const uint64_t kInterval = 1000000;  // 1ms
+        static const uint64_t kTimeout = 1000000000;  // 1s
+        PingWindow window(PingWindow::GetCapacityFor(kTimeout / 1000, kInterval / 1000), kTimeout);
+        SlidingWindow sliding(10 * 1000);
+
+        uint64_t now = 0;
+        uint64_t lost = 0;
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            now += kInterval;
+            lost += window.Expire(now);
+            auto seq = window.GetNextSeq();
+            lost += window.Push(now);
+            if (i % 100 != 0)
+                window.Ack(seq);
+            sliding.RecordLatency(now / 1000000, static_cast<uint32_t>(i % 1000));
+        }
+        DoNotOptimize(lost + sliding.GetStatistic(now / 1000000).Received);
+        return iterations;
+    }
+
+    /**
+     * @brief 空闲会话回收的状态，在计时之前构造并填满count个会话
+     */
+    struct SessionReapState
+    {
+        SlabAllocator<Session> Allocator;
+        IntrusiveList<Session> Sessions;
+        TimerWheel Wheel { 1000, 512, 0 };
+        uint64_t Seed = 88172645463325252ull;
+        Time::Tick Now = kIdleTimeout;
+
+        uint64_t Random()noexcept
+        {
+            Seed ^= Seed << 13;
+            Seed ^= Seed >> 7;
+            Seed ^= Seed << 17;
+            return Seed;
+        }
+
+        void Spawn(Time::Tick lastAlive)
+        {
+            auto session = Allocator.New();
+            session->LastAlive = lastAlive;
+            Sessions.PushBack(session);
+            Wheel.Schedule(session, lastAlive + kIdleTimeout);
+        }
+    };
+
+    /**
+     * @brief 空闲会话回收，与Worker::OnTick相同的时间轮用法
+     *
+     * 每秒推进一次，到期的会话中一半仍然活跃而被重新调度，另一半被回收并由新会话替换，会话总数不变。
+     * 操作数为推进的次数。
+     */
+    static CaseType SetupSessionReap(size_t count)
+    {
+        auto state = std::make_shared<SessionReapState>();
+        for (size_t i = 0; i < count; ++i)
+            state->Spawn(state->Random() % kIdleTimeout);
+
+        return [state](uint64_t iterations) {
+            auto& st = *state;
+            auto ticks = std::max<uint64_t>(iterations / 1000, 100);
+            uint64_t reaped = 0;
+            for (uint64_t i = 0; i < ticks; ++i)
+            {
+                st.Now += 1000;
+                size_t replace = 0;
+                st.Wheel.Advance(st.Now, [&](TimerWheelNode* node) {
+                    auto session = static_cast<Session*>(node);
+                    if (st.Random() & 1)
+                    {
+                        session->LastAlive = st.Now - st.Random() % 1000;
+                        st.Wheel.Schedule(session, session->LastAlive + kIdleTimeout);
+                        return;
+                    }
+                    st.Sessions.Remove(session);
+                    st.Allocator.Delete(session);
+                    ++replace;
+                });
+                for (size_t j = 0; j < replace; ++j)
+                    st.Spawn(st.Now);
+                reaped += replace;
+            }
+            DoNotOptimize(reaped + st.Sessions.GetSize());
+            return ticks;
+        };
+    }
+
+#ifdef __linux__
+    /**
+     * @brief 回环UDP回射，每个数据报一次sendto/recvfrom，对应PingServer的libuv路径
+     *
+     * 每批发出kEchoBatch个数据报后忙等全部回射，操作数为完成往返的数据报数。
+     */
+    static CaseType SetupUdpEchoSyscall()
+    {
+        auto sockets = std::make_shared<EchoSockets>();
+        return [sockets](uint64_t iterations) {
+            uint8_t payload[kEchoPayloadSize] = {};
+            uint8_t buffer[2048];
+
+            // 每个数据报的成本比其他用例高两到三个数量级，按十分之一的迭代次数执行
+            auto datagrams = std::max<uint64_t>(iterations / 10, kEchoBatch);
+            uint64_t echoed = 0;
+            for (uint64_t i = 0; i < datagrams; i += kEchoBatch)
+            {
+                for (size_t j = 0; j < kEchoBatch; ++j)
+                {
+                    ::sendto(sockets->Client, payload, sizeof(payload), 0, reinterpret_cast<sockaddr*>(&sockets->ServerAddr),
+                        sockets->ServerAddrLength);
+                }
+
+                size_t received = 0;
+                for (uint64_t spin = 0; received < kEchoBatch && spin < kMaxEchoSpins; ++spin)
+                {
+                    sockaddr_storage from;
+                    socklen_t fromLength = sizeof(from);
+                    auto length = ::recvfrom(sockets->Server, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr*>(&from),
+                        &fromLength);
+                    if (length > 0)
+                    {
+                        ::sendto(sockets->Server, buffer, static_cast<size_t>(length), 0, reinterpret_cast<sockaddr*>(&from),
+                            fromLength);
+                    }
+                    if (::recv(sockets->Client, buffer, sizeof(buffer), 0) > 0)
+                        ++received;
+                }
+                echoed += received;
+            }
+            return echoed;
+        };
+    }
+#endif
+
+#ifdef HAVE_IO_URING
+    /**
+     * @brief 与udp.echo/syscall相同的负载，两端均使用UdpRing，服务端从接收缓冲原地回射
+     */
+    /**
+     * @brief 回环上的一对UdpRing，建立ring和映射不计入耗时
+     */
+    struct EchoRings
+    {
+        EchoSockets Sockets;
+        UdpRing Server { Sockets.Server, 256, 256, 2048, 0 };
+        UdpRing Client { Sockets.Client, 256, 256, 2048, kEchoBatch };
+        size_t Received = 0;
+
+        EchoRings()
+        {
+            Server.SetOnDataCallback([this](uint8_t*, size_t length, const sockaddr*, socklen_t) {
+                Server.Reply(length);
+            });
+            Client.SetOnDataCallback([this](uint8_t*, size_t, const sockaddr*, socklen_t) {
+                ++Received;
+            });
+        }
+    };
+
+    static CaseType SetupUdpEchoRing()
+    {
+        auto rings = std::make_shared<EchoRings>();
+        return [rings](uint64_t iterations) {
+            auto& sockets = rings->Sockets;
+            uint8_t payload[kEchoPayloadSize] = {};
+
+            // 每个数据报的成本比其他用例高两到三个数量级，按十分之一的迭代次数执行
+            auto datagrams = std::max<uint64_t>(iterations / 10, kEchoBatch);
+            uint64_t echoed = 0;
+            for (uint64_t i = 0; i < datagrams; i += kEchoBatch)
+            {
+                rings->Received = 0;
+                for (size_t j = 0; j < kEchoBatch; ++j)
+                {
+                    rings->Client.Send(reinterpret_cast<sockaddr*>(&sockets.ServerAddr), sockets.ServerAddrLength, payload,
+                        sizeof(payload));
+                }
+
+                // 不挂接RunLoop，手动驱动两端
+                for (uint64_t spin = 0; rings->Received < kEchoBatch && spin < kMaxEchoSpins; ++spin)
+                {
+                    rings->Client.Flush();
+                    rings->Server.Poll();
+                    rings->Server.Flush();
+                    rings->Client.Poll();
+                }
+                echoed += rings->Received;
+            }
+            return echoed;
+        };
+    }
+#endif
+
+private:
+    Configure m_stConfig;
+    std::vector<Case> m_stCases;
+};
+
+//////////////////////////////////////////////////////////////////////////////// App
+
+static void InitLogger()
+{
+    auto& logger = Logging::GetInstance();
+
+    // 默认调试输出（控制台）
+    auto formatter = make_shared<Logging::PlainFormatter>();
+    auto stdoutLogger = make_shared<Logging::TerminalSink>(Logging::TerminalSink::OutputType::StdOut);
+    stdoutLogger->SetMinLevel(Logging::Level::Debug);
+    stdoutLogger->SetMaxLevel(Logging::Level::Info);
+    stdoutLogger->SetFormatter(formatter);
+    logger.AppendSink(stdoutLogger);
+
+    auto formatter2 = make_shared<Logging::PlainFormatter>();
+    auto stderrLogger = make_shared<Logging::TerminalSink>(Logging::TerminalSink::OutputType::StdErr);
+    stderrLogger->SetMinLevel(Logging::Level::Warn);
+    stderrLogger->SetMaxLevel(Logging::Level::Fatal);
+    stderrLogger->SetFormatter(formatter2);
+    logger.AppendSink(stderrLogger);
+
+    // 设置调试级别
+    logger.SetMinLevel(Logging::Level::Debug);
+
+    // 提交改动
+    logger.Commit();
+}
+
+static Configure ParseCommandline(int argc, const char* argv[])
+{
+    Configure cfg;
+    bool needHelp = false;
+
+    CmdParser parser;
+    parser << CmdParser::Option(cfg.Mode, "mode", 'm', "Specific the benchmark mode (churn, load, micro)", string("churn"));
+    parser << CmdParser::Option(cfg.ServerAddr, "server", 's', "Specific the server ip address", string("127.0.0.1"));
+    parser << CmdParser::Option(cfg.ServerPort, "port", 'p', "Specific the server port", static_cast<uint16_t>(0));
+    parser << CmdParser::Option(cfg.Concurrency, "concurrency", 'c', "Specific the concurrent connection count", 64u);
+    parser << CmdParser::Option(cfg.Duration, "duration", 'd', "Specific the benchmark duration, per step in load mode (s)", 10u);
+    parser << CmdParser::Option(cfg.Threads, "threads", 'n', "Specific the load generator thread count", 1u);
+    parser << CmdParser::Option(cfg.Sockets, "sockets", 'k', "Specific the UDP socket count per load thread", 4u);
+    parser << CmdParser::Option(cfg.Rate, "rate", 'r', "Specific the UDP probe rate of the first load step (pps)", 10000u);
+    parser << CmdParser::Option(cfg.RateStep, "rate-step", 'R', "Specific the UDP rate increase per load step (pps)", 10000u);
+    parser << CmdParser::Option(cfg.Steps, "steps", 'S', "Specific the load step count", 5u);
+    parser << CmdParser::Option(cfg.TcpInterval, "tcp-interval", 'i', "Specific the probe interval of each TCP session in load mode (ms)",
+        1000u);
+    parser << CmdParser::Option(cfg.Iterations, "iterations", 'N', "Specific the iteration count of each microbenchmark", 1000000u);
+    parser << CmdParser::Option(cfg.Repeat, "repeat", 'x', "Specific the measured rounds of each microbenchmark", 5u);
+    parser << CmdParser::Option(cfg.Filter, "filter", 'F', "Only run microbenchmarks whose name contains the string", string());
+    parser << CmdParser::Option(needHelp, "help", 'h', "Show this help", false);
+
+    try
+    {
+        parser(argc, argv);
+    }
+    catch (const ExceptionBase& ex)
+    {
+        fprintf(stderr, "%s\n\n", ex.GetDescription().c_str());
+        needHelp = true;
+    }
+
+    if (!needHelp && cfg.Mode != "micro" && cfg.ServerPort == 0)
+    {
+        fprintf(stderr, "--port must be specified\n\n");
+        needHelp = true;
+    }
+
+    if (needHelp)
+    {
+        auto name = PathUtils::GetFileName(argv[0]);
+        auto nameStr = string(name.GetBuffer(), name.GetSize());
+
+        fprintf(stderr, "%s\n", parser.BuildUsageText(nameStr.c_str()).c_str());
+        fprintf(stderr, "%s\n", parser.BuildOptionsText(2, 10).c_str());
+        exit(1);
+    }
+
+    InitLogger();
+    return cfg;
+}
+
+int main(int argc, const char* argv[])
+{
+    try
+    {
+        Configure cfg = ParseCommandline(argc, argv);
+        if (cfg.Mode == "churn")
+        {
+            ChurnBench bench(cfg);
+            bench.Run();
+        }
+        else if (cfg.Mode == "load")
+        {
+            LoadBench bench(cfg);
+            bench.Run();
+        }
+        else if (cfg.Mode == "micro")
+        {
+            MicroBench bench(cfg);
+            bench.Run();
+        }
+        else
+        {
+            MOE_LOG_FATAL("Unknown benchmark mode {0}", cfg.Mode);
+            return -1;
+        }
+    }
+    catch (const moe::ExceptionBase& ex)
+    {
+        MOE_LOG_EXCEPTION(ex);
+        return -1;
+    }
+    catch (const std::exception& ex)
+    {
+        MOE_LOG_FATAL("Unhandled exception: {0}", ex.what());
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <new>
+
+/**
+ * @brief 引用计数的定长缓冲块池
+ *
+ * 每个缓冲块头部附带一个用户区（如uv_write_t），使得读缓冲可以直接作为写请求提交，
+ * 写完成后最后一个引用释放时归还到池中。池本身非线程安全，每个工作线程持有一个。
+ */
+template <typename THeader>
+class BufferPool
+{
+public:
+    struct Block
+    {
+        THeader Header;
+        BufferPool* Pool;
+        Block* NextFree;
+        uint32_t RefCount;
+
+        uint8_t* GetData()noexcept { return reinterpret_cast<uint8_t*>(this) + kDataOffset; }
+        size_t GetSize()const noexcept { return Pool->m_uBlockSize; }
+
+        void AddRef()noexcept { ++RefCount; }
+
+        void Release()noexcept
+        {
+            assert(RefCount > 0);
+            if (--RefCount == 0)
+                Pool->Free(this);
+        }
+
+        static Block* FromData(void* data)noexcept
+        {
+            return reinterpret_cast<Block*>(static_cast<uint8_t*>(data) - kDataOffset);
+        }
+    };
+
+    static const size_t kDataOffset = (sizeof(Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+public:
+    /**
+     * @param blockSize 每块数据区大小
+     * @param maxFree 空闲链表最多保留的块数，超出部分直接释放
+     */
+    BufferPool(size_t blockSize, size_t maxFree)
+        : m_uBlockSize(blockSize), m_uMaxFree(maxFree) {}
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    ~BufferPool()
+    {
+        while (m_pFreeList)
+        {
+            auto next = m_pFreeList->NextFree;
+            ::operator delete(m_pFreeList);
+            m_pFreeList = next;
+        }
+    }
+
+public:
+    size_t GetBlockSize()const noexcept { return m_uBlockSize; }
+    size_t GetBlockCount()const noexcept { return m_uBlockCount; }
+    size_t GetFreeCount()const noexcept { return m_uFreeCount; }
+
+    /**
+     * @brief 获取总计获取缓冲的次数
+     */
+    uint64_t GetAcquireCount()const noexcept { return m_ullAcquireCount; }
+
+    /**
+     * @brief 获取总计向堆申请内存的次数
+     */
+    uint64_t GetHeapAllocCount()const noexcept { return m_ullHeapAllocCount; }
+
+    /**
+     * @brief 获取一个缓冲块，引用计数为1
+     */
+    Block* Alloc()
+    {
+        Block* block = m_pFreeList;
+        if (block)
+        {
+            m_pFreeList = block->NextFree;
+            --m_uFreeCount;
+        }
+        else
+        {
+            block = static_cast<Block*>(::operator new(kDataOffset + m_uBlockSize));
+            new(&block->Header) THeader();
+            block->Pool = this;
+            ++m_uBlockCount;
+            ++m_ullHeapAllocCount;
+        }
+
+        block->NextFree = nullptr;
+        block->RefCount = 1;
+        ++m_ullAcquireCount;
+        return block;
+    }
+
+private:
+    void Free(Block* block)noexcept
+    {
+        if (m_uFreeCount >= m_uMaxFree)
+        {
+            --m_uBlockCount;
+            ::operator delete(block);
+            return;
+        }
+
+        block->NextFree = m_pFreeList;
+        m_pFreeList = block;
+        ++m_uFreeCount;
+    }
+
+private:
+    const size_t m_uBlockSize = 0;
+    const size_t m_uMaxFree = 0;
+
+    Block* m_pFreeList = nullptr;
+    size_t m_uBlockCount = 0;  // 总块数（含使用中的）
+    size_t m_uFreeCount = 0;  // 空闲块数
+
+    uint64_t m_ullAcquireCount = 0;
+    uint64_t m_ullHeapAllocCount = 0;
+};
@@ -0,0 +1,162 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+/**
+ * @brief 突发探测统计（时延单位为微秒）
+ */
+struct BurstStatistic
+{
+    uint32_t BurstCount;  // 本周期内全部探测都已有结果的突发数
+    uint32_t LossyBurstCount;  // 至少丢失一个探测的突发数
+    uint32_t FullLossBurstCount;  // 全部丢失的突发数
+    uint32_t MaxBurstLoss;  // 单个突发内的最大丢包数
+    uint32_t Jitter;  // 到达间隔抖动的当前估计
+    uint32_t MaxJitter;
+    uint32_t Reordered;  // 序号小于此前已收到的最大序号的回包数
+    uint32_t MaxReorderDistance;
+};
+
+/**
+ * @brief 突发探测的逐组丢包、抖动和乱序统计
+ *
+ * 每组连续发送burstSize个探测，序号按组对齐，第seq个探测属于第seq / burstSize组。
+ * 每个探测恰好以收到或超时结束一次，组内全部结束时结算该组。以组号为下标的环形缓冲跟踪在途的组，
+ * 容量覆盖探测窗口，稳态下不产生分配。
+ * 抖动按RFC 3550 A.8增量计算，J += (|D| - J) / 16，D为相邻两个到达的探测的RTT之差，即往返抖动。
+ */
+class BurstTracker
+{
+    struct Burst
+    {
+        uint32_t Index = 0;
+        uint32_t Resolved = 0;
+        uint32_t Lost = 0;
+    };
+
+public:
+    /**
+     * @param windowCapacity 探测窗口容量，即同时在途的探测数上限
+     */
+    BurstTracker(uint32_t burstSize, size_t windowCapacity)
+        : m_uBurstSize(burstSize)
+    {
+        size_t capacity = 1;
+        while (capacity < windowCapacity / burstSize + 2)
+            capacity <<= 1;
+        m_stBursts.resize(capacity);
+        m_uMask = static_cast<uint32_t>(capacity - 1);
+    }
+
+public:
+    uint32_t GetBurstSize()const noexcept { return m_uBurstSize; }
+
+    void OnLost(uint32_t seq)noexcept
+    {
+        Resolve(seq, true);
+    }
+
+    /**
+     * @param rtt 往返时延（微秒）
+     */
+    void OnReceived(uint32_t seq, uint32_t rtt)noexcept
+    {
+        if (m_bHasReceived && static_cast<int32_t>(seq - m_uMaxSeq) < 0)
+        {
+            ++m_uReordered;
+            m_uMaxReorderDistance = std::max(m_uMaxReorderDistance, m_uMaxSeq - seq);
+        }
+        else
+        {
+            m_uMaxSeq = seq;
+        }
+
+        // 以16倍定点保存，避免浮点并保留小数精度
+        if (m_bHasReceived)
+        {
+            auto d = rtt > m_uLastRtt ? rtt - m_uLastRtt : m_uLastRtt - rtt;
+            m_ullJitterScaled = m_ullJitterScaled - ((m_ullJitterScaled + 8) >> 4) + d;
+            m_uMaxJitter = std::max(m_uMaxJitter, GetJitter());
+        }
+        m_uLastRtt = rtt;
+        m_bHasReceived = true;
+
+        Resolve(seq, false);
+    }
+
+    BurstStatistic GetStatistic()const noexcept
+    {
+        BurstStatistic desc {};
+        desc.BurstCount = m_uBurstCount;
+        desc.LossyBurstCount = m_uLossyBurstCount;
+        desc.FullLossBurstCount = m_uFullLossBurstCount;
+        desc.MaxBurstLoss = m_uMaxBurstLoss;
+        desc.Jitter = GetJitter();
+        desc.MaxJitter = m_uMaxJitter;
+        desc.Reordered = m_uReordered;
+        desc.MaxReorderDistance = m_uMaxReorderDistance;
+        return desc;
+    }
+
+    /**
+     * @brief 开始新的统计周期
+     *
+     * 在途的组和抖动估计保留。
+     */
+    void Reset()noexcept
+    {
+        m_uBurstCount = 0;
+        m_uLossyBurstCount = 0;
+        m_uFullLossBurstCount = 0;
+        m_uMaxBurstLoss = 0;
+        m_uMaxJitter = GetJitter();
+        m_uReordered = 0;
+        m_uMaxReorderDistance = 0;
+    }
+
+private:
+    uint32_t GetJitter()const noexcept { return static_cast<uint32_t>(m_ullJitterScaled >> 4); }
+
+    void Resolve(uint32_t seq, bool lost)noexcept
+    {
+        auto index = seq / m_uBurstSize;
+        auto& burst = m_stBursts[index & m_uMask];
+        if (burst.Index != index)
+        {
+            burst.Index = index;
+            burst.Resolved = 0;
+            burst.Lost = 0;
+        }
+        ++burst.Resolved;
+        if (lost)
+            ++burst.Lost;
+        if (burst.Resolved < m_uBurstSize)
+            return;
+
+        ++m_uBurstCount;
+        if (burst.Lost > 0)
+            ++m_uLossyBurstCount;
+        if (burst.Lost == m_uBurstSize)
+            ++m_uFullLossBurstCount;
+        m_uMaxBurstLoss = std::max(m_uMaxBurstLoss, burst.Lost);
+    }
+
+private:
+    const uint32_t m_uBurstSize;
+    std::vector<Burst> m_stBursts;
+    uint32_t m_uMask = 0;
+
+    bool m_bHasReceived = false;
+    uint32_t m_uMaxSeq = 0;
+    uint32_t m_uLastRtt = 0;
+    uint64_t m_ullJitterScaled = 0;
+
+    uint32_t m_uBurstCount = 0;
+    uint32_t m_uLossyBurstCount = 0;
+    uint32_t m_uFullLossBurstCount = 0;
+    uint32_t m_uMaxBurstLoss = 0;
+    uint32_t m_uMaxJitter = 0;
+    uint32_t m_uReordered = 0;
+    uint32_t m_uMaxReorderDistance = 0;
+};
@@ -1,5 +1,3 @@
-#include <deque>
-
 #include <Moe.Core/Logging.hpp>
 #include <Moe.Core/CmdParser.hpp>
 #include <Moe.Core/Mdr.hpp>
@@ -9,6 +7,32 @@
 #include <Moe.UV/TcpSocket.hpp>
 #include <Moe.UV/UdpSocket.hpp>
 
+#include <deque>
+#include <csignal>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+#include "SocketUtils.hpp"
+#include "HiResClock.hpp"
+#include "TimestampedUdpSocket.hpp"
+#include "UdpRing.hpp"
+#include "UdpBatch.hpp"
+#include "ProbeScheduler.hpp"
+#include "TcpFraming.hpp"
+#include "PingPacket.hpp"
+#include "AsyncSink.hpp"
+#include "SnapshotBuffer.hpp"
+#include "Backoff.hpp"
+#include "Pinger.hpp"
+#include "MetricsServer.hpp"
+#include "LoopMonitor.hpp"
+#include "CpuAffinity.hpp"
+
 using namespace std;
 using namespace moe;
 using namespace UV;
@@ -18,143 +42,346 @@ struct Configure
     std::string ServerAddr;
     uint16_t ServerPort;
     uint32_t PingInterval;
+    uint32_t PingIntervalUs;
     uint32_t PingTimeout;
     std::string Output;
+    bool HiRes;
+    bool Timestamping;
+    bool IoUring;
+    std::string TargetFile;
+    std::string WireFormat;
+    std::string SampleFile;
+    bool ServerTimestamps;
+    uint32_t ReportInterval;
+    std::string WindowList;
+    std::vector<uint32_t> Windows;  // 滑动窗口长度（毫秒），由WindowList解析
+    std::string MetricsListen;
+    uint16_t MetricsPort;
+    bool TcpStandby;
+    uint32_t Flows;
+    uint16_t FlowBasePort;
+    bool LoopStats;
+    std::string PayloadSizeList;
+    std::vector<uint32_t> PayloadSizes;  // 探测包总长度（字节），由PayloadSizeList解析，按序号轮换
+    uint32_t Burst;
+    bool WatchTargets;
+    uint32_t MaxConnecting;
+    std::string CpuAffinity;  // 探测循环绑定的CPU，取列表中的第一个
+    int32_t NumaNode;
+    std::string RxQueues;  // 网卡名，非空时探测循环放置在RX队列中断所在的CPU上
 };
 
-struct PingPacket
+struct TargetConfigure
 {
-    MOE_DR_FIELDS(
-        (0, uint32_t, Seq),
-        (1, Time::Tick, SendTime)
-    )
+    std::string Name;
+    std::string ServerAddr;
+    uint16_t ServerPort;
 };
 
-//////////////////////////////////////////////////////////////////////////////// PingStatistic
+//////////////////////////////////////////////////////////////////////////////// Client
 
-struct PingStatistic
+/**
+ * @brief 获取发包间隔（微秒）
+ */
+static uint32_t GetIntervalUs(const Configure& cfg)noexcept
 {
-    uint32_t TotalPacket;
-    uint32_t PacketLost;
-    uint32_t AvailablePacket;
-    uint32_t LatencyTotal;
-    uint32_t MaxLatency;
-    uint32_t MinLatency;
-};
+    return cfg.PingIntervalUs != 0 ? cfg.PingIntervalUs : cfg.PingInterval * 1000u;
+}
 
-class Pinger
+/**
+ * @brief 读取目标列表
+ *
+ * 每行一个目标，格式为`<ip> <port> [name]`，空行及以#开头的行被忽略，未指定名字时使用`ip:port`。
+ */
+static std::vector<TargetConfigure> LoadTargets(const std::string& path)
 {
-public:
-    Pinger(uint32_t interval, uint32_t timeout)
-        : m_uInterval(interval), m_uTimeout(timeout) {}
-    
-public:
-    Optional<PingPacket> Update(Time::Tick now)
-    {
-        Optional<PingPacket> ret;
-        if (m_ullNextSendTime <= now)
-        {
-            // 处理超时
-            while (!m_stPingWindow.empty() && m_stPingWindow.size() * m_uInterval >= m_uTimeout)
-            {
-                if (!m_stPingWindow[0])
-                    ++m_uPacketLost;
-                m_stPingWindow.pop_front();
-            }
+    ifstream file(path);
+    if (!file)
+        MOE_THROW(IOException, "Cannot open target file {0}", path);
 
-            // 发送PING包
-            PingPacket packet {};
-            packet.Seq = m_uNextSeq++;
-            packet.SendTime = now;
-
-            m_stPingWindow.emplace_back(false);
-
-            m_uTotalPacket += 1;
-            m_ullNextSendTime = now + m_uInterval;
-            ret = packet;
-        }
-        return ret;
+    std::vector<TargetConfigure> targets;
+    string line;
+    for (size_t lineNo = 1; getline(file, line); ++lineNo)
+    {
+        auto comment = line.find('#');
+        if (comment != string::npos)
+            line.resize(comment);
+
+        istringstream fields(line);
+        TargetConfigure target;
+        uint32_t port = 0;
+        if (!(fields >> target.ServerAddr))
+            continue;
+        if (!(fields >> port) || port == 0 || port > 65535)
+            MOE_THROW(BadFormatException, "Invalid port at {0}:{1}", path, lineNo);
+        target.ServerPort = static_cast<uint16_t>(port);
+        if (!(fields >> target.Name))
+            target.Name = StringUtils::Format("{0}:{1}", target.ServerAddr, target.ServerPort);
+        targets.emplace_back(std::move(target));
     }
+    return targets;
+}
 
-    void Recv(const PingPacket& packet)
-    {
-        auto offset = m_stPingWindow.size() - (m_uNextSeq - packet.Seq);
-        if (offset >= m_stPingWindow.size())
-            return;
-        if (m_stPingWindow[offset])
-            return;
+/**
+ * @brief 是否使用纳秒时钟计算时延
+ */
+static bool IsHiRes(const Configure& cfg)noexcept
+{
+    return cfg.HiRes || cfg.Timestamping || cfg.ServerTimestamps;
+}
 
-        auto now = RunLoop::Now();
-        auto elapsed = static_cast<uint32_t>(now - packet.SendTime);
+class Client
+{
+    enum {
+        STATE_TCP_NOT_CONNECT = 0,
+        STATE_TCP_CONNECTING = 1,
+        STATE_TCP_CONNECTED = 2,
+    };
 
-        m_stPingWindow[offset] = true;
-        m_uAvailablePacket += 1;
-        m_uLatencyTotal += elapsed;
-        m_uMaxLatency = std::max(m_uMaxLatency, elapsed);
-        m_uMinLatency = std::min(m_uMinLatency, elapsed);
-    }
+    static const size_t kStatQueueCapacity = 1u << 16;
+    static const uint32_t kReporterPollIntervalMs = 50;
+    static const Time::Tick kMinReconnectDelay = 500;
+    static const Time::Tick kMaxReconnectDelay = 30 * 1000;
+    static const Time::Tick kStableConnectionTime = 10 * 1000;  // 连接保持超过该时间后退避重新从头开始
+    static const Time::Tick kMinConnectTimeout = 3000;  // 建连超时的下限，至少容纳一次SYN重传
+    static const Time::Tick kRetiredTargetGracePeriod = 1000;  // 被移除的目标的槽位在超时之后再隔离的时间
+    static const Time::Tick kTargetFileCheckInterval = 1000;
+    static const Time::Tick kStandbyKeepAliveInterval = 15 * 1000;  // 低于服务端默认的空闲超时
+    static const uint32_t kKeepAliveTargetId = 0xFFFFFFFFu;  // 保活探测的TargetId，回包直接丢弃
+
+    /**
+     * @brief TCP连接
+     *
+     * 启用备用连接时每个目标持有两个，一个承载探测，另一个预先完成握手，在前者失效时立即接替。
+     */
+    struct TcpChannel
+    {
+        TcpSocket Socket;
+        TcpFraming::Decoder Decoder;
+        int State = STATE_TCP_NOT_CONNECT;
+        Time::Tick NextTryConnectTime = 0;
+        Time::Tick ConnectedTime = 0;
+        Time::Tick ConnectDeadline = 0;  // 建连超过该时间仍未完成时放弃，释放建连名额
+        uint64_t ConnectStartTime = 0;  // HiResClock::Now()
+        ReconnectBackoff Backoff { kMinReconnectDelay, kMaxReconnectDelay };
+    };
 
-    PingStatistic GetStatistic()
+    /**
+     * @brief 待写入文件的统计记录
+     *
+     * 定长POD，在事件循环线程上填充，在写出线程上格式化。
+     */
+    struct StatRecord
     {
-        PingStatistic desc {};
-        desc.TotalPacket = m_uTotalPacket;
-        desc.PacketLost = m_uPacketLost;
-        desc.AvailablePacket = m_uAvailablePacket;
-        desc.LatencyTotal = m_uLatencyTotal;
-        desc.MaxLatency = m_uAvailablePacket == 0 ? 0 : m_uMaxLatency;
-        desc.MinLatency = m_uAvailablePacket == 0 ? 0 : m_uMinLatency;
-        return desc;
-    }
+        enum : uint8_t
+        {
+            KIND_PING = 0,
+            KIND_ONE_WAY = 1,
+            KIND_WINDOW = 2,
+            KIND_SIZE = 3,
+            KIND_BURST = 4,
+        };
+
+        struct SizeRecord
+        {
+            uint32_t Bytes;
+            SizeBucketStatistic Stat;
+        };
+
+        uint8_t Kind;
+        bool HiRes;
+        char Name[64];  // name|channel，超长时截断
+        union
+        {
+            PingStatistic Ping;
+            OneWayDelayStatistic OneWay;
+            SlidingWindowStatistic Window;
+            SizeRecord Size;
+            BurstStatistic Burst;
+        };
+    };
 
-    void Reset()
+    /**
+     * @brief 建连统计（时延单位为微秒）
+     */
+    struct TcpConnectStatistic
     {
-        m_stPingWindow.clear();
+        uint64_t Count = 0;
+        uint64_t Failures = 0;
+        uint64_t LatencyTotal = 0;
+        uint64_t MaxLatency = 0;
+    };
 
-        m_ullNextSendTime = 0;
-        m_uTotalPacket = 0;
-        m_uPacketLost = 0;
-        m_uAvailablePacket = 0;
-        m_uLatencyTotal = 0;
-        m_uMaxLatency = 0;
-        m_uMinLatency = numeric_limits<uint32_t>::max();
-    }
+    /**
+     * @brief 单个通道一个统计周期的聚合结果
+     */
+    struct ChannelReport
+    {
+        PingStatistic Ping;
+        std::vector<SlidingWindowStatistic> Windows;
+        bool HasOneWay = false;
+        OneWayDelayStatistic OneWay;
+        std::vector<SizeBucketStatistic> Sizes;  // 与Configure::PayloadSizes一一对应
+        bool HasBurst = false;
+        BurstStatistic Burst;
+    };
 
-private:
-    const uint32_t m_uInterval = 0;
-    const uint32_t m_uTimeout = 0;
-
-    Time::Tick m_ullNextSendTime = 0;  // 下一次发送时间
-    uint32_t m_uNextSeq = 0;  // 下一个要发还未发的Seq
-    std::deque<bool> m_stPingWindow;
-
-    uint32_t m_uTotalPacket = 0;  // 总包量
-    uint32_t m_uPacketLost = 0;  // 丢包量
-    uint32_t m_uAvailablePacket = 0;  // 有效采样包
-    uint32_t m_uLatencyTotal = 0;  // 总时延
-    uint32_t m_uMaxLatency = 0;  // 最大时延
-    uint32_t m_uMinLatency = numeric_limits<uint32_t>::max();  // 最小时延
-};
+    struct TargetReport
+    {
+        bool Active = false;  // 槽位上的目标已被移除时为false
+        uint64_t Generation = 0;  // 与Target::Generation不一致时重新拷贝名字和容器大小
+        std::string Name;
+        uint32_t Flow = 0;
+        ChannelReport Tcp;
+        ChannelReport Udp;
+    };
 
-//////////////////////////////////////////////////////////////////////////////// Client
+    /**
+     * @brief 一个统计周期的快照
+     *
+     * 由事件循环线程在周期结束时原地填充并发布，报告线程负责汇总、格式化和写出，探测路径上不做任何格式化。
+     */
+    struct ReportSnapshot
+    {
+        uint64_t Seq = 0;
+        std::vector<TargetReport> Targets;
+        ProbeSchedulerStatistic TcpScheduler;
+        ProbeSchedulerStatistic UdpScheduler;
+        TcpConnectStatistic TcpConnect;
+        uint64_t MalformedPackets = 0;  // 本周期内的增量
+        uint64_t TruncatedPackets = 0;  // 本周期内的增量
+        uint64_t SampleCount = 0;
+        uint64_t SampleDropCount = 0;
+        bool HasLoop = false;
+        LoopMonitor::Statistic Loop;
+    };
 
-class Client
-{
-    enum {
-        STATE_TCP_NOT_CONNECT = 0,
-        STATE_TCP_CONNECTING = 1,
-        STATE_TCP_CONNECTED = 2,
+    /**
+     * @brief 探测目标
+     *
+     * 每个目标独占一个（启用备用连接时为两个）TCP连接和两个Pinger，UDP共享同一个Socket，按包内的TargetId分发回包。
+     * 多流模式下每个配置的目标展开为连续的Flows个目标，每个流使用独立的UDP源端口和TCP连接，以覆盖不同的ECMP路径。
+     * 目标列表中的一项占用一组连续的槽位，Id即槽位下标。重新加载后被移除的目标保留在槽位上直到超时过后才被复用，
+     * 以免在途的回包被分发给新的目标。
+     */
+    struct Target
+    {
+        Target(uint32_t id, uint64_t generation, const TargetConfigure& cfg, const Configure& global)
+            : Id(id), Generation(generation), Name(cfg.Name), ServerEndPoint(cfg.ServerAddr, cfg.ServerPort),
+            TcpPinger(GetIntervalUs(global), global.PingTimeout, IsHiRes(global), global.Windows, global.ServerTimestamps),
+            UdpPinger(GetIntervalUs(global), global.PingTimeout, IsHiRes(global), global.Windows, global.ServerTimestamps,
+                global.Burst) {}
+
+        const uint32_t Id;
+        const uint64_t Generation;
+        const std::string Name;  // 单目标模式下为空，多流模式下带#流编号后缀
+        uint32_t Flow = 0;
+        bool Retired = false;
+        uint32_t TcpProbeId = 0;
+        uint32_t UdpProbeId = 0;
+        EndPoint ServerEndPoint;
+        sockaddr_storage ServerAddr;
+        socklen_t ServerAddrLength = 0;
+        char ServerAddrString[SocketUtils::kMaxAddressStringLength];
+        std::string MetricLabels;  // 预先转义的target标签
+
+        TcpChannel TcpChannels[2];
+        uint32_t ActiveTcpChannel = 0;
+        Time::Tick NextKeepAliveTime = 0;
+
+        // 自启动起的累计值
+        Metrics::LatencyBuckets TcpConnectLatency;  // 微秒
+        uint64_t TcpConnectFailures = 0;
+        uint64_t TcpFailovers = 0;
+
+        Pinger TcpPinger;
+        Pinger UdpPinger;
     };
 
 public:
-    Client(const Configure& cfg)
-        : m_stConfig(cfg), m_stServerEndPoint(cfg.ServerAddr, cfg.ServerPort), m_stRunLoop(m_stObjectPool),
-        m_stTimer(Timer::CreateTickTimer(100)), m_stTcpSocket(TcpSocket::Create()), m_stUdpSocket(UdpSocket::Create()),
-        m_stTcpPinger(cfg.PingInterval, cfg.PingTimeout), m_stUdpPinger(cfg.PingInterval, cfg.PingTimeout)
+    Client(const Configure& cfg, const std::vector<TargetConfigure>& targets)
+        : m_stConfig(cfg), m_stRunLoop(m_stObjectPool), m_stTimer(Timer::CreateTickTimer(100)),
+        m_stUdpSocket(UdpSocket::Create())
     {
+        if (targets.empty())
+            MOE_THROW(BadArgumentException, "No target specified");
+        if (cfg.WireFormat == "mdr")
+            m_bMdrFormat = true;
+        else if (cfg.WireFormat != "binary")
+            MOE_THROW(BadArgumentException, "Unknown wire format {0}", cfg.WireFormat);
+        if (cfg.ServerTimestamps && m_bMdrFormat)
+            MOE_THROW(BadArgumentException, "Server timestamps require the binary wire format");
+
         m_stTimer.SetOnTimeCallback(bind(&Client::OnTick, this));
+        m_stTcpScheduler.SetOnProbeCallback(bind(&Client::OnTcpProbe, this, placeholders::_1));
+        m_stUdpScheduler.SetOnProbeCallback(bind(&Client::OnUdpProbe, this, placeholders::_1));
 
-        BindTcpEvent();
-        BindUdpEvent();
+        // 共享的UDP Socket只能发往同一地址族，由第一个目标决定
+        auto now = RunLoop::Now();
+        m_stTargets.reserve(targets.size() * GetFlowCount());
+        for (const auto& target : targets)
+        {
+            auto key = MakeTargetKey(target);
+            if (m_stTargetGroups.find(key) != m_stTargetGroups.end())
+            {
+                MOE_LOG_WARN("Duplicated target {0}:{1} ignored", target.ServerAddr, target.ServerPort);
+                continue;
+            }
+            m_stTargetGroups.emplace(key, AddTargetGroup(target, now));
+        }
+        auto family = m_iFamily;
+        auto flows = GetFlowCount();
+
+        // 最大的探测包之前预留TCP帧头，二进制包编码后原地补上帧头即可发送，填充区只需清零一次
+        size_t maxPacketSize = PingPacketCodec::kMaxSize;
+        for (auto size : cfg.PayloadSizes)
+            maxPacketSize = std::max<size_t>(maxPacketSize, size);
+        m_stPacketBuffer.assign(TcpFraming::kHeaderSize + maxPacketSize, 0);
+        if ((!cfg.PayloadSizes.empty() || IsBurstEnabled()) && m_bMdrFormat)
+            MOE_THROW(BadArgumentException, "--payload-size and --burst require the binary wire format");
+
+        // 按尺寸探测或突发探测时同样走独立的流socket，以便设置DF、直接得到本地EMSGSIZE以及批量发送
+        if (flows > 1 || !cfg.PayloadSizes.empty() || IsBurstEnabled())
+        {
+            if (cfg.Timestamping || cfg.IoUring)
+            {
+                MOE_THROW(BadArgumentException, "--flows, --payload-size and --burst cannot be combined with --timestamping "
+                    "or --io-uring");
+            }
+            CreateFlowSockets(family);
+        }
+#ifdef __linux__
+        if (IsBurstEnabled())
+            m_pUdpBurst.reset(new UdpBatch(cfg.Burst, maxPacketSize));
+#endif
+
+#ifndef __linux__
+        if (cfg.Timestamping)
+            MOE_THROW(BadArgumentException, "Kernel timestamping is only supported on Linux");
+#else
+        if (cfg.Timestamping)
+        {
+            // 内核时间戳为CLOCK_REALTIME，UDP通道的发送时间也使用墙上时钟
+            m_pTimestampedUdpSocket.reset(new TimestampedUdpSocket(family));
+            m_pTimestampedUdpSocket->SetOnDataCallback(bind(&Client::OnTimestampedUdpData, this, placeholders::_1,
+                placeholders::_2, placeholders::_3));
+            m_pTimestampedUdpSocket->SetOnErrorCallback(bind(&Client::OnTimestampedUdpError, this, placeholders::_1));
+        }
+        else
+#endif
+        {
+            BindUdpEvent();
+        }
+
+#ifdef HAVE_IO_URING
+        if (cfg.IoUring && cfg.Timestamping)
+            MOE_LOG_WARN("--io-uring is ignored with --timestamping");
+        else if (cfg.IoUring)
+            CreateUdpRing(family);
+#else
+        if (cfg.IoUring)
+            MOE_LOG_WARN("io_uring support is not compiled in, ignoring --io-uring");
+#endif
 
         if (!cfg.Output.empty())
         {
@@ -165,25 +392,496 @@ public:
             m_pSink->SetMinLevel(Logging::Level::Debug);
             m_pSink->SetMaxLevel(Logging::Level::Info);
             m_pSink->SetFormatter(formatter);
+
+            // 文件写入放到后台线程，磁盘变慢或轮转时不阻塞探测
+            m_pStatSink.reset(new AsyncSink<StatRecord>(kStatQueueCapacity,
+                bind(&Client::WriteStatRecord, this, placeholders::_1)));
+        }
+
+        if (cfg.LoopStats)
+            m_pLoopMonitor.reset(new LoopMonitor());
+
+        if (cfg.MetricsPort != 0)
+        {
+            m_pMetricsServer.reset(new MetricsServer(cfg.MetricsListen, cfg.MetricsPort));
+            m_pMetricsServer->SetOnRenderCallback(bind(&Client::RenderMetrics, this, placeholders::_1));
+        }
+
+        if (!cfg.SampleFile.empty())
+        {
+            // 样本时间统一换算为墙上时钟，未使用墙上时钟的通道加上两个时钟的差值
+            auto realtimeNow = HiResClock::RealtimeNow();
+            auto steadyToRealtime = static_cast<int64_t>(realtimeNow - HiResClock::Now());
+            m_pSampleLog.reset(new SampleLog::Writer(cfg.SampleFile, realtimeNow));
+            m_llSteadyToRealtime = steadyToRealtime;
+            for (auto& target : m_stTargets)
+                AttachSampleLog(*target);
+        }
+
+        if (!cfg.TargetFile.empty())
+        {
+            ::stat(cfg.TargetFile.c_str(), &m_stTargetFileStat);
+#ifndef _WIN32
+            // 收到SIGHUP时重新加载目标列表
+            m_pReloadSignal = new uv_signal_t();
+            ::uv_signal_init(RunLoop::GetCurrentUVLoop(), m_pReloadSignal);
+            m_pReloadSignal->data = this;
+#endif
+        }
+
+        // 快照的容器按目标数和窗口数预先分配，发布时原地覆盖，只在目标列表重新加载后调整
+        ReportSnapshot initial;
+        initial.Targets.resize(m_stTargets.size());
+        for (size_t i = 0; i < m_stTargets.size(); ++i)
+            PrepareTargetReport(initial.Targets[i], *m_stTargets[i]);
+        m_pReportBuffer.reset(new SnapshotBuffer<ReportSnapshot>(initial));
+    }
+
+    ~Client()
+    {
+#ifndef _WIN32
+        if (m_pReloadSignal)
+        {
+            // 句柄内存需要在关闭回调中释放
+            m_pReloadSignal->data = nullptr;
+            ::uv_close(reinterpret_cast<uv_handle_t*>(m_pReloadSignal), [](uv_handle_t* handle) {
+                delete reinterpret_cast<uv_signal_t*>(handle);
+            });
+        }
+#endif
+
+        if (m_pReporterThread)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_stReporterMutex);
+                m_bReporterStopping = true;
+            }
+            m_stReporterCondition.notify_one();
+            m_pReporterThread->join();
+        }
+
+#ifdef HAVE_IO_URING
+        // UdpRing不持有socket，等在途请求结束后再关闭
+        if (m_pUdpRing)
+        {
+            m_pUdpRing.reset();
+            ::close(m_iUdpRingFd);
         }
+#endif
     }
 
 public:
-    void Run()
+    /**
+     * @param placement 探测循环的放置，在汇报线程启动后才绑定CPU，避免汇报和异步输出与探测争抢同一个核
+     */
+    void Run(const CpuAffinity::Placement& placement)
     {
+        // 所有目标的发包时间均匀分布在一个周期内
+        auto count = m_stTargets.size();
+        for (size_t i = 0; i < count; ++i)
+            ScheduleTarget(*m_stTargets[i], GetIntervalUs(m_stConfig) * 1000ull * i / count);
+
+        m_pReporterThread.reset(new std::thread(&Client::ReporterMain, this));
+        if (placement.Cpu >= 0)
+            CpuAffinity::PinCurrentThread(std::vector<int> { placement.Cpu });
+        MOE_LOG_INFO("Probe loop placement: {0}", CpuAffinity::Describe(placement));
         m_stTimer.Start();
-        m_stUdpSocket.StartRead();
+        if (m_pMetricsServer)
+            m_pMetricsServer->Start();
+        if (m_pLoopMonitor)
+            m_pLoopMonitor->Start();
+#ifndef _WIN32
+        if (m_pReloadSignal)
+            ::uv_signal_start(m_pReloadSignal, OnReloadSignal, SIGHUP);
+#endif
+        m_stUdpScheduler.Start();
+        m_stTcpScheduler.Start();
+
+        if (!m_stFlowSockets.empty())
+        {
+            for (auto& socket : m_stFlowSockets)
+                socket.StartRead();
+        }
+#ifdef HAVE_IO_URING
+        else if (m_pUdpRing)
+            m_pUdpRing->Start();
+#endif
+#ifdef __linux__
+        else if (m_pTimestampedUdpSocket)
+            m_pTimestampedUdpSocket->StartRead();
+#endif
+        else
+            m_stUdpSocket.StartRead();
 
         m_stRunLoop.Run();
     }
 
 protected:
-    void BindTcpEvent()
+    uint32_t GetTcpChannelCount()const noexcept { return m_stConfig.TcpStandby ? 2 : 1; }
+
+    /**
+     * @brief 目标列表中一项的标识，名字、地址或端口任一变化都视为不同的目标
+     */
+    static std::string MakeTargetKey(const TargetConfigure& cfg)
+    {
+        return StringUtils::Format("{0}|{1}|{2}", cfg.Name, cfg.ServerAddr, cfg.ServerPort);
+    }
+
+    /**
+     * @brief 为目标列表中的一项分配一组槽位并创建各个流的目标
+     * @return 组号，组内第k个流的Id为组号 * Flows + k
+     *
+     * 地址非法或地址族与其他目标不同时抛出异常，不改变任何状态。
+     */
+    uint32_t AddTargetGroup(const TargetConfigure& cfg, Time::Tick now)
+    {
+        sockaddr_storage addr;
+        auto addrLength = SocketUtils::ParseAddress(cfg.ServerAddr, cfg.ServerPort, addr);
+        if (m_iFamily != AF_UNSPEC && m_iFamily != addr.ss_family)
+        {
+            MOE_THROW(BadArgumentException, "Target {0}:{1} has a different address family from the others", cfg.ServerAddr,
+                cfg.ServerPort);
+        }
+        m_iFamily = addr.ss_family;
+
+        // 优先复用已过隔离期的组，否则追加；样本文件中以目标记录区分复用前后的目标
+        auto flows = GetFlowCount();
+        uint32_t group = 0;
+        if (!m_stFreeGroups.empty() && m_stFreeGroups.front().first <= now)
+        {
+            group = m_stFreeGroups.front().second;
+            m_stFreeGroups.pop_front();
+        }
+        else
+        {
+            group = static_cast<uint32_t>(m_stTargets.size() / flows);
+            m_stTargets.resize(m_stTargets.size() + flows);
+        }
+
+        for (uint32_t k = 0; k < flows; ++k)
+        {
+            auto flowTarget = cfg;
+            if (flows > 1)
+                flowTarget.Name = StringUtils::Format("{0}#{1}", cfg.Name.empty() ? string("flow") : cfg.Name, k);
+
+            auto id = group * flows + k;
+            m_stTargets[id].reset(new Target(id, ++m_ullTargetGeneration, flowTarget, m_stConfig));
+            auto& target = *m_stTargets[id];
+            target.Flow = k;
+            target.ServerAddr = addr;
+            target.ServerAddrLength = addrLength;
+            SocketUtils::ToString(reinterpret_cast<const sockaddr*>(&target.ServerAddr), target.ServerAddrString,
+                sizeof(target.ServerAddrString));
+            Metrics::AppendLabel(target.MetricLabels, "target", cfg.Name.empty() ? target.ServerAddrString : cfg.Name.c_str());
+            if (flows > 1)
+                Metrics::AppendLabel(target.MetricLabels, "flow", StringUtils::Format("{0}", k).c_str());
+
+            for (uint32_t j = 0; j < GetTcpChannelCount(); ++j)
+                ResetTcpChannel(target, j);
+            target.TcpPinger.SetSizeBucketCount(m_stConfig.PayloadSizes.size());
+            target.UdpPinger.SetSizeBucketCount(m_stConfig.PayloadSizes.size());
+            if (m_pSampleLog)
+                AttachSampleLog(target);
+        }
+        return group;
+    }
+
+    /**
+     * @brief 停止一组目标的探测并关闭连接
+     *
+     * 槽位在超时过后才会被复用，在此之前到达的回包被丢弃。
+     */
+    void RemoveTargetGroup(uint32_t group, Time::Tick now)
     {
-        m_stTcpSocket.SetOnConnectCallback(bind(&Client::OnTcpConnected, this, placeholders::_1));
-        m_stTcpSocket.SetOnErrorCallback(bind(&Client::OnTcpError, this, placeholders::_1));
-        m_stTcpSocket.SetOnDataCallback(bind(&Client::OnTcpData, this, placeholders::_1));
-        m_stTcpSocket.SetOnEofCallback(bind(&Client::OnTcpDataEof, this));
+        auto flows = GetFlowCount();
+        for (uint32_t k = 0; k < flows; ++k)
+        {
+            auto& target = *m_stTargets[group * flows + k];
+            target.Retired = true;
+            m_stTcpScheduler.Remove(target.TcpProbeId);
+            m_stUdpScheduler.Remove(target.UdpProbeId);
+            for (uint32_t j = 0; j < GetTcpChannelCount(); ++j)
+            {
+                auto& channel = target.TcpChannels[j];
+                if (channel.State == STATE_TCP_CONNECTING)
+                    --m_uConnectingCount;
+                channel.State = STATE_TCP_NOT_CONNECT;
+                channel.Socket.Close();
+            }
+        }
+        m_stFreeGroups.emplace_back(now + m_stConfig.PingTimeout + kRetiredTargetGracePeriod, group);
+    }
+
+    /**
+     * @brief 安排目标的探测和首次建连
+     * @param offset 首次探测相对当前时间的偏移（纳秒），TCP再错开半个周期
+     */
+    void ScheduleTarget(Target& target, uint64_t offset)
+    {
+        auto interval = GetIntervalUs(m_stConfig) * 1000ull;
+        for (uint32_t j = 0; j < GetTcpChannelCount(); ++j)
+            target.TcpChannels[j].NextTryConnectTime = RunLoop::Now() + offset / 1000000ull;
+
+        // 探测ID由调度器分配并在删除后复用，与目标Id无关
+        target.UdpProbeId = m_stUdpScheduler.Add(interval, offset);
+        target.TcpProbeId = m_stTcpScheduler.Add(interval, (offset + interval / 2) % interval);
+        SetProbeTarget(m_stUdpProbeTargets, target.UdpProbeId, &target);
+        SetProbeTarget(m_stTcpProbeTargets, target.TcpProbeId, &target);
+    }
+
+    static void SetProbeTarget(std::vector<Target*>& table, uint32_t id, Target* target)
+    {
+        if (id >= table.size())
+            table.resize(id + 1, nullptr);
+        table[id] = target;
+    }
+
+    /**
+     * @brief 让目标的样本写入样本文件，并记录Id对应的目标
+     */
+    void AttachSampleLog(Target& target)
+    {
+        m_pSampleLog->RecordTarget(target.Id, target.Name, target.ServerAddrString, HiResClock::RealtimeNow() / 1000);
+        target.TcpPinger.SetSampleLog(m_pSampleLog.get(), target.Id, SampleLog::PROTO_TCP,
+            m_stConfig.ServerTimestamps ? 0 : m_llSteadyToRealtime);
+        target.UdpPinger.SetSampleLog(m_pSampleLog.get(), target.Id, SampleLog::PROTO_UDP,
+            IsUdpClockRealtime() ? 0 : m_llSteadyToRealtime);
+    }
+
+    /**
+     * @brief 重新加载目标列表
+     *
+     * 与当前列表逐项比较：未变化的目标保留连接和统计，移除的目标停止探测，新增的目标的探测和建连均匀错开在一个周期内，
+     * 并受--max-connecting限制并发建连数。读取失败时保留当前列表。
+     */
+    void ReloadTargets()
+    {
+        std::vector<TargetConfigure> targets;
+        try
+        {
+            targets = LoadTargets(m_stConfig.TargetFile);
+        }
+        catch (const ExceptionBase& ex)
+        {
+            MOE_LOG_ERROR("Reload targets failed, keep the current list: {0}", ex.GetDescription());
+            return;
+        }
+
+        auto now = RunLoop::Now();
+        std::unordered_set<std::string> keys;
+        std::vector<const TargetConfigure*> added;
+        for (const auto& target : targets)
+        {
+            auto key = MakeTargetKey(target);
+            if (!keys.insert(key).second)
+                MOE_LOG_WARN("Duplicated target {0}:{1} ignored", target.ServerAddr, target.ServerPort);
+            else if (m_stTargetGroups.find(key) == m_stTargetGroups.end())
+                added.push_back(&target);
+        }
+
+        size_t removed = 0;
+        for (auto it = m_stTargetGroups.begin(); it != m_stTargetGroups.end(); )
+        {
+            if (keys.find(it->first) != keys.end())
+            {
+                ++it;
+                continue;
+            }
+            RemoveTargetGroup(it->second, now);
+            it = m_stTargetGroups.erase(it);
+            ++removed;
+        }
+
+        auto flows = GetFlowCount();
+        auto interval = GetIntervalUs(m_stConfig) * 1000ull;
+        size_t failed = 0;
+        for (size_t i = 0; i < added.size(); ++i)
+        {
+            uint32_t group = 0;
+            try
+            {
+                group = AddTargetGroup(*added[i], now);
+            }
+            catch (const ExceptionBase& ex)
+            {
+                MOE_LOG_ERROR("Cannot add target {0}:{1}: {2}", added[i]->ServerAddr, added[i]->ServerPort, ex.GetDescription());
+                ++failed;
+                continue;
+            }
+            m_stTargetGroups.emplace(MakeTargetKey(*added[i]), group);
+            MOE_LOG_INFO("Target {0} {1}:{2} added as id {3} ({4} flow(s) from it)", added[i]->Name, added[i]->ServerAddr,
+                added[i]->ServerPort, group * flows, flows);
+            for (uint32_t k = 0; k < flows; ++k)
+                ScheduleTarget(*m_stTargets[group * flows + k], interval * (i * flows + k) / (added.size() * flows));
+        }
+
+        MOE_LOG_INFO("Targets reloaded, {0} added, {1} removed, {2} unchanged, {3} failed, {4} slot(s)", added.size() - failed,
+            removed, m_stTargetGroups.size() - (added.size() - failed), failed, m_stTargets.size());
+    }
+
+    /**
+     * @brief 每秒检查一次目标文件的修改时间
+     */
+    void CheckTargetFile(Time::Tick now)
+    {
+        if (now < m_ullNextTargetFileCheckTime)
+            return;
+        m_ullNextTargetFileCheckTime = now + kTargetFileCheckInterval;
+
+        struct stat st;
+        if (::stat(m_stConfig.TargetFile.c_str(), &st) != 0)
+            return;
+        if (st.st_mtime == m_stTargetFileStat.st_mtime && st.st_size == m_stTargetFileStat.st_size)
+            return;
+        m_stTargetFileStat = st;
+        MOE_LOG_INFO("Target file {0} changed, reloading", m_stConfig.TargetFile);
+        ReloadTargets();
+    }
+
+#ifndef _WIN32
+    static void OnReloadSignal(uv_signal_t* handle, int)
+    {
+        auto self = static_cast<Client*>(handle->data);
+        if (!self)
+            return;
+
+        MOE_LOG_INFO("SIGHUP received, reloading targets");
+        ::stat(self->m_stConfig.TargetFile.c_str(), &self->m_stTargetFileStat);
+        self->ReloadTargets();
+    }
+#endif
+    uint32_t GetFlowCount()const noexcept { return std::max(m_stConfig.Flows, 1u); }
+    bool IsBurstEnabled()const noexcept { return m_stConfig.Burst > 1; }
+
+    /**
+     * @brief 获取序号为seq的探测包的总长度，未配置尺寸时返回0即不填充
+     */
+    size_t GetPayloadSize(uint32_t seq)const noexcept
+    {
+        const auto& sizes = m_stConfig.PayloadSizes;
+        return sizes.empty() ? 0 : sizes[seq % sizes.size()];
+    }
+
+    /**
+     * @brief 为每个流绑定一个UDP socket
+     *
+     * 指定起始端口时源端口依次递增，重启后每个流仍落在同一条路径上；否则由系统分配。
+     * 按尺寸探测时设置DF，超过路径MTU的包不会被分片后送达。
+     */
+    void CreateFlowSockets(int family)
+    {
+        auto flows = GetFlowCount();
+        if (m_stConfig.FlowBasePort != 0 && m_stConfig.FlowBasePort + flows - 1 > 65535u)
+            MOE_THROW(BadArgumentException, "Flow source ports exceed 65535");
+
+        for (uint32_t k = 0; k < flows; ++k)
+        {
+            auto port = static_cast<uint16_t>(m_stConfig.FlowBasePort == 0 ? 0 : m_stConfig.FlowBasePort + k);
+            auto fd = SocketUtils::CreateBoundSocket(SOCK_DGRAM, family == AF_INET6 ? "::" : "0.0.0.0", port, false);
+            if (!m_stConfig.PayloadSizes.empty())
+            {
+                try
+                {
+                    SocketUtils::SetDontFragment(fd, family);
+                }
+                catch (...)
+                {
+                    ::close(fd);
+                    throw;
+                }
+            }
+
+            sockaddr_storage local;
+            socklen_t localLength = sizeof(local);
+            ::getsockname(fd, reinterpret_cast<sockaddr*>(&local), &localLength);
+            port = ntohs(local.ss_family == AF_INET6 ? reinterpret_cast<sockaddr_in6*>(&local)->sin6_port :
+                reinterpret_cast<sockaddr_in*>(&local)->sin_port);
+            MOE_LOG_INFO("UDP flow {0} uses source port {1}", k, port);
+
+            m_stFlowSockets.emplace_back(UdpSocket::Create());
+            m_stFlowFds.push_back(fd);
+            auto& socket = m_stFlowSockets.back();
+            socket.Open(fd);
+            socket.SetOnDataCallback(bind(&Client::OnUdpData, this, placeholders::_1, placeholders::_2));
+            socket.SetOnErrorCallback([k](int err) {
+                MOE_LOG_ERROR("Udp flow {0} socket error: {1}", k, err);
+            });
+        }
+    }
+
+    void ResetTcpChannel(Target& target, uint32_t index)
+    {
+        auto& channel = target.TcpChannels[index];
+        channel.Socket = TcpSocket::Create();
+        channel.Decoder.Reset();
+        channel.State = STATE_TCP_NOT_CONNECT;
+        channel.Socket.SetOnConnectCallback(bind(&Client::OnTcpConnected, this, std::ref(target), index, placeholders::_1));
+        channel.Socket.SetOnErrorCallback(bind(&Client::OnTcpError, this, std::ref(target), index, placeholders::_1));
+        channel.Socket.SetOnDataCallback(bind(&Client::OnTcpData, this, std::ref(target), index, placeholders::_1));
+        channel.Socket.SetOnEofCallback(bind(&Client::OnTcpDataEof, this, std::ref(target), index));
+    }
+
+    void ConnectTcpChannel(Target& target, uint32_t index)
+    {
+        auto& channel = target.TcpChannels[index];
+        ++m_uConnectingCount;
+        channel.ConnectDeadline = RunLoop::Now() + std::max<Time::Tick>(m_stConfig.PingTimeout,
+            kMinConnectTimeout);
+        channel.ConnectStartTime = HiResClock::Now();
+        channel.State = STATE_TCP_CONNECTING;
+        channel.Socket.Connect(target.ServerEndPoint);
+    }
+
+    /**
+     * @brief 关闭失效的连接并按退避时间安排重连
+     */
+    void OnTcpChannelFailed(Target& target, uint32_t index)
+    {
+        auto& channel = target.TcpChannels[index];
+        auto now = RunLoop::Now();
+        if (channel.State == STATE_TCP_CONNECTED && now - channel.ConnectedTime >= kStableConnectionTime)
+            channel.Backoff.Reset();
+        if (channel.State == STATE_TCP_CONNECTING)
+            --m_uConnectingCount;
+
+        channel.Socket.Close();
+        ResetTcpChannel(target, index);
+        channel.NextTryConnectTime = now + channel.Backoff.Next(m_stRandom);
+        UpdateActiveTcpChannel(target);
+    }
+
+    /**
+     * @brief 当前连接不可用而另一个已连接时切换过去
+     */
+    void UpdateActiveTcpChannel(Target& target)
+    {
+        if (target.TcpChannels[target.ActiveTcpChannel].State == STATE_TCP_CONNECTED || GetTcpChannelCount() < 2)
+            return;
+
+        auto standby = 1 - target.ActiveTcpChannel;
+        if (target.TcpChannels[standby].State != STATE_TCP_CONNECTED)
+            return;
+
+        target.ActiveTcpChannel = standby;
+        ++target.TcpFailovers;
+        MOE_LOG_INFO("Ping server {0} switched to the standby connection", target.ServerAddrString);
+    }
+
+    void WriteTcpFrame(TcpChannel& channel, const PingPacket& packet, size_t paddedLength = 0)
+    {
+        // 帧化后多个探测可以同时在途，不受读回调切分方式的影响
+        auto payload = EncodePacket(packet, paddedLength);
+        if (m_bMdrFormat)
+        {
+            m_stFrameBuffer.clear();
+            TcpFraming::AppendFrame(m_stFrameBuffer, payload.GetBuffer(), payload.GetSize());
+            channel.Socket.Write(ToArrayView<uint8_t>(m_stFrameBuffer));
+            return;
+        }
+
+        // 二进制包已编码在预留的帧头之后，不再拷贝负载
+        TcpFraming::StoreHeader(m_stPacketBuffer.data(), payload.GetSize());
+        channel.Socket.Write(BytesView(m_stPacketBuffer.data(), TcpFraming::kHeaderSize + payload.GetSize()));
     }
 
     void BindUdpEvent()
@@ -192,132 +890,794 @@ protected:
         m_stUdpSocket.SetOnErrorCallback(bind(&Client::OnUdpError, this, placeholders::_1));
     }
 
+    Target* FindTarget(const PingPacket& packet)noexcept
+    {
+        if (packet.TargetId >= m_stTargets.size() || m_stTargets[packet.TargetId]->Retired)
+            return nullptr;
+        return m_stTargets[packet.TargetId].get();
+    }
+
     void OnTick()
     {
+        LoopMonitor::Scope scope(m_pLoopMonitor.get(), LoopMonitor::CALLBACK_TICK);
         auto now = m_stRunLoop.Now();
-        if (m_iTcpChannelState == STATE_TCP_NOT_CONNECT && now >= m_ullNextTryConnectTime)
+
+        // 从上一个tick第一个没有拿到建连名额的目标开始扫描，编号靠前的目标不会总是抢先占用空出的名额
+        auto count = m_stTargets.size();
+        auto start = count == 0 ? 0 : m_uConnectScanStart % count;
+        auto nextStart = start;
+        bool deferred = false;
+        for (size_t n = 0; n < count; ++n)
+        {
+            auto& target = m_stTargets[(start + n) % count];
+            if (target->Retired)
+                continue;
+
+            // 限制同时进行的建连数，未轮到的连接留待下一个tick
+            for (uint32_t i = 0; i < GetTcpChannelCount(); ++i)
+            {
+                auto& channel = target->TcpChannels[i];
+                if (channel.State == STATE_TCP_CONNECTING && now >= channel.ConnectDeadline)
+                {
+                    // 丢弃SYN的目标不能一直占着名额等内核放弃重传
+                    MOE_LOG_ERROR("Connect {0} timed out", target->ServerAddrString);
+                    ++target->TcpConnectFailures;
+                    ++m_stTcpConnectStatistic.Failures;
+                    OnTcpChannelFailed(*target, i);
+                    continue;
+                }
+                if (channel.State != STATE_TCP_NOT_CONNECT || now < channel.NextTryConnectTime)
+                    continue;
+
+                if (m_stConfig.MaxConnecting == 0 || m_uConnectingCount < m_stConfig.MaxConnecting)
+                {
+                    ConnectTcpChannel(*target, i);
+                }
+                else if (!deferred)
+                {
+                    deferred = true;
+                    nextStart = (start + n) % count;
+                }
+            }
+
+            // 备用连接上没有探测，定期发送保活包以免被服务端当作空闲连接回收
+            auto& standby = target->TcpChannels[1 - target->ActiveTcpChannel];
+            if (m_stConfig.TcpStandby && standby.State == STATE_TCP_CONNECTED && now >= target->NextKeepAliveTime)
+            {
+                target->NextKeepAliveTime = now + kStandbyKeepAliveInterval;
+                PingPacket packet {};
+                packet.TargetId = kKeepAliveTargetId;
+                WriteTcpFrame(standby, packet);
+            }
+        }
+        m_uConnectScanStart = nextStart;
+
+        if (m_pSampleLog && now >= m_ullNextSampleFlushTime)
         {
-            m_stTcpSocket.Connect(m_stServerEndPoint);
-            m_iTcpChannelState = STATE_TCP_CONNECTING;
+            // 限制样本落盘的延迟
+            m_ullNextSampleFlushTime = now + 1000;
+            m_pSampleLog->Flush();
         }
 
-        auto tcpPacket = m_stTcpPinger.Update(now);
-        auto udpPacket = m_stUdpPinger.Update(now);
+        if (m_stConfig.WatchTargets && !m_stConfig.TargetFile.empty())
+            CheckTargetFile(now);
 
-        if (m_iTcpChannelState == STATE_TCP_CONNECTED && tcpPacket)
+        if (now >= m_ullNextPintStatTime)
         {
-            m_stBuffer.clear();
-            Mdr::WriteStruct(*tcpPacket, m_stBuffer);
-            m_stTcpSocket.Write(ToArrayView<uint8_t>(m_stBuffer));
+            m_ullNextPintStatTime = now + m_stConfig.ReportInterval * 1000ull;
+            PublishReport(now);
         }
+    }
 
-        if (udpPacket)
+    /**
+     * @brief 收集本周期的统计写入快照并开始新的周期
+     *
+     * 只做定长拷贝，格式化和写出由报告线程完成。
+     */
+    void PublishReport(Time::Tick now)
+    {
+        auto& snapshot = m_pReportBuffer->GetBack();
+        snapshot.Seq = ++m_ullReportSeq;
+        if (snapshot.Targets.size() < m_stTargets.size())
+            snapshot.Targets.resize(m_stTargets.size());
+        for (size_t i = 0; i < m_stTargets.size(); ++i)
         {
-            m_stBuffer.clear();
-            Mdr::WriteStruct(*udpPacket, m_stBuffer);
-            m_stUdpSocket.Send(m_stServerEndPoint, ToArrayView<uint8_t>(m_stBuffer));
+            auto& target = *m_stTargets[i];
+            auto& report = snapshot.Targets[i];
+            report.Active = !target.Retired;
+            if (!report.Active)
+                continue;
+            if (report.Generation != target.Generation)
+                PrepareTargetReport(report, target);
+            report.Flow = target.Flow;
+            FillChannelReport(report.Tcp, target.TcpPinger, now);
+            FillChannelReport(report.Udp, target.UdpPinger, now);
+            target.TcpPinger.ResetStatistic();
+            target.UdpPinger.ResetStatistic();
         }
 
-        if (now >= m_ullNextPintStatTime)
+        snapshot.TcpScheduler = m_stTcpScheduler.GetStatistic();
+        snapshot.UdpScheduler = m_stUdpScheduler.GetStatistic();
+        m_stTcpScheduler.ResetStatistic();
+        m_stUdpScheduler.ResetStatistic();
+        snapshot.TcpConnect = m_stTcpConnectStatistic;
+        m_stTcpConnectStatistic = TcpConnectStatistic();
+
+        snapshot.MalformedPackets = m_ullMalformedPacketCount - m_ullLastMalformedPacketCount;
+        m_ullLastMalformedPacketCount = m_ullMalformedPacketCount;
+        snapshot.TruncatedPackets = m_ullTruncatedPacketCount - m_ullLastTruncatedPacketCount;
+        m_ullLastTruncatedPacketCount = m_ullTruncatedPacketCount;
+        snapshot.SampleCount = m_pSampleLog ? m_pSampleLog->GetSampleCount() : 0;
+        snapshot.SampleDropCount = m_pSampleLog ? m_pSampleLog->GetDropCount() : 0;
+        snapshot.HasLoop = m_pLoopMonitor != nullptr;
+        if (m_pLoopMonitor)
         {
-            m_ullNextPintStatTime = now + 60 * 1000;
+            m_stLastLoopStatistic = m_pLoopMonitor->Collect();
+            snapshot.Loop = m_stLastLoopStatistic;
+        }
+        m_pReportBuffer->Publish();
+    }
 
-            auto tcpStat = m_stTcpPinger.GetStatistic();
-            auto udpStat = m_stUdpPinger.GetStatistic();
+    /**
+     * @brief 按目标初始化快照中的槽位，只在目标创建后的首次发布时发生分配
+     */
+    void PrepareTargetReport(TargetReport& report, const Target& target)
+    {
+        report.Active = !target.Retired;
+        report.Generation = target.Generation;
+        report.Name = target.Name;
+        for (auto channel : { &report.Tcp, &report.Udp })
+        {
+            channel->Windows.resize(m_stConfig.Windows.size());
+            channel->Sizes.resize(m_stConfig.PayloadSizes.size());
+        }
+    }
+
+    static void FillChannelReport(ChannelReport& report, Pinger& pinger, Time::Tick now)
+    {
+        report.Ping = pinger.GetStatistic();
+        for (size_t i = 0; i < pinger.GetWindowCount(); ++i)
+            report.Windows[i] = pinger.GetWindowStatistic(i, now);
+        report.HasOneWay = pinger.GetOneWayDelay() != nullptr;
+        if (report.HasOneWay)
+            report.OneWay = pinger.GetOneWayDelay()->GetStatistic();
+        for (size_t i = 0; i < pinger.GetSizeBucketCount(); ++i)
+            report.Sizes[i] = pinger.GetSizeBucketStatistic(i);
+        report.HasBurst = pinger.GetBurst() != nullptr;
+        if (report.HasBurst)
+            report.Burst = pinger.GetBurst()->GetStatistic();
+    }
 
-            auto total = tcpStat.PacketLost + tcpStat.AvailablePacket;
-            MOE_LOG_INFO("TCP PING, Packet loss {0}/{1} ({2:F2}%), avg {3:F2}ms, max {4}ms, min {5}ms", tcpStat.PacketLost,
-                total, total == 0 ? 0 : 100. * tcpStat.PacketLost / total,
-                tcpStat.AvailablePacket == 0 ? 0 : static_cast<double>(tcpStat.LatencyTotal / tcpStat.AvailablePacket),
-                tcpStat.MaxLatency, tcpStat.MinLatency);
-            if (m_pSink)
+    /**
+     * @brief 报告线程
+     *
+     * 定期取走最新的快照，合并多流结果后格式化输出。同时也是m_pStatSink唯一的生产者。
+     */
+    void ReporterMain()
+    {
+        uint64_t lastSeq = 0;
+        while (true)
+        {
+            if (m_pReportBuffer->Consume())
             {
-                m_pSink->Log(Logging::Level::Info, Logging::Context(__FILE__, __LINE__, __FUNCTION__), StringUtils::Format(
-                    "TCP|{0}|{1}|{2:F2}%|{3:F2}|{4}|{5}", tcpStat.PacketLost, total, total == 0 ? 0 : 100. * tcpStat.PacketLost / total,
-                    tcpStat.AvailablePacket == 0 ? 0 : static_cast<double>(tcpStat.LatencyTotal / tcpStat.AvailablePacket),
-                    tcpStat.MaxLatency, tcpStat.MinLatency).c_str());
+                const auto& snapshot = m_pReportBuffer->GetFront();
+                if (snapshot.Seq != lastSeq + 1)
+                    MOE_LOG_WARN("Reporter fell behind, {0} report(s) skipped", snapshot.Seq - lastSeq - 1);
+                lastSeq = snapshot.Seq;
+                try
+                {
+                    Report(snapshot);
+                }
+                catch (const ExceptionBase& ex)
+                {
+                    MOE_LOG_EXCEPTION(ex);
+                }
             }
 
-            total = udpStat.PacketLost + udpStat.AvailablePacket;
-            MOE_LOG_INFO("UDP PING, Packet loss {0}/{1} ({2:F2}%), avg {3:F2}ms, max {4}ms, min {5}ms", udpStat.PacketLost,
-                total, total == 0 ? 0 : 100. * udpStat.PacketLost / total,
-                udpStat.AvailablePacket == 0 ? 0 : static_cast<double>(udpStat.LatencyTotal / udpStat.AvailablePacket),
-                udpStat.MaxLatency, udpStat.MinLatency);
-            if (m_pSink)
+            std::unique_lock<std::mutex> lock(m_stReporterMutex);
+            if (m_bReporterStopping)
+                break;
+            m_stReporterCondition.wait_for(lock, std::chrono::milliseconds(static_cast<int64_t>(kReporterPollIntervalMs)));
+        }
+    }
+
+    void Report(const ReportSnapshot& snapshot)
+    {
+        for (const auto& target : snapshot.Targets)
+        {
+            if (!target.Active)
+                continue;
+            LogStatistic(target, "TCP", target.Tcp.Ping);
+            LogStatistic(target, "UDP", target.Udp.Ping);
+            for (size_t i = 0; i < target.Tcp.Windows.size(); ++i)
+            {
+                LogWindowStatistic(target, "TCP", target.Tcp.Windows[i]);
+                LogWindowStatistic(target, "UDP", target.Udp.Windows[i]);
+            }
+            if (target.Tcp.HasOneWay)
+                LogOneWayStatistic(target, "TCP", target.Tcp.OneWay);
+            if (target.Udp.HasOneWay)
+                LogOneWayStatistic(target, "UDP", target.Udp.OneWay);
+            if (target.Udp.HasBurst)
+                LogBurstStatistic(target, "UDP", target.Udp.Burst);
+            for (size_t i = 0; i < target.Tcp.Sizes.size(); ++i)
             {
-                m_pSink->Log(Logging::Level::Info, Logging::Context(__FILE__, __LINE__, __FUNCTION__), StringUtils::Format(
-                    "UDP|{0}|{1}|{2:F2}%|{3:F2}|{4}|{5}", udpStat.PacketLost, total, total == 0 ? 0 : 100. * udpStat.PacketLost / total,
-                    udpStat.AvailablePacket == 0 ? 0 : static_cast<double>(udpStat.LatencyTotal / udpStat.AvailablePacket),
-                    udpStat.MaxLatency, udpStat.MinLatency).c_str());
+                LogSizeStatistic(target, "TCP", m_stConfig.PayloadSizes[i], target.Tcp.Sizes[i]);
+                LogSizeStatistic(target, "UDP", m_stConfig.PayloadSizes[i], target.Udp.Sizes[i]);
             }
+        }
+        if (GetFlowCount() > 1)
+        {
+            for (size_t i = 0; i < snapshot.Targets.size(); i += GetFlowCount())
+            {
+                if (!snapshot.Targets[i].Active)
+                    continue;
+                LogFlowSummary(snapshot, i, "TCP", &TargetReport::Tcp);
+                LogFlowSummary(snapshot, i, "UDP", &TargetReport::Udp);
+            }
+        }
+
+        LogSchedulerStatistic("TCP", snapshot.TcpScheduler);
+        const auto& connect = snapshot.TcpConnect;
+        if (connect.Count != 0 || connect.Failures != 0)
+        {
+            MOE_LOG_INFO("TCP connects {0}, failed {1}, latency avg {2:F2}ms, max {3:F2}ms", connect.Count,
+                connect.Failures, connect.Count == 0 ? 0. : connect.LatencyTotal / 1000. / connect.Count,
+                connect.MaxLatency / 1000.);
+        }
+        LogSchedulerStatistic("UDP", snapshot.UdpScheduler);
 
-            m_stTcpPinger.Reset();
-            m_stUdpPinger.Reset();
+        if (m_pStatSink)
+        {
+            MOE_LOG_INFO("Stat sink queue depth {0}/{1}, dropped {2}", m_pStatSink->GetDepth(),
+                m_pStatSink->GetCapacity(), m_pStatSink->GetDropCount());
         }
+
+        if (m_pSampleLog)
+            MOE_LOG_INFO("Sample log {0} samples, dropped {1}", snapshot.SampleCount, snapshot.SampleDropCount);
+
+        if (snapshot.MalformedPackets != 0)
+            MOE_LOG_ERROR("Dropped {0} malformed packet(s)", snapshot.MalformedPackets);
+        if (snapshot.TruncatedPackets != 0)
+            MOE_LOG_WARN("Dropped {0} truncated packet(s)", snapshot.TruncatedPackets);
+
+        if (snapshot.HasLoop)
+            LoopMonitor::Log("Client", snapshot.Loop);
     }
 
-    void OnTcpConnected(int err)
+    void OnTcpProbe(uint32_t id)
     {
-        if (err == 0)
+        auto& target = *m_stTcpProbeTargets[id];
+        auto packet = target.TcpPinger.Send(RunLoop::Now(), GetTcpClock());
+        packet.TargetId = target.Id;
+
+        // 没有可用连接时探测照常计入，超时后记为丢失
+        auto& channel = target.TcpChannels[target.ActiveTcpChannel];
+        if (channel.State == STATE_TCP_CONNECTED)
+            WriteTcpFrame(channel, packet, GetPayloadSize(packet.Seq));
+    }
+
+    void OnUdpProbe(uint32_t id)
+    {
+        auto& target = *m_stUdpProbeTargets[id];
+        if (IsBurstEnabled())
         {
-            MOE_LOG_INFO("Ping server connected");
-            m_iTcpChannelState = STATE_TCP_CONNECTED;
-            m_stTcpPinger.Reset();
+            SendUdpBurst(target);
+            return;
+        }
 
-            m_stTcpSocket.StartRead();
+        auto packet = target.UdpPinger.Send(RunLoop::Now(), GetUdpClock());
+        packet.TargetId = target.Id;
+
+        auto payload = EncodePacket(packet, GetPayloadSize(packet.Seq));
+        if (!m_stConfig.PayloadSizes.empty())
+        {
+            SendFlowUdpProbe(target, packet.Seq, payload);
+            return;
         }
-        else
+        if (!m_stFlowSockets.empty())
+        {
+            m_stFlowSockets[target.Flow].Send(target.ServerEndPoint, payload);
+            return;
+        }
+#ifdef HAVE_IO_URING
+        if (m_pUdpRing)
+        {
+            // 槽位耗尽时探测照常计入，超时后记为丢失
+            m_pUdpRing->Send(reinterpret_cast<const sockaddr*>(&target.ServerAddr), target.ServerAddrLength,
+                payload.GetBuffer(), payload.GetSize());
+            return;
+        }
+#endif
+#ifdef __linux__
+        if (m_pTimestampedUdpSocket)
+        {
+            m_pTimestampedUdpSocket->Send(reinterpret_cast<const sockaddr*>(&target.ServerAddr), target.ServerAddrLength,
+                payload);
+            return;
+        }
+#endif
+        m_stUdpSocket.Send(target.ServerEndPoint, payload);
+    }
+
+    /**
+     * @brief 连续发送一组探测
+     *
+     * Linux下整组经一次sendmmsg提交，组内探测共用同一个发送时间戳，回包照常经序号环逐个匹配。
+     */
+    void SendUdpBurst(Target& target)
+    {
+        auto now = RunLoop::Now();
+        auto clock = GetUdpClock();
+#ifdef __linux__
+        auto& batch = *m_pUdpBurst;
+        auto firstSeq = 0u;
+        for (uint32_t i = 0; i < m_stConfig.Burst; ++i)
         {
-            MOE_LOG_ERROR("Connect failed, err {0}", err);
-            m_ullNextTryConnectTime = RunLoop::Now() + 10 * 1000;
-            m_iTcpChannelState = STATE_TCP_NOT_CONNECT;
+            auto packet = target.UdpPinger.Send(now, clock);
+            packet.TargetId = target.Id;
+            if (i == 0)
+                firstSeq = packet.Seq;
+
+            // 各槽位的填充区在构造时清零，编码只覆盖包头
+            auto length = PingPacketCodec::Encode(packet, batch.GetData(i), m_stConfig.ServerTimestamps,
+                GetPayloadSize(packet.Seq));
+            batch.SetLength(i, length);
+            batch.SetAddress(i, reinterpret_cast<const sockaddr*>(&target.ServerAddr), target.ServerAddrLength);
         }
+        batch.Send(m_stFlowFds[target.Flow], m_stConfig.Burst, [&](size_t index, int err) {
+            OnFlowSendError(target, firstSeq + static_cast<uint32_t>(index), err);
+        });
+#else
+        for (uint32_t i = 0; i < m_stConfig.Burst; ++i)
+        {
+            auto packet = target.UdpPinger.Send(now, clock);
+            packet.TargetId = target.Id;
+            SendFlowUdpProbe(target, packet.Seq, EncodePacket(packet, GetPayloadSize(packet.Seq)));
+        }
+#endif
     }
 
-    void OnTcpError(int err)
+    /**
+     * @brief 直接在流socket上发送探测
+     *
+     * 绕过UdpSocket，本地以EMSGSIZE拒绝的超长包计入对应尺寸的发送错误而不会被当作socket故障。
+     */
+    void SendFlowUdpProbe(Target& target, uint32_t seq, BytesView payload)
     {
-        MOE_LOG_ERROR("Tcp socket error: {0}", err);
+        auto ret = ::sendto(m_stFlowFds[target.Flow], reinterpret_cast<const char*>(payload.GetBuffer()), payload.GetSize(), 0,
+            reinterpret_cast<const sockaddr*>(&target.ServerAddr), target.ServerAddrLength);
+        if (ret < 0)
+            OnFlowSendError(target, seq, errno);
+    }
 
-        // 创建新的Socket
-        m_stTcpSocket = TcpSocket::Create();
-        m_iTcpChannelState = STATE_TCP_NOT_CONNECT;
-        m_ullNextTryConnectTime = RunLoop::Now() + 10 * 1000;
-        BindTcpEvent();
+    /**
+     * @brief 发送失败的探测照常计入，超时后记为丢失
+     */
+    void OnFlowSendError(Target& target, uint32_t seq, int err)
+    {
+        target.UdpPinger.RecordSendError(seq);
+        if (err != EMSGSIZE && err != EAGAIN && err != EWOULDBLOCK)
+            MOE_LOG_ERROR("Udp flow {0} send to {1} failed, errno {2}", target.Flow, target.ServerAddrString, err);
+    }
+
+    /**
+     * @brief 按配置的格式编码，返回的数据在下一次编码前有效
+     * @param paddedLength 二进制格式下填充后的总长度，0表示不填充
+     */
+    BytesView EncodePacket(const PingPacket& packet, size_t paddedLength = 0)
+    {
+        if (m_bMdrFormat)
+        {
+            m_stBuffer.clear();
+            Mdr::WriteStruct(packet, m_stBuffer);
+            return ToArrayView<uint8_t>(m_stBuffer);
+        }
+        auto out = m_stPacketBuffer.data() + TcpFraming::kHeaderSize;
+        return BytesView(out, PingPacketCodec::Encode(packet, out, m_stConfig.ServerTimestamps, paddedLength));
     }
 
-    void OnTcpData(BytesView data)
+    /**
+     * @brief 按Magic识别格式并解码
+     *
+     * 回包的格式与发包一致，二进制格式走无异常的快速路径。
+     */
+    bool DecodePacket(BytesView data, PingPacket& packet)
     {
+        switch (PingPacketCodec::Decode(data.GetBuffer(), data.GetSize(), packet))
+        {
+            case PingPacketCodec::DecodeResult::Ok:
+                // 路径上被截断的填充包不计入时延，超时后记为该尺寸的丢失
+                if (data.GetSize() < PingPacketCodec::GetPaddedLength(data.GetBuffer(), data.GetSize()))
+                {
+                    ++m_ullTruncatedPacketCount;
+                    return false;
+                }
+                return true;
+            case PingPacketCodec::DecodeResult::NotBinary:
+                break;
+            default:
+                ++m_ullMalformedPacketCount;
+                return false;
+        }
+
         try
         {
-            PingPacket packet {};
+            packet = PingPacket();
             Mdr::ReadStruct(packet, data);
-            m_stTcpPinger.Recv(packet);
+            return true;
         }
         catch (const ExceptionBase& ex)
         {
+            ++m_ullMalformedPacketCount;
             MOE_LOG_EXCEPTION(ex);
+            return false;
         }
     }
 
-    void OnTcpDataEof()
+    /**
+     * @brief 渲染指标
+     *
+     * 只读取累计计数和滑动窗口，开销与目标数和桶数成正比，与样本数无关。
+     */
+    void RenderMetrics(std::string& out)
     {
-        MOE_LOG_ERROR("Tcp socket: remote EOF");
-        m_stTcpSocket.Close();
+        static const char* const kChannels[] = { "tcp", "udp" };
 
-        // 创建新的Socket
-        m_stTcpSocket = TcpSocket::Create();
-        m_iTcpChannelState = STATE_TCP_NOT_CONNECT;
-        m_ullNextTryConnectTime = RunLoop::Now() + 10 * 1000;
-        BindTcpEvent();
+        auto now = RunLoop::Now();
+        Metrics::TextWriter writer(out);
+        std::string labels;
+        auto forEachPinger = [&](const std::function<void(const Target&, const Pinger&)>& callback) {
+            for (const auto& target : m_stTargets)
+            {
+                if (target->Retired)
+                    continue;
+                for (size_t i = 0; i < 2; ++i)
+                {
+                    labels = target->MetricLabels;
+                    Metrics::AppendLabel(labels, "proto", kChannels[i]);
+                    callback(*target, i == 0 ? target->TcpPinger : target->UdpPinger);
+                }
+            }
+        };
+
+        writer.Declare("ping_client_probes_sent_total", "counter", "Probes sent");
+        forEachPinger([&](const Target&, const Pinger& pinger) {
+            writer.Sample("ping_client_probes_sent_total", labels, pinger.GetCounters().Sent);
+        });
+        writer.Declare("ping_client_probes_lost_total", "counter", "Probes timed out");
+        forEachPinger([&](const Target&, const Pinger& pinger) {
+            writer.Sample("ping_client_probes_lost_total", labels, pinger.GetCounters().Lost);
+        });
+        writer.Declare("ping_client_rtt_seconds", "histogram", "Round trip time of answered probes");
+        forEachPinger([&](const Target&, const Pinger& pinger) {
+            writer.Histogram("ping_client_rtt_seconds", labels, pinger.GetCounters().Latency);
+        });
+
+        if (!m_stConfig.Windows.empty())
+        {
+            writer.Declare("ping_client_window_loss_ratio", "gauge", "Probe loss ratio over the sliding window");
+            forEachPinger([&](const Target&, const Pinger& pinger) {
+                auto base = labels;
+                for (size_t i = 0; i < pinger.GetWindowCount(); ++i)
+                {
+                    auto stat = pinger.GetWindowStatistic(i, now);
+                    auto total = stat.Lost + stat.Received;
+                    labels = base;
+                    Metrics::AppendLabel(labels, "window", StringUtils::Format("{0}s", stat.Window / 1000).c_str());
+                    writer.Sample("ping_client_window_loss_ratio", labels, total == 0 ? 0. :
+                        static_cast<double>(stat.Lost) / total);
+                }
+            });
+        }
+
+        writer.Declare("ping_client_tcp_connected", "gauge", "Whether the TCP probe channel is connected");
+        for (const auto& target : m_stTargets)
+        {
+            if (target->Retired)
+                continue;
+            writer.Sample("ping_client_tcp_connected", target->MetricLabels,
+                static_cast<uint64_t>(target->TcpChannels[target->ActiveTcpChannel].State == STATE_TCP_CONNECTED ? 1 : 0));
+        }
+
+        writer.Declare("ping_client_tcp_connect_seconds", "histogram", "TCP handshake time");
+        for (const auto& target : m_stTargets)
+        {
+            if (!target->Retired)
+                writer.Histogram("ping_client_tcp_connect_seconds", target->MetricLabels, target->TcpConnectLatency);
+        }
+        writer.Declare("ping_client_tcp_connect_failures_total", "counter", "Failed TCP connection attempts");
+        for (const auto& target : m_stTargets)
+        {
+            if (!target->Retired)
+                writer.Sample("ping_client_tcp_connect_failures_total", target->MetricLabels, target->TcpConnectFailures);
+        }
+        writer.Declare("ping_client_tcp_failovers_total", "counter", "Switches to the standby TCP connection");
+        for (const auto& target : m_stTargets)
+        {
+            if (!target->Retired)
+                writer.Sample("ping_client_tcp_failovers_total", target->MetricLabels, target->TcpFailovers);
+        }
+
+        writer.Declare("ping_client_malformed_packets_total", "counter", "Replies that failed to decode");
+        writer.Sample("ping_client_malformed_packets_total", string(), m_ullMalformedPacketCount);
+
+        if (m_pLoopMonitor)
+        {
+            LoopMonitor::RenderMetrics(writer, "ping_client", [this](const std::function<void(const std::string&,
+                const LoopMonitor::Statistic&)>& callback) { callback(string(), m_stLastLoopStatistic); });
+        }
     }
 
-    void OnUdpData(const EndPoint&, BytesView data)
+    void LogSchedulerStatistic(const char* name, const ProbeSchedulerStatistic& stat)
+    {
+        MOE_LOG_INFO("{0} scheduler, probes {1}, drift avg {2:F1}us, max {3:F1}us, missed {4}", name, stat.FireCount,
+            stat.FireCount == 0 ? 0. : stat.DriftTotal / 1000. / stat.FireCount, stat.MaxDrift / 1000., stat.MissedCount);
+    }
+
+    void LogStatistic(const TargetReport& target, const char* channel, const PingStatistic& stat)
+    {
+        // 多目标模式下以目标名作为前缀，文件输出中单独成列
+        auto name = target.Name.empty() ? string(channel) : target.Name + " " + channel;
+
+        auto total = stat.PacketLost + stat.AvailablePacket;
+        auto lossRate = total == 0 ? 0 : 100. * stat.PacketLost / total;
+        if (IsHiRes(m_stConfig))
+        {
+            auto avg = stat.AvailablePacket == 0 ? 0 : static_cast<double>(stat.LatencyTotal) / stat.AvailablePacket;
+            MOE_LOG_INFO("{0} PING, Packet loss {1}/{2} ({3:F2}%), avg {4:F2}us, max {5}us, min {6}us, p50 {7}us, p90 {8}us, "
+                "p99 {9}us, p99.9 {10}us", name, stat.PacketLost, total, lossRate, avg, stat.MaxLatency, stat.MinLatency,
+                stat.P50Latency, stat.P90Latency, stat.P99Latency, stat.P999Latency);
+        }
+        else
+        {
+            // 默认输出毫秒，分位数附加在原有字段之后
+            auto avg = stat.AvailablePacket == 0 ? 0 : static_cast<double>(stat.LatencyTotal / 1000 / stat.AvailablePacket);
+            MOE_LOG_INFO("{0} PING, Packet loss {1}/{2} ({3:F2}%), avg {4:F2}ms, max {5}ms, min {6}ms, p50 {7}ms, p90 {8}ms, "
+                "p99 {9}ms, p99.9 {10}ms", name, stat.PacketLost, total, lossRate, avg, stat.MaxLatency / 1000,
+                stat.MinLatency / 1000, stat.P50Latency / 1000, stat.P90Latency / 1000, stat.P99Latency / 1000,
+                stat.P999Latency / 1000);
+        }
+
+        if (m_pStatSink)
+        {
+            StatRecord record;
+            record.Kind = StatRecord::KIND_PING;
+            record.HiRes = IsHiRes(m_stConfig);
+            FillStatRecordName(record, target, channel);
+            record.Ping = stat;
+            m_pStatSink->Push(record);
+        }
+    }
+
+    /**
+     * @brief 汇总同一目标各个流的本周期统计，指出丢包最多和时延最高的流
+     * @param begin 该目标第一个流在快照中的下标
+     */
+    void LogFlowSummary(const ReportSnapshot& snapshot, size_t begin, const char* channel, ChannelReport TargetReport::* report)
+    {
+        uint64_t lost = 0, total = 0;
+        double worstLossRate = -1, maxAvg = -1, minAvg = -1;
+        uint32_t worstLossFlow = 0, slowestFlow = 0, fastestFlow = 0;
+        for (size_t i = begin; i < begin + GetFlowCount(); ++i)
+        {
+            const auto& target = snapshot.Targets[i];
+            const auto& stat = (target.*report).Ping;
+            auto count = stat.PacketLost + stat.AvailablePacket;
+            lost += stat.PacketLost;
+            total += count;
+
+            auto lossRate = count == 0 ? 0 : 100. * stat.PacketLost / count;
+            if (lossRate > worstLossRate)
+            {
+                worstLossRate = lossRate;
+                worstLossFlow = target.Flow;
+            }
+            if (stat.AvailablePacket == 0)
+                continue;
+            auto avg = static_cast<double>(stat.LatencyTotal) / stat.AvailablePacket;
+            if (avg > maxAvg)
+            {
+                maxAvg = avg;
+                slowestFlow = target.Flow;
+            }
+            if (minAvg < 0 || avg < minAvg)
+            {
+                minAvg = avg;
+                fastestFlow = target.Flow;
+            }
+        }
+
+        const auto& name = snapshot.Targets[begin].Name;
+        auto prefix = name.substr(0, name.rfind('#'));
+        auto unit = IsHiRes(m_stConfig) ? 1. : 1000.;
+        MOE_LOG_INFO("{0} {1} FLOWS {2}, Packet loss {3}/{4} ({5:F2}%), worst loss flow #{6} ({7:F2}%), "
+            "avg rtt flow #{8} {9:F2}{10} .. flow #{11} {12:F2}{10}", prefix, channel, GetFlowCount(), lost, total,
+            total == 0 ? 0. : 100. * lost / total, worstLossFlow, std::max(worstLossRate, 0.), fastestFlow,
+            std::max(minAvg, 0.) / unit, IsHiRes(m_stConfig) ? "us" : "ms", slowestFlow, std::max(maxAvg, 0.) / unit);
+    }
+
+    void LogWindowStatistic(const TargetReport& target, const char* channel, const SlidingWindowStatistic& stat)
+    {
+        auto name = target.Name.empty() ? string(channel) : target.Name + " " + channel;
+
+        auto total = stat.Lost + stat.Received;
+        auto lossRate = total == 0 ? 0 : 100. * stat.Lost / total;
+        auto avg = stat.Received == 0 ? 0 : static_cast<double>(stat.LatencyTotal) / stat.Received;
+        if (IsHiRes(m_stConfig))
+        {
+            MOE_LOG_INFO("{0} WINDOW {1}s, Packet loss {2}/{3} ({4:F2}%), avg {5:F2}us, max {6}us, min {7}us", name,
+                stat.Window / 1000, stat.Lost, total, lossRate, avg, stat.MaxLatency, stat.MinLatency);
+        }
+        else
+        {
+            MOE_LOG_INFO("{0} WINDOW {1}s, Packet loss {2}/{3} ({4:F2}%), avg {5:F2}ms, max {6}ms, min {7}ms", name,
+                stat.Window / 1000, stat.Lost, total, lossRate, avg / 1000, stat.MaxLatency / 1000, stat.MinLatency / 1000);
+        }
+
+        if (m_pStatSink)
+        {
+            StatRecord record;
+            record.Kind = StatRecord::KIND_WINDOW;
+            record.HiRes = IsHiRes(m_stConfig);
+            FillStatRecordName(record, target, channel);
+            record.Window = stat;
+            m_pStatSink->Push(record);
+        }
+    }
+
+    void LogSizeStatistic(const TargetReport& target, const char* channel, uint32_t bytes, const SizeBucketStatistic& stat)
+    {
+        auto name = target.Name.empty() ? string(channel) : target.Name + " " + channel;
+
+        auto total = stat.PacketLost + stat.AvailablePacket;
+        auto lossRate = total == 0 ? 0 : 100. * stat.PacketLost / total;
+        auto avg = stat.AvailablePacket == 0 ? 0 : static_cast<double>(stat.LatencyTotal) / stat.AvailablePacket;
+        if (IsHiRes(m_stConfig))
+        {
+            MOE_LOG_INFO("{0} SIZE {1}B, Packet loss {2}/{3} ({4:F2}%), avg {5:F2}us, max {6}us, min {7}us, send errors {8}",
+                name, bytes, stat.PacketLost, total, lossRate, avg, stat.MaxLatency, stat.MinLatency, stat.SendError);
+        }
+        else
+        {
+            MOE_LOG_INFO("{0} SIZE {1}B, Packet loss {2}/{3} ({4:F2}%), avg {5:F2}ms, max {6}ms, min {7}ms, send errors {8}",
+                name, bytes, stat.PacketLost, total, lossRate, avg / 1000, stat.MaxLatency / 1000, stat.MinLatency / 1000,
+                stat.SendError);
+        }
+
+        if (m_pStatSink)
+        {
+            StatRecord record;
+            record.Kind = StatRecord::KIND_SIZE;
+            record.HiRes = IsHiRes(m_stConfig);
+            FillStatRecordName(record, target, channel);
+            record.Size.Bytes = bytes;
+            record.Size.Stat = stat;
+            m_pStatSink->Push(record);
+        }
+    }
+
+    void LogBurstStatistic(const TargetReport& target, const char* channel, const BurstStatistic& stat)
+    {
+        auto name = target.Name.empty() ? string(channel) : target.Name + " " + channel;
+
+        auto scale = IsHiRes(m_stConfig) ? 1u : 1000u;
+        auto unit = IsHiRes(m_stConfig) ? "us" : "ms";
+        auto lossyRate = stat.BurstCount == 0 ? 0 : 100. * stat.LossyBurstCount / stat.BurstCount;
+        MOE_LOG_INFO("{0} BURST x{1}, bursts {2}, lossy {3} ({4:F2}%), fully lost {5}, max loss {6}, jitter {7}{8} "
+            "max {9}{8}, reordered {10} max distance {11}", name, m_stConfig.Burst, stat.BurstCount, stat.LossyBurstCount,
+            lossyRate, stat.FullLossBurstCount, stat.MaxBurstLoss, stat.Jitter / scale, unit, stat.MaxJitter / scale,
+            stat.Reordered, stat.MaxReorderDistance);
+
+        if (m_pStatSink)
+        {
+            StatRecord record;
+            record.Kind = StatRecord::KIND_BURST;
+            record.HiRes = IsHiRes(m_stConfig);
+            FillStatRecordName(record, target, channel);
+            record.Burst = stat;
+            m_pStatSink->Push(record);
+        }
+    }
+
+    void LogOneWayStatistic(const TargetReport& target, const char* channel, const OneWayDelayStatistic& stat)
+    {
+        auto name = target.Name.empty() ? string(channel) : target.Name + " " + channel;
+
+        auto count = std::max<uint32_t>(stat.Count, 1);
+        MOE_LOG_INFO("{0} ONE-WAY, samples {1}, clock offset {2:F1}us, forward avg {3:F2}us p99 {4}us max {5}us, "
+            "reverse avg {6:F2}us p99 {7}us max {8}us, server dwell avg {9:F2}us p99 {10}us max {11}us", name, stat.Count,
+            stat.ClockOffset / 1000., static_cast<double>(stat.ForwardTotal) / count, stat.ForwardP99, stat.ForwardMax,
+            static_cast<double>(stat.ReverseTotal) / count, stat.ReverseP99, stat.ReverseMax,
+            static_cast<double>(stat.DwellTotal) / count, stat.DwellP99, stat.DwellMax);
+
+        if (m_pStatSink)
+        {
+            StatRecord record;
+            record.Kind = StatRecord::KIND_ONE_WAY;
+            record.HiRes = true;
+            FillStatRecordName(record, target, channel);
+            record.OneWay = stat;
+            m_pStatSink->Push(record);
+        }
+    }
+
+    static void FillStatRecordName(StatRecord& record, const TargetReport& target, const char* channel)noexcept
+    {
+        if (target.Name.empty())
+            ::snprintf(record.Name, sizeof(record.Name), "%s", channel);
+        else
+            ::snprintf(record.Name, sizeof(record.Name), "%s|%s", target.Name.c_str(), channel);
+    }
+
+    /**
+     * @brief 在写出线程上格式化并写入统计记录
+     */
+    void WriteStatRecord(const StatRecord& record)
     {
         try
         {
-            PingPacket packet {};
-            Mdr::ReadStruct(packet, data);
-            m_stUdpPinger.Recv(packet);
+            string line;
+            if (record.Kind == StatRecord::KIND_ONE_WAY)
+            {
+                const auto& stat = record.OneWay;
+                auto count = std::max<uint32_t>(stat.Count, 1);
+                line = StringUtils::Format("{0}|OWD|{1}|{2:F1}|{3:F2}|{4}|{5}|{6:F2}|{7}|{8}|{9:F2}|{10}|{11}", record.Name,
+                    stat.Count, stat.ClockOffset / 1000., static_cast<double>(stat.ForwardTotal) / count, stat.ForwardP99,
+                    stat.ForwardMax, static_cast<double>(stat.ReverseTotal) / count, stat.ReverseP99, stat.ReverseMax,
+                    static_cast<double>(stat.DwellTotal) / count, stat.DwellP99, stat.DwellMax);
+            }
+            else if (record.Kind == StatRecord::KIND_SIZE)
+            {
+                const auto& stat = record.Size.Stat;
+                auto total = stat.PacketLost + stat.AvailablePacket;
+                auto lossRate = total == 0 ? 0 : 100. * stat.PacketLost / total;
+                auto avg = stat.AvailablePacket == 0 ? 0 : static_cast<double>(stat.LatencyTotal) / stat.AvailablePacket;
+                auto scale = record.HiRes ? 1u : 1000u;
+                line = StringUtils::Format("{0}|S{1}B|{2}|{3}|{4:F2}%|{5:F2}|{6}|{7}|{8}", record.Name, record.Size.Bytes,
+                    stat.PacketLost, total, lossRate, avg / scale, stat.MaxLatency / scale, stat.MinLatency / scale,
+                    stat.SendError);
+            }
+            else if (record.Kind == StatRecord::KIND_BURST)
+            {
+                const auto& stat = record.Burst;
+                auto scale = record.HiRes ? 1u : 1000u;
+                line = StringUtils::Format("{0}|BURST|{1}|{2}|{3}|{4}|{5}|{6}|{7}|{8}", record.Name, stat.BurstCount,
+                    stat.LossyBurstCount, stat.FullLossBurstCount, stat.MaxBurstLoss, stat.Jitter / scale,
+                    stat.MaxJitter / scale, stat.Reordered, stat.MaxReorderDistance);
+            }
+            else if (record.Kind == StatRecord::KIND_WINDOW)
+            {
+                const auto& stat = record.Window;
+                auto total = stat.Lost + stat.Received;
+                auto lossRate = total == 0 ? 0 : 100. * stat.Lost / total;
+                auto avg = stat.Received == 0 ? 0 : static_cast<double>(stat.LatencyTotal) / stat.Received;
+                auto scale = record.HiRes ? 1u : 1000u;
+                line = StringUtils::Format("{0}|W{1}s|{2}|{3}|{4:F2}%|{5:F2}|{6}|{7}", record.Name, stat.Window / 1000,
+                    stat.Lost, total, lossRate, avg / scale, stat.MaxLatency / scale, stat.MinLatency / scale);
+            }
+            else
+            {
+                const auto& stat = record.Ping;
+                auto total = stat.PacketLost + stat.AvailablePacket;
+                auto lossRate = total == 0 ? 0 : 100. * stat.PacketLost / total;
+                if (record.HiRes)
+                {
+                    auto avg = stat.AvailablePacket == 0 ? 0 : static_cast<double>(stat.LatencyTotal) / stat.AvailablePacket;
+                    line = StringUtils::Format("{0}|{1}|{2}|{3:F2}%|{4:F2}|{5}|{6}|{7}|{8}|{9}|{10}", record.Name,
+                        stat.PacketLost, total, lossRate, avg, stat.MaxLatency, stat.MinLatency, stat.P50Latency,
+                        stat.P90Latency, stat.P99Latency, stat.P999Latency);
+                }
+                else
+                {
+                    auto avg = stat.AvailablePacket == 0 ? 0 :
+                        static_cast<double>(stat.LatencyTotal / 1000 / stat.AvailablePacket);
+                    line = StringUtils::Format("{0}|{1}|{2}|{3:F2}%|{4:F2}|{5}|{6}|{7}|{8}|{9}|{10}", record.Name,
+                        stat.PacketLost, total, lossRate, avg, stat.MaxLatency / 1000, stat.MinLatency / 1000,
+                        stat.P50Latency / 1000, stat.P90Latency / 1000, stat.P99Latency / 1000, stat.P999Latency / 1000);
+                }
+            }
+            m_pSink->Log(Logging::Level::Info, Logging::Context(__FILE__, __LINE__, __FUNCTION__), line.c_str());
         }
         catch (const ExceptionBase& ex)
         {
@@ -325,6 +1685,177 @@ protected:
         }
     }
 
+    /**
+     * @brief 获取TCP通道使用的高精度时钟
+     *
+     * 服务端时间戳为CLOCK_REALTIME，计算单向时延时客户端也使用墙上时钟。
+     */
+    uint64_t GetTcpClock()const noexcept
+    {
+        return m_stConfig.ServerTimestamps ? HiResClock::RealtimeNow() : HiResClock::Now();
+    }
+
+    bool IsUdpClockRealtime()const noexcept
+    {
+#ifdef __linux__
+        if (m_pTimestampedUdpSocket)
+            return true;
+#endif
+        return m_stConfig.ServerTimestamps;
+    }
+
+    /**
+     * @brief 获取UDP通道使用的高精度时钟
+     */
+    uint64_t GetUdpClock()const noexcept
+    {
+        return IsUdpClockRealtime() ? HiResClock::RealtimeNow() : HiResClock::Now();
+    }
+
+    void OnTcpConnected(Target& target, uint32_t index, int err)
+    {
+        if (target.Retired)
+            return;
+
+        // 建连超时后连接已被关闭，迟到的回调不再处理
+        auto& channel = target.TcpChannels[index];
+        if (channel.State != STATE_TCP_CONNECTING)
+            return;
+        if (err == 0)
+        {
+            --m_uConnectingCount;
+            auto latency = (HiResClock::Now() - channel.ConnectStartTime) / 1000;
+            target.TcpConnectLatency.Record(static_cast<uint32_t>(std::min<uint64_t>(latency, UINT32_MAX)));
+            ++m_stTcpConnectStatistic.Count;
+            m_stTcpConnectStatistic.LatencyTotal += latency;
+            m_stTcpConnectStatistic.MaxLatency = std::max(m_stTcpConnectStatistic.MaxLatency, latency);
+
+            MOE_LOG_INFO("Ping server {0} connected in {1:F2}ms{2}", target.ServerAddrString, latency / 1000.,
+                index == target.ActiveTcpChannel ? "" : " (standby)");
+            channel.State = STATE_TCP_CONNECTED;
+            channel.ConnectedTime = RunLoop::Now();
+            channel.Socket.SetNoDelay(true);
+            channel.Socket.StartRead();
+            UpdateActiveTcpChannel(target);
+        }
+        else
+        {
+            MOE_LOG_ERROR("Connect {0} failed, err {1}", target.ServerAddrString, err);
+            ++target.TcpConnectFailures;
+            ++m_stTcpConnectStatistic.Failures;
+            OnTcpChannelFailed(target, index);
+        }
+    }
+
+    void OnTcpError(Target& target, uint32_t index, int err)
+    {
+        if (target.Retired)
+            return;
+        MOE_LOG_ERROR("Tcp socket {0} error: {1}", target.ServerAddrString, err);
+        OnTcpChannelFailed(target, index);
+    }
+
+    void OnTcpData(Target& target, uint32_t index, BytesView data)
+    {
+        if (target.Retired)
+            return;
+        LoopMonitor::Scope scope(m_pLoopMonitor.get(), LoopMonitor::CALLBACK_TCP_DATA);
+        auto now = RunLoop::Now();
+        auto hiResNow = GetTcpClock();
+        uint32_t frames = 0;
+        auto ok = target.TcpChannels[index].Decoder.Feed(data, [&](BytesView payload) {
+            PingPacket packet {};
+            ++frames;
+            if (DecodePacket(payload, packet) && packet.TargetId != kKeepAliveTargetId)
+                target.TcpPinger.Recv(packet, now, hiResNow);
+        });
+        if (m_pLoopMonitor)
+            m_pLoopMonitor->AddPackets(frames);
+
+        if (!ok)
+        {
+            // 流已失去同步，只能重连
+            MOE_LOG_ERROR("Tcp socket {0}: bad frame", target.ServerAddrString);
+            OnTcpChannelFailed(target, index);
+        }
+    }
+
+    void OnTcpDataEof(Target& target, uint32_t index)
+    {
+        if (target.Retired)
+            return;
+        MOE_LOG_ERROR("Tcp socket {0}: remote EOF", target.ServerAddrString);
+        OnTcpChannelFailed(target, index);
+    }
+
+#ifdef HAVE_IO_URING
+    void CreateUdpRing(int family)
+    {
+        // 失败时保留UdpSocket路径
+        auto fd = SocketUtils::CreateBoundSocket(SOCK_DGRAM, family == AF_INET6 ? "::" : "0.0.0.0", 0, false);
+        try
+        {
+            m_pUdpRing.reset(new UdpRing(fd, kUdpRingEntries, kUdpRingBuffers, PingPacketCodec::kMaxSize, kUdpRingSendSlots));
+        }
+        catch (const ExceptionBase& ex)
+        {
+            ::close(fd);
+            MOE_LOG_WARN("io_uring unavailable, fallback to libuv: {0}", ex.GetDescription());
+            return;
+        }
+        m_iUdpRingFd = fd;
+        m_pUdpRing->SetOnDataCallback([this](uint8_t* data, size_t length, const sockaddr*, socklen_t) {
+            OnUdpPacket(BytesView(data, length));
+        });
+        m_pUdpRing->SetOnErrorCallback([](int err) {
+            MOE_LOG_ERROR("Udp ring error: {0}", err);
+        });
+    }
+#endif
+
+    void OnUdpData(const EndPoint&, BytesView data)
+    {
+        OnUdpPacket(data);
+    }
+
+    void OnUdpPacket(BytesView data)
+    {
+        LoopMonitor::Scope scope(m_pLoopMonitor.get(), LoopMonitor::CALLBACK_UDP_DATA);
+        if (m_pLoopMonitor)
+            m_pLoopMonitor->AddPackets(1);
+
+        PingPacket packet {};
+        if (!DecodePacket(data, packet))
+            return;
+
+        auto target = FindTarget(packet);
+        if (target)
+            target->UdpPinger.Recv(packet, RunLoop::Now(), GetUdpClock());
+    }
+
+#ifdef __linux__
+    void OnTimestampedUdpData(const sockaddr*, BytesView data, uint64_t kernelTime)
+    {
+        LoopMonitor::Scope scope(m_pLoopMonitor.get(), LoopMonitor::CALLBACK_UDP_DATA);
+        if (m_pLoopMonitor)
+            m_pLoopMonitor->AddPackets(1);
+
+        PingPacket packet {};
+        if (!DecodePacket(data, packet))
+            return;
+
+        // 内核未提供时间戳时退化为用户态接收时间
+        auto target = FindTarget(packet);
+        if (target)
+            target->UdpPinger.Recv(packet, RunLoop::Now(), kernelTime != 0 ? kernelTime : HiResClock::RealtimeNow());
+    }
+
+    void OnTimestampedUdpError(int err)
+    {
+        MOE_LOG_ERROR("Udp socket error: {0}", err);
+    }
+#endif
+
     void OnUdpError(int err)
     {
         MOE_LOG_ERROR("Udp socket error: {0}", err);
@@ -337,24 +1868,75 @@ protected:
 
 private:
     Configure m_stConfig;
-    EndPoint m_stServerEndPoint;
 
     ObjectPool m_stObjectPool;
     RunLoop m_stRunLoop;
     Timer m_stTimer;
-    TcpSocket m_stTcpSocket;
     UdpSocket m_stUdpSocket;
 
-    int m_iTcpChannelState = STATE_TCP_NOT_CONNECT;
-    Time::Tick m_ullNextTryConnectTime = 0;
-
     Time::Tick m_ullNextPintStatTime = 0;
 
-    Pinger m_stTcpPinger;
-    Pinger m_stUdpPinger;
+#ifdef __linux__
+    std::unique_ptr<TimestampedUdpSocket> m_pTimestampedUdpSocket;
+#endif
+
+#ifdef HAVE_IO_URING
+    static const uint32_t kUdpRingEntries = 256;
+    static const uint32_t kUdpRingBuffers = 256;
+    static const uint32_t kUdpRingSendSlots = 1024;
+
+    std::unique_ptr<UdpRing> m_pUdpRing;
+    int m_iUdpRingFd = -1;  // m_pUdpRing使用的socket，在其销毁后关闭
+#endif
+
+#ifdef __linux__
+    std::unique_ptr<UdpBatch> m_pUdpBurst;  // 突发模式下一组探测的发送缓冲
+#endif
+
+    std::vector<std::unique_ptr<Target>> m_stTargets;  // 按Id索引，被移除的目标在隔离期内仍占用槽位
+    std::unordered_map<std::string, uint32_t> m_stTargetGroups;  // MakeTargetKey -> 组号
+    std::deque<std::pair<Time::Tick, uint32_t>> m_stFreeGroups;  // (可复用时间, 组号)，按时间排序
+    std::vector<Target*> m_stTcpProbeTargets;  // 按探测ID索引
+    std::vector<Target*> m_stUdpProbeTargets;
+    uint64_t m_ullTargetGeneration = 0;
+    int m_iFamily = AF_UNSPEC;
+    uint32_t m_uConnectingCount = 0;  // 正在建连的TCP连接数
+    size_t m_uConnectScanStart = 0;  // OnTick扫描建连的起始目标
+    struct stat m_stTargetFileStat {};
+    Time::Tick m_ullNextTargetFileCheckTime = 0;
+#ifndef _WIN32
+    uv_signal_t* m_pReloadSignal = nullptr;
+#endif
+    std::vector<UdpSocket> m_stFlowSockets;  // 多流模式下按流编号索引
+    std::vector<int> m_stFlowFds;  // 流socket的描述符，由m_stFlowSockets持有
+    std::minstd_rand m_stRandom { static_cast<std::minstd_rand::result_type>(HiResClock::Now()) };  // 重连抖动
+    TcpConnectStatistic m_stTcpConnectStatistic;  // 本统计周期内所有目标的建连情况
+    ProbeScheduler m_stTcpScheduler;
+    ProbeScheduler m_stUdpScheduler;
+    bool m_bMdrFormat = false;
+    vector<uint8_t> m_stPacketBuffer;  // 帧头加最大的探测包，在构造时一次分配
     vector<uint8_t> m_stBuffer;
+    vector<uint8_t> m_stFrameBuffer;
+    uint64_t m_ullMalformedPacketCount = 0;  // 累计值
+    uint64_t m_ullLastMalformedPacketCount = 0;
+    uint64_t m_ullTruncatedPacketCount = 0;  // 累计值
+    uint64_t m_ullLastTruncatedPacketCount = 0;
+    std::unique_ptr<MetricsServer> m_pMetricsServer;
+    std::unique_ptr<LoopMonitor> m_pLoopMonitor;
+    LoopMonitor::Statistic m_stLastLoopStatistic {};  // 供指标端点读取
 
     std::shared_ptr<Logging::RotatingFileSink> m_pSink;
+    std::unique_ptr<AsyncSink<StatRecord>> m_pStatSink;  // 必须先于m_pSink析构
+    std::unique_ptr<SampleLog::Writer> m_pSampleLog;
+    int64_t m_llSteadyToRealtime = 0;  // 样本时间换算到墙上时钟的偏移
+    Time::Tick m_ullNextSampleFlushTime = 0;
+
+    uint64_t m_ullReportSeq = 0;
+    std::unique_ptr<SnapshotBuffer<ReportSnapshot>> m_pReportBuffer;
+    std::mutex m_stReporterMutex;
+    std::condition_variable m_stReporterCondition;
+    bool m_bReporterStopping = false;
+    std::unique_ptr<std::thread> m_pReporterThread;  // 析构函数中先于其他成员停止
 };
 
 //////////////////////////////////////////////////////////////////////////////// App
@@ -385,22 +1967,144 @@ static void InitLogger()
     logger.Commit();
 }
 
+static const uint32_t kMaxBurst = 256;  // 单次sendmmsg提交的探测数上限
+
+/**
+ * @brief 解析逗号分隔的窗口长度（秒），返回毫秒
+ */
+static std::vector<uint32_t> ParseWindows(const std::string& list)
+{
+    std::vector<uint32_t> windows;
+    istringstream fields(list);
+    string field;
+    while (getline(fields, field, ','))
+    {
+        if (field.empty())
+            continue;
+
+        char* end = nullptr;
+        auto seconds = ::strtoul(field.c_str(), &end, 10);
+        if (*end != '\0' || seconds == 0 || seconds > 24 * 3600)
+            MOE_THROW(BadFormatException, "Invalid window {0}", field);
+        windows.push_back(static_cast<uint32_t>(seconds * 1000));
+    }
+    return windows;
+}
+
+/**
+ * @brief 解析探测包尺寸
+ *
+ * 逗号分隔的字节数，或`lo-hi:step`形式的扫描范围（包含hi），两种形式可以混用。
+ * @param minSize 最小尺寸，即不填充时的包头长度
+ */
+static std::vector<uint32_t> ParsePayloadSizes(const std::string& list, size_t minSize)
+{
+    std::vector<uint32_t> sizes;
+    auto check = [&](unsigned long size, const string& field) {
+        if (size < minSize || size > PingPacketCodec::kMaxPaddedSize)
+        {
+            MOE_THROW(BadFormatException, "Payload size {0} out of range [{1}, {2}]", field, minSize,
+                PingPacketCodec::kMaxPaddedSize);
+        }
+        sizes.push_back(static_cast<uint32_t>(size));
+    };
+
+    istringstream fields(list);
+    string field;
+    while (getline(fields, field, ','))
+    {
+        if (field.empty())
+            continue;
+
+        char* end = nullptr;
+        auto lo = ::strtoul(field.c_str(), &end, 10);
+        if (*end == '\0')
+        {
+            check(lo, field);
+            continue;
+        }
+
+        unsigned long hi = 0, step = 0;
+        if (*end == '-')
+            hi = ::strtoul(end + 1, &end, 10);
+        if (*end == ':')
+            step = ::strtoul(end + 1, &end, 10);
+        if (*end != '\0' || step == 0 || hi < lo)
+            MOE_THROW(BadFormatException, "Invalid payload size {0}", field);
+        for (auto size = lo; size <= hi; size += step)
+            check(size, field);
+    }
+    return sizes;
+}
+
 static Configure ParseCommandline(int argc, const char* argv[])
 {
     Configure cfg;
     bool needHelp = false;
 
     CmdParser parser;
-    parser << CmdParser::Option(cfg.ServerAddr, "server", 's', "Specific the server ip address");
-    parser << CmdParser::Option(cfg.ServerPort, "port", 'p', "Specific the server port");
-    parser << CmdParser::Option(cfg.PingInterval, "interval", 'i', "Specific the ping interval", 1000u);
+    parser << CmdParser::Option(cfg.ServerAddr, "server", 's', "Specific the server ip address", string());
+    parser << CmdParser::Option(cfg.ServerPort, "port", 'p', "Specific the server port", static_cast<uint16_t>(0));
+    parser << CmdParser::Option(cfg.TargetFile, "targets", 'f', "Specific a file listing '<ip> <port> [name]' per line to probe "
+        "instead of --server/--port", string());
+    parser << CmdParser::Option(cfg.PingInterval, "interval", 'i', "Specific the ping interval (ms)", 1000u);
+    parser << CmdParser::Option(cfg.PingIntervalUs, "interval-us", 'u', "Specific the ping interval in microseconds, overrides --interval",
+        0u);
     parser << CmdParser::Option(cfg.PingTimeout, "timeout", 't', "Specific the ping timeout", 10000u);
     parser << CmdParser::Option(cfg.Output, "output", 'o', "Specific the stat rolling output file", string());
+    parser << CmdParser::Option(cfg.HiRes, "hires", 'r', "Use nanosecond clock and report latency in microseconds", false);
+    parser << CmdParser::Option(cfg.Timestamping, "timestamping", 'T',
+        "Use kernel receive timestamps on the UDP channel, implies --hires (Linux only)", false);
+    parser << CmdParser::Option(cfg.IoUring, "io-uring", 'U',
+        "Use io_uring for the UDP probe path (multishot recv, Linux 6.0+), fallback to libuv if unavailable", false);
+    parser << CmdParser::Option(cfg.ServerTimestamps, "server-timestamps", 'S',
+        "Request server rx/tx timestamps and report one-way delay and server dwell time, implies --hires", false);
+    parser << CmdParser::Option(cfg.SampleFile, "samples", 'O', "Specific the binary per-probe sample file (see PingSampleReader)",
+        string());
+    parser << CmdParser::Option(cfg.WireFormat, "wire-format", 'W', "Specific the probe encoding, binary or mdr (compatible)",
+        string("binary"));
+    parser << CmdParser::Option(cfg.ReportInterval, "report-interval", 'R', "Specific the stat report interval (s)", 60u);
+    parser << CmdParser::Option(cfg.WindowList, "windows", 'w', "Specific the sliding windows reported along with each interval, "
+        "comma separated seconds, empty to disable", string("10,60,300"));
+    parser << CmdParser::Option(cfg.MetricsPort, "metrics-port", 'm', "Specific the HTTP port serving /metrics, 0 to disable",
+        static_cast<uint16_t>(0));
+    parser << CmdParser::Option(cfg.MetricsListen, "metrics-listen", 'M', "Specific the ip address the metrics endpoint listens on",
+        string("127.0.0.1"));
+    parser << CmdParser::Option(cfg.TcpStandby, "tcp-standby", 'B', "Keep a second pre-connected TCP session per target that "
+        "takes over when the active one fails", false);
+    parser << CmdParser::Option(cfg.Flows, "flows", 'F', "Specific the flow count per target, each with its own UDP source port "
+        "and TCP connection to cover parallel ECMP paths", 1u);
+    parser << CmdParser::Option(cfg.FlowBasePort, "flow-base-port", 'P', "Specific the first UDP source port of the flows, "
+        "0 to let the system choose", static_cast<uint16_t>(0));
+    parser << CmdParser::Option(cfg.LoopStats, "loop-stats", 'L', "Report event loop lag, callback durations and packets "
+        "per loop iteration alongside the probe statistics", false);
+    parser << CmdParser::Option(cfg.PayloadSizeList, "payload-size", 'z', "Specific the probe sizes in bytes rotated by sequence "
+        "and reported separately, comma separated or lo-hi:step, sent with DF set for path MTU probing", string());
+    parser << CmdParser::Option(cfg.Burst, "burst", 'b', "Specific the UDP probes sent back-to-back per interval, "
+        "reporting per-burst loss, jitter and reordering", 1u);
+    parser << CmdParser::Option(cfg.WatchTargets, "watch-targets", 'H', "Reload the --targets file when it changes, keeping "
+        "the state of unchanged targets (SIGHUP always reloads)", false);
+    parser << CmdParser::Option(cfg.MaxConnecting, "max-connecting", 'C', "Specific the maximum concurrent TCP connection attempts, "
+        "0 for unlimited", 256u);
+    parser << CmdParser::Option(cfg.CpuAffinity, "cpu-affinity", 'A', "Pin the probe loop to the first cpu of the list "
+        "(e.g. 2 or 2-3), the reporter thread stays unpinned (Linux)", string());
+    parser << CmdParser::Option(cfg.NumaNode, "numa-node", 'n', "Prefer allocating probe memory on the given NUMA node, "
+        "also pins the probe loop to its first cpu when --cpu-affinity is empty, -1 to follow the cpu (Linux)",
+        static_cast<int32_t>(-1));
+    parser << CmdParser::Option(cfg.RxQueues, "rx-queues", 'Q', "Place the probe loop on the cpu serving the first RX queue "
+        "interrupt of the given interface when no cpu is given, and report the queue (Linux)", string());
     parser << CmdParser::Option(needHelp, "help", 'h', "Show this help", false);
 
     try
     {
         parser(argc, argv);
+        cfg.Windows = ParseWindows(cfg.WindowList);
+        cfg.PayloadSizes = ParsePayloadSizes(cfg.PayloadSizeList, cfg.ServerTimestamps ? PingPacketCodec::kMaxSize :
+            PingPacketCodec::kBaseSize);
+        if (cfg.ReportInterval == 0)
+            MOE_THROW(BadArgumentException, "Report interval must be positive");
+        if (cfg.Burst == 0 || cfg.Burst > kMaxBurst)
+            MOE_THROW(BadArgumentException, "Burst must be within [1, {0}]", kMaxBurst);
     }
     catch (const ExceptionBase& ex)
     {
@@ -408,6 +2112,12 @@ static Configure ParseCommandline(int argc, const char* argv[])
         needHelp = true;
     }
 
+    if (!needHelp && cfg.TargetFile.empty() && (cfg.ServerAddr.empty() || cfg.ServerPort == 0))
+    {
+        fprintf(stderr, "Either --server and --port or --targets must be specified\n\n");
+        needHelp = true;
+    }
+
     if (needHelp)
     {
         auto name = PathUtils::GetFileName(argv[0]);
@@ -427,8 +2137,21 @@ int main(int argc, const char* argv[])
     try
     {
         Configure cfg = ParseCommandline(argc, argv);
-        Client client(cfg);
-        client.Run();
+
+        std::vector<TargetConfigure> targets;
+        if (cfg.TargetFile.empty())
+            targets.push_back(TargetConfigure { string(), cfg.ServerAddr, cfg.ServerPort });
+        else
+            targets = LoadTargets(cfg.TargetFile);
+        MOE_LOG_INFO("Probing {0} target(s)", targets.size());
+
+        // 内存策略在构造Client之前设置，RunLoop、对象池和收发缓冲分配在本地节点上
+        auto placement = CpuAffinity::Plan(1, cfg.CpuAffinity, cfg.NumaNode, cfg.RxQueues)[0];
+        if (placement.Node >= 0 && !CpuAffinity::SetPreferredNode(placement.Node))
+            MOE_LOG_WARN("Cannot set memory policy to numa node {0}, errno {1}", placement.Node, errno);
+
+        Client client(cfg, targets);
+        client.Run(placement);
     }
     catch (const moe::ExceptionBase& ex)
     {
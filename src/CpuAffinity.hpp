@@ -0,0 +1,339 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include <Moe.Core/Exception.hpp>
+#include <Moe.Core/StringUtils.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#endif
+
+/**
+ * @brief 工作线程的CPU与NUMA放置
+ *
+ * 按--cpu-affinity、--numa-node以及网卡RX队列的中断亲和性为每个工作线程规划CPU和内存节点。
+ * 线程在构造RunLoop之前绑定CPU并设置优先本地节点的内存策略，此后的ObjectPool、收发缓冲等按首次访问落在本地节点。
+ * 只依赖sysfs和procfs，不需要libnuma。仅支持Linux。
+ */
+namespace CpuAffinity
+{
+    /**
+     * @brief 支持的最大CPU编号（不含），与glibc的CPU_SETSIZE一致
+     */
+    static const int kMaxCpuCount = 1024;
+
+    /**
+     * @brief 一个工作线程的放置，各字段为-1表示不限定
+     */
+    struct Placement
+    {
+        int Cpu = -1;
+        int Node = -1;
+        int RxQueue = -1;  // 中断落在Cpu上的网卡RX队列
+        int Irq = -1;
+    };
+
+    /**
+     * @brief 网卡的一个RX队列
+     */
+    struct RxQueue
+    {
+        int Index;
+        int Irq;
+        int Cpu;  // 中断的有效亲和CPU，未知时为-1
+        std::string Name;
+    };
+
+    /**
+     * @brief 解析CPU列表，如`0-3,8,10-11`
+     */
+    inline std::vector<int> ParseCpuList(const std::string& list)
+    {
+        std::vector<int> cpus;
+        std::istringstream fields(list);
+        std::string field;
+        while (std::getline(fields, field, ','))
+        {
+            while (!field.empty() && (field.back() == '\n' || field.back() == ' '))
+                field.pop_back();
+            if (field.empty())
+                continue;
+
+            char* end = nullptr;
+            auto lo = ::strtol(field.c_str(), &end, 10);
+            auto hi = lo;
+            if (*end == '-')
+                hi = ::strtol(end + 1, &end, 10);
+            if (*end != '\0' || lo < 0 || hi < lo || hi >= kMaxCpuCount)
+                MOE_THROW(moe::BadFormatException, "Invalid cpu list {0}", list);
+            for (auto cpu = lo; cpu <= hi; ++cpu)
+                cpus.push_back(static_cast<int>(cpu));
+        }
+        return cpus;
+    }
+
+#ifdef __linux__
+    namespace details
+    {
+        inline bool ReadLine(const std::string& path, std::string& out)
+        {
+            std::ifstream file(path);
+            return static_cast<bool>(std::getline(file, out));
+        }
+    }
+
+    /**
+     * @brief 获取NUMA节点上的CPU
+     */
+    inline std::vector<int> GetNodeCpus(int node)
+    {
+        std::string list;
+        if (!details::ReadLine(moe::StringUtils::Format("/sys/devices/system/node/node{0}/cpulist", node), list))
+            MOE_THROW(moe::BadArgumentException, "NUMA node {0} not found", node);
+        return ParseCpuList(list);
+    }
+
+    /**
+     * @brief 获取CPU所在的NUMA节点，未知时返回-1
+     */
+    inline int GetCpuNode(int cpu)noexcept
+    {
+        auto path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+        auto dir = ::opendir(path.c_str());
+        if (!dir)
+            return -1;
+
+        int node = -1;
+        while (auto entry = ::readdir(dir))
+        {
+            if (::strncmp(entry->d_name, "node", 4) == 0 && ::isdigit(static_cast<unsigned char>(entry->d_name[4])))
+            {
+                node = ::atoi(entry->d_name + 4);
+                break;
+            }
+        }
+        ::closedir(dir);
+        return node;
+    }
+
+    /**
+     * @brief 从/proc/interrupts中找出网卡的RX队列及其中断所在的CPU
+     *
+     * 中断名形如`eth0-TxRx-3`或`eth0-rx-3`；没有带rx字样的中断时取所有以`<nic>-`开头的中断。按文件中的顺序编号。
+     */
+    inline std::vector<RxQueue> GetRxQueues(const std::string& nic)
+    {
+        std::ifstream file("/proc/interrupts");
+        if (!file)
+            MOE_THROW(moe::IOException, "Cannot open /proc/interrupts");
+
+        std::vector<RxQueue> all, rx;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            std::istringstream fields(line);
+            std::string first, last, token;
+            if (!(fields >> first) || first.empty() || first.back() != ':')
+                continue;
+            while (fields >> token)
+                last = token;
+
+            char* end = nullptr;
+            auto irq = ::strtol(first.c_str(), &end, 10);
+            if (*end != ':' || last.compare(0, nic.size() + 1, nic + "-") != 0)
+                continue;
+
+            std::string affinity;
+            auto prefix = moe::StringUtils::Format("/proc/irq/{0}/", irq);
+            if (!details::ReadLine(prefix + "effective_affinity_list", affinity) || affinity.empty())
+                details::ReadLine(prefix + "smp_affinity_list", affinity);
+            int cpu = -1;
+            try
+            {
+                auto cpus = ParseCpuList(affinity);
+                if (!cpus.empty())
+                    cpu = cpus.front();
+            }
+            catch (const moe::ExceptionBase&)
+            {
+            }
+
+            RxQueue queue { 0, static_cast<int>(irq), cpu, last };
+            auto lower = last;
+            std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+            if (lower.find("rx") != std::string::npos)
+                rx.push_back(queue);
+            all.push_back(queue);
+        }
+
+        auto& queues = rx.empty() ? all : rx;
+        if (queues.empty())
+            MOE_THROW(moe::BadArgumentException, "No interrupt found for {0} in /proc/interrupts", nic);
+        for (size_t i = 0; i < queues.size(); ++i)
+            queues[i].Index = static_cast<int>(i);
+        return queues;
+    }
+
+    /**
+     * @brief 获取当前线程允许运行的CPU
+     */
+    inline std::vector<int> GetCurrentThreadCpus()
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        std::vector<int> cpus;
+        if (::pthread_getaffinity_np(::pthread_self(), sizeof(set), &set) != 0)
+            return cpus;
+        for (int i = 0; i < kMaxCpuCount && i < CPU_SETSIZE; ++i)
+        {
+            if (CPU_ISSET(i, &set))
+                cpus.push_back(i);
+        }
+        return cpus;
+    }
+
+    /**
+     * @brief 将当前线程绑定到给定的CPU集合
+     */
+    inline void PinCurrentThread(const std::vector<int>& cpus)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (auto cpu : cpus)
+            CPU_SET(cpu, &set);
+        auto ret = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+        if (ret != 0)
+            MOE_THROW(moe::APIException, "pthread_setaffinity_np failed, errno {0}", ret);
+    }
+
+    /**
+     * @brief 设置当前线程优先从给定节点分配内存（MPOL_PREFERRED），节点内存不足时仍可回退到其他节点
+     * @return 内核不支持NUMA或被拒绝时返回false
+     */
+    inline bool SetPreferredNode(int node)noexcept
+    {
+        static const int kMpolPreferred = 1;
+        unsigned long mask[16];
+        if (node < 0 || static_cast<size_t>(node) >= sizeof(mask) * 8)
+            return false;
+        ::memset(mask, 0, sizeof(mask));
+        mask[node / (sizeof(unsigned long) * 8)] |= 1ul << (node % (sizeof(unsigned long) * 8));
+        return ::syscall(SYS_set_mempolicy, kMpolPreferred, mask, sizeof(mask) * 8) == 0;
+    }
+
+    /**
+     * @brief 让内核优先把在该CPU上收到的连接和数据报交给这个socket（SO_REUSEPORT组内，Linux 6.2+）
+     */
+    inline void SetIncomingCpu(int fd, int cpu)noexcept
+    {
+#ifdef SO_INCOMING_CPU
+        if (fd >= 0 && cpu >= 0)
+            ::setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu));
+#endif
+    }
+
+    /**
+     * @brief 为count个工作线程规划放置
+     * @param cpuList 候选CPU列表，为空时取numaNode上的CPU，再为空时取RX队列中断所在的CPU
+     * @param numaNode 内存节点，小于0时取CPU所在的节点
+     * @param nic 网卡名，非空时把每个工作线程对应到中断落在其CPU上的RX队列
+     *
+     * 工作线程多于候选CPU时循环复用。均未指定时返回不限定的放置。
+     */
+    inline std::vector<Placement> Plan(size_t count, const std::string& cpuList, int numaNode, const std::string& nic)
+    {
+        std::vector<Placement> placements(count);
+        auto cpus = cpuList.empty() ? std::vector<int>() : ParseCpuList(cpuList);
+        if (cpus.empty() && numaNode >= 0)
+            cpus = GetNodeCpus(numaNode);
+
+        std::vector<RxQueue> queues;
+        if (!nic.empty())
+        {
+            queues = GetRxQueues(nic);
+            if (cpus.empty())
+            {
+                // 未指定CPU时第N个工作线程跟随第N个RX队列的中断
+                for (const auto& queue : queues)
+                {
+                    if (queue.Cpu >= 0)
+                        cpus.push_back(queue.Cpu);
+                }
+            }
+        }
+
+        for (size_t i = 0; i < count && !cpus.empty(); ++i)
+        {
+            auto& placement = placements[i];
+            placement.Cpu = cpus[i % cpus.size()];
+            placement.Node = numaNode >= 0 ? numaNode : GetCpuNode(placement.Cpu);
+            for (const auto& queue : queues)
+            {
+                if (queue.Cpu == placement.Cpu)
+                {
+                    placement.RxQueue = queue.Index;
+                    placement.Irq = queue.Irq;
+                    break;
+                }
+            }
+        }
+        if (cpus.empty() && numaNode >= 0)
+        {
+            for (auto& placement : placements)
+                placement.Node = numaNode;
+        }
+        return placements;
+    }
+
+    /**
+     * @brief 在当前线程上应用放置，必须在分配该线程的RunLoop及缓冲之前调用
+     * @return 内存策略未能生效时返回false，CPU绑定失败时抛出异常
+     */
+    inline bool Apply(const Placement& placement)
+    {
+        if (placement.Cpu >= 0)
+            PinCurrentThread(std::vector<int> { placement.Cpu });
+        return placement.Node < 0 || SetPreferredNode(placement.Node);
+    }
+#else
+    inline std::vector<Placement> Plan(size_t count, const std::string& cpuList, int numaNode, const std::string& nic)
+    {
+        if (!cpuList.empty() || numaNode >= 0 || !nic.empty())
+            MOE_THROW(moe::BadArgumentException, "Thread placement is only supported on Linux");
+        return std::vector<Placement>(count);
+    }
+
+    inline std::vector<int> GetCurrentThreadCpus() { return std::vector<int>(); }
+    inline void PinCurrentThread(const std::vector<int>&) {}
+    inline bool SetPreferredNode(int)noexcept { return true; }
+    inline void SetIncomingCpu(int, int)noexcept {}
+    inline bool Apply(const Placement&) { return true; }
+#endif
+
+    /**
+     * @brief 格式化放置，用于启动时输出
+     */
+    inline std::string Describe(const Placement& placement)
+    {
+        if (placement.Cpu < 0 && placement.Node < 0)
+            return "unpinned";
+
+        auto desc = placement.Cpu >= 0 ? moe::StringUtils::Format("cpu {0}", placement.Cpu) : std::string("any cpu");
+        desc += placement.Node >= 0 ? moe::StringUtils::Format(", numa node {0}", placement.Node) : std::string(", numa node ?");
+        if (placement.RxQueue >= 0)
+            desc += moe::StringUtils::Format(", rx queue {0} (irq {1})", placement.RxQueue, placement.Irq);
+        return desc;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <functional>
+
+#include <Moe.Core/Exception.hpp>
+#include <Moe.UV/RunLoop.hpp>
+
+/**
+ * @brief 文件描述符就绪事件监视器
+ *
+ * 对uv_poll_t的简单封装，用于在RunLoop上驱动需要直接操作socket的收发路径（如recvmmsg/sendmmsg）。
+ * 必须在所属RunLoop的线程上构造和析构。
+ */
+class FdWatcher
+{
+public:
+    using OnEventCallbackType = std::function<void(int status, int events)>;
+
+public:
+    FdWatcher(int fd)
+        : m_pHandle(new uv_poll_t())
+    {
+        auto ret = ::uv_poll_init_socket(moe::UV::RunLoop::GetCurrentUVLoop(), m_pHandle, fd);
+        if (ret != 0)
+        {
+            delete m_pHandle;
+            MOE_THROW(moe::APIException, "uv_poll_init_socket error: {0}", ::uv_strerror(ret));
+        }
+        m_pHandle->data = this;
+    }
+
+    FdWatcher(const FdWatcher&) = delete;
+    FdWatcher& operator=(const FdWatcher&) = delete;
+
+    ~FdWatcher()
+    {
+        // 句柄内存需要在关闭回调中释放
+        m_pHandle->data = nullptr;
+        ::uv_close(reinterpret_cast<uv_handle_t*>(m_pHandle), [](uv_handle_t* handle) {
+            delete reinterpret_cast<uv_poll_t*>(handle);
+        });
+    }
+
+public:
+    void SetOnEventCallback(const OnEventCallbackType& callback) { m_stOnEvent = callback; }
+
+    /**
+     * @brief 开始监视
+     * @param events UV_READABLE/UV_WRITABLE的组合
+     */
+    void Start(int events)
+    {
+        auto ret = ::uv_poll_start(m_pHandle, events, OnPollEvent);
+        if (ret != 0)
+            MOE_THROW(moe::APIException, "uv_poll_start error: {0}", ::uv_strerror(ret));
+    }
+
+    void Stop()noexcept
+    {
+        ::uv_poll_stop(m_pHandle);
+    }
+
+private:
+    static void OnPollEvent(uv_poll_t* handle, int status, int events)
+    {
+        auto self = static_cast<FdWatcher*>(handle->data);
+        if (self && self->m_stOnEvent)
+            self->m_stOnEvent(status, events);
+    }
+
+private:
+    uv_poll_t* m_pHandle = nullptr;
+    OnEventCallbackType m_stOnEvent;
+};
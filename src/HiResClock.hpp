@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <chrono>
+
+/**
+ * @brief 高精度时钟
+ *
+ * RunLoop::Now()为毫秒精度的循环缓存时间，测量局域网时延时需要使用纳秒精度的时钟。
+ */
+namespace HiResClock
+{
+    /**
+     * @brief 单调时钟（纳秒）
+     */
+    inline uint64_t Now()noexcept
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    /**
+     * @brief 墙上时钟（纳秒）
+     *
+     * 与内核SO_TIMESTAMPNS时间戳同源，仅在需要与内核时间戳比较时使用。
+     */
+    inline uint64_t RealtimeNow()noexcept
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+}
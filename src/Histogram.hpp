@@ -0,0 +1,131 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/**
+ * @brief 对数分桶的时延直方图
+ *
+ * 与HDR Histogram相同的分桶方式：每个2的幂区间再等分为kSubBucketCount个子桶，
+ * 相对误差不超过1/kSubBucketCount（约3%）。内存固定，记录为O(1)，合并为O(桶数)。
+ * 值域为[0, 2^28)（以微秒计约268秒，远大于任何探测超时），超出部分计入最后一个桶。
+ * 桶计数为32位以控制每个Pinger的内存（约3KB），单个统计周期内不会溢出。
+ */
+class LatencyHistogram
+{
+public:
+    static const uint32_t kSubBucketBits = 5;
+    static const uint32_t kSubBucketCount = 1u << kSubBucketBits;
+    static const uint32_t kMaxValueBits = 28;
+    static const uint32_t kBucketCount = (kMaxValueBits - kSubBucketBits + 1) * kSubBucketCount;
+
+public:
+    static uint32_t GetMostSignificantBit(uint64_t value)noexcept
+    {
+#ifdef _MSC_VER
+        unsigned long index = 0;
+        _BitScanReverse64(&index, value);
+        return static_cast<uint32_t>(index);
+#else
+        return 63u - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+    }
+
+    /**
+     * @brief 获取值所在的桶
+     */
+    static uint32_t GetBucketIndex(uint64_t value)noexcept
+    {
+        if (value < kSubBucketCount)
+            return static_cast<uint32_t>(value);
+        if (value >> kMaxValueBits)
+            return kBucketCount - 1;
+
+        auto msb = GetMostSignificantBit(value);
+        auto shift = msb - kSubBucketBits;
+        return (shift + 1) * kSubBucketCount + static_cast<uint32_t>((value >> shift) - kSubBucketCount);
+    }
+
+    /**
+     * @brief 获取桶能表示的最大值
+     */
+    static uint64_t GetBucketUpperBound(uint32_t index)noexcept
+    {
+        if (index < kSubBucketCount)
+            return index;
+
+        auto shift = index / kSubBucketCount - 1;
+        auto sub = index % kSubBucketCount + kSubBucketCount;
+        return ((static_cast<uint64_t>(sub) + 1) << shift) - 1;
+    }
+
+public:
+    LatencyHistogram()noexcept
+    {
+        Reset();
+    }
+
+public:
+    uint64_t GetCount()const noexcept { return m_ullCount; }
+    uint64_t GetMin()const noexcept { return m_ullCount == 0 ? 0 : m_ullMin; }
+    uint64_t GetMax()const noexcept { return m_ullMax; }
+    uint32_t GetBucket(uint32_t index)const noexcept { return m_stBuckets[index]; }
+
+    void Record(uint64_t value)noexcept
+    {
+        ++m_stBuckets[GetBucketIndex(value)];
+        ++m_ullCount;
+        m_ullMin = std::min(m_ullMin, value);
+        m_ullMax = std::max(m_ullMax, value);
+    }
+
+    void Merge(const LatencyHistogram& rhs)noexcept
+    {
+        for (uint32_t i = 0; i < kBucketCount; ++i)
+            m_stBuckets[i] += rhs.m_stBuckets[i];
+        m_ullCount += rhs.m_ullCount;
+        m_ullMin = std::min(m_ullMin, rhs.m_ullMin);
+        m_ullMax = std::max(m_ullMax, rhs.m_ullMax);
+    }
+
+    void Reset()noexcept
+    {
+        ::memset(m_stBuckets, 0, sizeof(m_stBuckets));
+        m_ullCount = 0;
+        m_ullMin = UINT64_MAX;
+        m_ullMax = 0;
+    }
+
+    /**
+     * @brief 计算分位数
+     * @param percentile 百分位，如99.9
+     * @return 分位值（所在桶的上界，且不超过记录的最大值）
+     */
+    uint64_t GetPercentile(double percentile)const noexcept
+    {
+        if (m_ullCount == 0)
+            return 0;
+
+        auto rank = static_cast<uint64_t>(percentile / 100. * static_cast<double>(m_ullCount) + 0.5);
+        rank = std::max<uint64_t>(1, std::min(rank, m_ullCount));
+
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < kBucketCount; ++i)
+        {
+            seen += m_stBuckets[i];
+            if (seen >= rank)
+                return std::min(std::max(GetBucketUpperBound(i), m_ullMin), m_ullMax);
+        }
+        return m_ullMax;
+    }
+
+private:
+    uint32_t m_stBuckets[kBucketCount];
+    uint64_t m_ullCount;
+    uint64_t m_ullMin;
+    uint64_t m_ullMax;
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cassert>
+
+/**
+ * @brief 侵入式双向链表节点
+ */
+struct IntrusiveListNode
+{
+    IntrusiveListNode* Prev = nullptr;
+    IntrusiveListNode* Next = nullptr;
+
+    bool IsLinked()const noexcept { return Next != nullptr; }
+};
+
+/**
+ * @brief 侵入式双向链表
+ * @tparam T 元素类型，必须派生自IntrusiveListNode
+ *
+ * 链表不持有元素，插入和删除均为O(1)且不产生分配。
+ */
+template <typename T>
+class IntrusiveList
+{
+public:
+    IntrusiveList()noexcept
+    {
+        m_stHead.Prev = m_stHead.Next = &m_stHead;
+    }
+
+    IntrusiveList(const IntrusiveList&) = delete;
+    IntrusiveList& operator=(const IntrusiveList&) = delete;
+
+public:
+    bool IsEmpty()const noexcept { return m_stHead.Next == &m_stHead; }
+    size_t GetSize()const noexcept { return m_uSize; }
+
+    T* Front()noexcept { return IsEmpty() ? nullptr : static_cast<T*>(m_stHead.Next); }
+
+    void PushBack(T* obj)noexcept
+    {
+        IntrusiveListNode* node = obj;
+        assert(!node->IsLinked());
+        node->Prev = m_stHead.Prev;
+        node->Next = &m_stHead;
+        m_stHead.Prev->Next = node;
+        m_stHead.Prev = node;
+        ++m_uSize;
+    }
+
+    void Remove(T* obj)noexcept
+    {
+        IntrusiveListNode* node = obj;
+        assert(node->IsLinked());
+        node->Prev->Next = node->Next;
+        node->Next->Prev = node->Prev;
+        node->Prev = node->Next = nullptr;
+        --m_uSize;
+    }
+
+    /**
+     * @brief 遍历所有元素，回调中允许删除当前元素
+     */
+    template <typename TCallback>
+    void ForEach(TCallback&& callback)
+    {
+        auto node = m_stHead.Next;
+        while (node != &m_stHead)
+        {
+            auto next = node->Next;
+            callback(static_cast<T*>(node));
+            node = next;
+        }
+    }
+
+private:
+    IntrusiveListNode m_stHead;
+    size_t m_uSize = 0;
+};
@@ -0,0 +1,279 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <algorithm>
+
+#include <Moe.Core/Logging.hpp>
+#include <Moe.UV/RunLoop.hpp>
+
+#include "HiResClock.hpp"
+#include "Histogram.hpp"
+#include "Metrics.hpp"
+
+/**
+ * @brief 事件循环自身的时延观测
+ *
+ * 用独立的定时器测量循环滞后（定时器实际触发与预定时间之差），用uv_prepare在每轮循环进入poll之前
+ * 统计本轮处理的数据报数，并为关键回调记录耗时，以便从RTT中剔除进程自身引入的时延。
+ * libuv定时器为毫秒精度，滞后中包含1ms以内的底噪。
+ * 未启用时调用方持有空指针，热路径上只多一次判空。必须在所属RunLoop的线程上构造和析构。
+ */
+class LoopMonitor
+{
+public:
+    enum Callback
+    {
+        CALLBACK_TICK = 0,
+        CALLBACK_UDP_DATA = 1,
+        CALLBACK_TCP_DATA = 2,
+        CALLBACK_COUNT = 3,
+    };
+
+    static const uint32_t kLagIntervalMs = 10;
+
+    /**
+     * @brief 一个统计周期的自身开销
+     *
+     * 滞后单位为微秒，回调耗时单位为纳秒。
+     */
+    struct Statistic
+    {
+        struct CallbackStatistic
+        {
+            uint64_t Count;
+            uint64_t Total;
+            uint64_t P99;
+            uint64_t Max;
+        };
+
+        uint64_t LagCount;
+        uint64_t LagTotal;
+        uint64_t LagP50;
+        uint64_t LagP99;
+        uint64_t LagMax;
+        CallbackStatistic Callbacks[CALLBACK_COUNT];
+        uint64_t BusyCycles;  // 处理过数据报的循环轮数
+        uint64_t Packets;
+        uint64_t PacketsP99;  // 每轮处理的数据报数
+        uint64_t PacketsMax;
+    };
+
+    static const char* GetCallbackName(uint32_t index)noexcept
+    {
+        static const char* const kNames[CALLBACK_COUNT] = { "tick", "udp_data", "tcp_data" };
+        return kNames[index];
+    }
+
+    /**
+     * @brief 输出一个统计周期的自身开销
+     * @param name 日志前缀，如工作线程编号
+     */
+    static void Log(const std::string& name, const Statistic& stat)
+    {
+        const auto& tick = stat.Callbacks[CALLBACK_TICK];
+        const auto& udp = stat.Callbacks[CALLBACK_UDP_DATA];
+        const auto& tcp = stat.Callbacks[CALLBACK_TCP_DATA];
+        auto avg = [](uint64_t total, uint64_t count) { return count == 0 ? 0. : static_cast<double>(total) / count; };
+        MOE_LOG_INFO("{0} LOOP, lag avg {1:F1}us p50 {2}us p99 {3}us max {4}us, tick {5} avg {6:F1}us max {7:F1}us, "
+            "udp_data {8} avg {9:F2}us p99 {10:F2}us max {11:F1}us, tcp_data {12} avg {13:F2}us p99 {14:F2}us max {15:F1}us, "
+            "packets/cycle avg {16:F2} p99 {17} max {18}", name, avg(stat.LagTotal, stat.LagCount), stat.LagP50, stat.LagP99,
+            stat.LagMax, tick.Count, avg(tick.Total, tick.Count) / 1000., tick.Max / 1000., udp.Count,
+            avg(udp.Total, udp.Count) / 1000., udp.P99 / 1000., udp.Max / 1000., tcp.Count, avg(tcp.Total, tcp.Count) / 1000.,
+            tcp.P99 / 1000., tcp.Max / 1000., avg(stat.Packets, stat.BusyCycles), stat.PacketsP99, stat.PacketsMax);
+    }
+
+    /**
+     * @brief 以最近一个统计周期的结果渲染指标
+     * @param prefix 指标名前缀，如ping_client
+     * @param forEach 以(labels, stat)依次回调每个事件循环
+     */
+    template <typename TForEach>
+    static void RenderMetrics(Metrics::TextWriter& writer, const std::string& prefix, TForEach forEach)
+    {
+        std::string name, labels;
+        auto gauge = [&](const char* suffix, const char* help, double (*value)(const Statistic&)) {
+            name = prefix + suffix;
+            writer.Declare(name.c_str(), "gauge", help);
+            forEach([&](const std::string& base, const Statistic& stat) {
+                writer.Sample(name.c_str(), base, value(stat));
+            });
+        };
+        gauge("_loop_lag_p99_seconds", "Event loop lag p99 over the last report interval",
+            [](const Statistic& stat) { return stat.LagP99 / 1000000.; });
+        gauge("_loop_lag_max_seconds", "Event loop lag max over the last report interval",
+            [](const Statistic& stat) { return stat.LagMax / 1000000.; });
+        gauge("_loop_packets_per_cycle_p99", "Packets handled per busy loop iteration, p99 over the last report interval",
+            [](const Statistic& stat) { return static_cast<double>(stat.PacketsP99); });
+
+        name = prefix + "_callback_p99_seconds";
+        writer.Declare(name.c_str(), "gauge", "Callback duration p99 over the last report interval");
+        forEach([&](const std::string& base, const Statistic& stat) {
+            for (uint32_t i = 0; i < CALLBACK_COUNT; ++i)
+            {
+                labels = base;
+                Metrics::AppendLabel(labels, "callback", GetCallbackName(i));
+                writer.Sample(name.c_str(), labels, stat.Callbacks[i].P99 / 1000000000.);
+            }
+        });
+        name = prefix + "_callback_max_seconds";
+        writer.Declare(name.c_str(), "gauge", "Callback duration max over the last report interval");
+        forEach([&](const std::string& base, const Statistic& stat) {
+            for (uint32_t i = 0; i < CALLBACK_COUNT; ++i)
+            {
+                labels = base;
+                Metrics::AppendLabel(labels, "callback", GetCallbackName(i));
+                writer.Sample(name.c_str(), labels, stat.Callbacks[i].Max / 1000000000.);
+            }
+        });
+    }
+
+    /**
+     * @brief 记录作用域内的回调耗时，monitor为空时不读取时钟
+     */
+    class Scope
+    {
+    public:
+        Scope(LoopMonitor* monitor, Callback callback)noexcept
+            : m_pMonitor(monitor), m_iCallback(callback), m_ullStart(monitor ? HiResClock::Now() : 0) {}
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        ~Scope()
+        {
+            if (m_pMonitor)
+                m_pMonitor->m_stCallbacks[m_iCallback].Record(HiResClock::Now() - m_ullStart);
+        }
+
+    private:
+        LoopMonitor* m_pMonitor;
+        Callback m_iCallback;
+        uint64_t m_ullStart;
+    };
+
+public:
+    LoopMonitor()
+        : m_pTimer(new uv_timer_t()), m_pPrepare(new uv_prepare_t())
+    {
+        auto loop = moe::UV::RunLoop::GetCurrentUVLoop();
+        ::uv_timer_init(loop, m_pTimer);
+        m_pTimer->data = this;
+        ::uv_prepare_init(loop, m_pPrepare);
+        m_pPrepare->data = this;
+    }
+
+    LoopMonitor(const LoopMonitor&) = delete;
+    LoopMonitor& operator=(const LoopMonitor&) = delete;
+
+    ~LoopMonitor()
+    {
+        // 句柄内存需要在关闭回调中释放
+        m_pTimer->data = nullptr;
+        ::uv_close(reinterpret_cast<uv_handle_t*>(m_pTimer), [](uv_handle_t* handle) {
+            delete reinterpret_cast<uv_timer_t*>(handle);
+        });
+        m_pPrepare->data = nullptr;
+        ::uv_close(reinterpret_cast<uv_handle_t*>(m_pPrepare), [](uv_handle_t* handle) {
+            delete reinterpret_cast<uv_prepare_t*>(handle);
+        });
+    }
+
+public:
+    void Start()
+    {
+        m_ullExpected = HiResClock::Now() + kLagIntervalMs * 1000000ull;
+        ::uv_timer_start(m_pTimer, OnTimer, kLagIntervalMs, 0);
+        ::uv_prepare_start(m_pPrepare, OnPrepare);
+    }
+
+    /**
+     * @brief 计入本轮循环处理的数据报
+     */
+    void AddPackets(uint32_t count)noexcept { m_uCyclePackets += count; }
+
+    /**
+     * @brief 获取本周期的统计并开始新的周期
+     */
+    Statistic Collect()noexcept
+    {
+        Statistic stat {};
+        stat.LagCount = m_stLag.GetCount();
+        stat.LagTotal = m_ullLagTotal;
+        stat.LagP50 = m_stLag.GetPercentile(50);
+        stat.LagP99 = m_stLag.GetPercentile(99);
+        stat.LagMax = m_stLag.GetMax();
+        for (uint32_t i = 0; i < CALLBACK_COUNT; ++i)
+        {
+            auto& callback = m_stCallbacks[i];
+            stat.Callbacks[i].Count = callback.Histogram.GetCount();
+            stat.Callbacks[i].Total = callback.Total;
+            stat.Callbacks[i].P99 = callback.Histogram.GetPercentile(99);
+            stat.Callbacks[i].Max = callback.Histogram.GetMax();
+            callback.Histogram.Reset();
+            callback.Total = 0;
+        }
+        stat.BusyCycles = m_stCyclePackets.GetCount();
+        stat.Packets = m_ullPackets;
+        stat.PacketsP99 = m_stCyclePackets.GetPercentile(99);
+        stat.PacketsMax = m_stCyclePackets.GetMax();
+
+        m_stLag.Reset();
+        m_ullLagTotal = 0;
+        m_stCyclePackets.Reset();
+        m_ullPackets = 0;
+        return stat;
+    }
+
+private:
+    struct CallbackHistogram
+    {
+        LatencyHistogram Histogram;  // 纳秒，超过约268ms的计入最后一个桶
+        uint64_t Total = 0;
+
+        void Record(uint64_t elapsed)noexcept
+        {
+            Histogram.Record(elapsed);
+            Total += elapsed;
+        }
+    };
+
+    static void OnTimer(uv_timer_t* timer)
+    {
+        auto self = static_cast<LoopMonitor*>(timer->data);
+        if (!self)
+            return;
+
+        auto now = HiResClock::Now();
+        auto lag = now > self->m_ullExpected ? (now - self->m_ullExpected) / 1000 : 0;
+        self->m_stLag.Record(lag);
+        self->m_ullLagTotal += lag;
+
+        // 以实际触发时间为基准重新调度，一次长阻塞只计一次滞后
+        self->m_ullExpected = now + kLagIntervalMs * 1000000ull;
+        ::uv_timer_start(timer, OnTimer, kLagIntervalMs, 0);
+    }
+
+    static void OnPrepare(uv_prepare_t* prepare)
+    {
+        auto self = static_cast<LoopMonitor*>(prepare->data);
+        if (!self || self->m_uCyclePackets == 0)
+            return;
+
+        // 空转的轮次不计入，否则分布被空闲唤醒淹没
+        self->m_stCyclePackets.Record(self->m_uCyclePackets);
+        self->m_ullPackets += self->m_uCyclePackets;
+        self->m_uCyclePackets = 0;
+    }
+
+private:
+    uv_timer_t* m_pTimer = nullptr;
+    uv_prepare_t* m_pPrepare = nullptr;
+    uint64_t m_ullExpected = 0;
+
+    LatencyHistogram m_stLag;  // 微秒
+    uint64_t m_ullLagTotal = 0;
+    CallbackHistogram m_stCallbacks[CALLBACK_COUNT];
+    uint32_t m_uCyclePackets = 0;
+    LatencyHistogram m_stCyclePackets;
+    uint64_t m_ullPackets = 0;
+};
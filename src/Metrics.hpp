@@ -0,0 +1,148 @@
+#pragma once
+#include <cstdio>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Prometheus文本格式（0.0.4）的指标输出
+ */
+namespace Metrics
+{
+    /**
+     * @brief RTT直方图的桶上界（微秒）
+     *
+     * 导出时换算为秒，桶数固定以控制每个目标的时间序列数。
+     */
+    static const uint32_t kLatencyBounds[] = {
+        100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000,
+    };
+    static const size_t kLatencyBoundCount = sizeof(kLatencyBounds) / sizeof(kLatencyBounds[0]);
+
+    /**
+     * @brief 累计的时延分桶
+     *
+     * 自进程启动起单调递增，不随统计周期清零，符合Prometheus直方图的语义。
+     */
+    struct LatencyBuckets
+    {
+        uint64_t Buckets[kLatencyBoundCount + 1] = {};  // 最后一个为+Inf，非累积
+        uint64_t Count = 0;
+        uint64_t Sum = 0;  // 微秒
+
+        void Record(uint32_t latency)noexcept
+        {
+            size_t index = 0;
+            while (index < kLatencyBoundCount && latency > kLatencyBounds[index])
+                ++index;
+            ++Buckets[index];
+            ++Count;
+            Sum += latency;
+        }
+    };
+
+    /**
+     * @brief 追加一个标签，值按文本格式转义
+     */
+    inline void AppendLabel(std::string& labels, const char* key, const char* value)
+    {
+        if (!labels.empty())
+            labels.push_back(',');
+        labels.append(key);
+        labels.append("=\"");
+        for (auto p = value; *p; ++p)
+        {
+            switch (*p)
+            {
+                case '\\':
+                    labels.append("\\\\");
+                    break;
+                case '"':
+                    labels.append("\\\"");
+                    break;
+                case '\n':
+                    labels.append("\\n");
+                    break;
+                default:
+                    labels.push_back(*p);
+                    break;
+            }
+        }
+        labels.push_back('"');
+    }
+
+    class TextWriter
+    {
+    public:
+        explicit TextWriter(std::string& out)
+            : m_stOut(out) {}
+
+    public:
+        /**
+         * @brief 输出指标族的HELP和TYPE
+         */
+        void Declare(const char* name, const char* type, const char* help)
+        {
+            m_stOut.append("# HELP ").append(name).append(" ").append(help).append("\n");
+            m_stOut.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+        }
+
+        void Sample(const char* name, const std::string& labels, uint64_t value)
+        {
+            char buffer[32];
+            ::snprintf(buffer, sizeof(buffer), "%llu", static_cast<unsigned long long>(value));
+            AppendSample(name, nullptr, labels, buffer);
+        }
+
+        void Sample(const char* name, const std::string& labels, double value)
+        {
+            char buffer[32];
+            ::snprintf(buffer, sizeof(buffer), "%.9g", value);
+            AppendSample(name, nullptr, labels, buffer);
+        }
+
+        /**
+         * @brief 输出直方图的_bucket、_sum和_count，单位为秒
+         */
+        void Histogram(const char* name, const std::string& labels, const LatencyBuckets& buckets)
+        {
+            char value[32];
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i <= kLatencyBoundCount; ++i)
+            {
+                cumulative += buckets.Buckets[i];
+                m_stLabels = labels;
+                if (i < kLatencyBoundCount)
+                {
+                    ::snprintf(value, sizeof(value), "%g", kLatencyBounds[i] / 1000000.);
+                    AppendLabel(m_stLabels, "le", value);
+                }
+                else
+                {
+                    AppendLabel(m_stLabels, "le", "+Inf");
+                }
+                ::snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(cumulative));
+                AppendSample(name, "_bucket", m_stLabels, value);
+            }
+
+            ::snprintf(value, sizeof(value), "%.9g", buckets.Sum / 1000000.);
+            AppendSample(name, "_sum", labels, value);
+            ::snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(buckets.Count));
+            AppendSample(name, "_count", labels, value);
+        }
+
+    private:
+        void AppendSample(const char* name, const char* suffix, const std::string& labels, const char* value)
+        {
+            m_stOut.append(name);
+            if (suffix)
+                m_stOut.append(suffix);
+            if (!labels.empty())
+                m_stOut.append("{").append(labels).append("}");
+            m_stOut.append(" ").append(value).append("\n");
+        }
+
+    private:
+        std::string& m_stOut;
+        std::string m_stLabels;
+    };
+}
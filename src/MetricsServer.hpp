@@ -0,0 +1,270 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+
+#include <Moe.Core/Logging.hpp>
+#include <Moe.Core/Exception.hpp>
+#include <Moe.UV/RunLoop.hpp>
+
+#include "SocketUtils.hpp"
+
+/**
+ * @brief 极简HTTP指标端点
+ *
+ * 运行在当前线程的RunLoop上，只响应`GET /metrics`，每个连接处理一个请求，写完响应后关闭。
+ * 渲染回调在事件循环线程上调用，只应读取预先聚合好的计数器或快照，不触碰探测路径上的状态。
+ * 连接数和请求耗时均有上限，慢速或异常的客户端不会占住事件循环。
+ * 必须在所属RunLoop的线程上构造和析构。
+ */
+class MetricsServer
+{
+    static const size_t kMaxRequestSize = 4096;
+    static const size_t kMaxConnections = 16;
+    static const moe::Time::Tick kRequestTimeoutMs = 5000;
+
+    struct Connection
+    {
+        uv_tcp_t Handle;
+        uv_write_t WriteRequest;
+        MetricsServer* Owner;
+        moe::Time::Tick AcceptTime = 0;
+        bool Closing = false;
+        size_t RequestSize = 0;
+        char Request[kMaxRequestSize];
+        std::string Response;
+
+        uv_stream_t* GetStream()noexcept { return reinterpret_cast<uv_stream_t*>(&Handle); }
+    };
+
+public:
+    using OnRenderCallbackType = std::function<void(std::string& out)>;
+
+public:
+    MetricsServer(const std::string& addr, uint16_t port)
+        : m_pListener(new uv_tcp_t()), m_pTimer(new uv_timer_t())
+    {
+        auto loop = moe::UV::RunLoop::GetCurrentUVLoop();
+        ::uv_tcp_init(loop, m_pListener);
+        m_pListener->data = this;
+        ::uv_timer_init(loop, m_pTimer);
+        m_pTimer->data = this;
+
+        sockaddr_storage storage;
+        SocketUtils::ParseAddress(addr, port, storage);
+        auto ret = ::uv_tcp_bind(m_pListener, reinterpret_cast<const sockaddr*>(&storage), 0);
+        if (ret != 0)
+        {
+            Close();
+            MOE_THROW(moe::APIException, "Bind metrics socket error: {0}", ::uv_strerror(ret));
+        }
+    }
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    ~MetricsServer()
+    {
+        Close();
+    }
+
+public:
+    void SetOnRenderCallback(const OnRenderCallbackType& callback) { m_stOnRender = callback; }
+
+    void Start()
+    {
+        auto ret = ::uv_listen(reinterpret_cast<uv_stream_t*>(m_pListener), static_cast<int>(kMaxConnections),
+            OnListenerConnection);
+        if (ret != 0)
+            MOE_THROW(moe::APIException, "Listen metrics socket error: {0}", ::uv_strerror(ret));
+        ::uv_timer_start(m_pTimer, OnTimer, 1000, 1000);
+    }
+
+private:
+    void Close()noexcept
+    {
+        // 句柄内存需要在关闭回调中释放
+        m_pListener->data = nullptr;
+        ::uv_close(reinterpret_cast<uv_handle_t*>(m_pListener), [](uv_handle_t* handle) {
+            delete reinterpret_cast<uv_tcp_t*>(handle);
+        });
+        m_pTimer->data = nullptr;
+        ::uv_close(reinterpret_cast<uv_handle_t*>(m_pTimer), [](uv_handle_t* handle) {
+            delete reinterpret_cast<uv_timer_t*>(handle);
+        });
+
+        for (auto conn : m_stConnections)
+        {
+            conn->Owner = nullptr;
+            CloseConnection(conn);
+        }
+        m_stConnections.clear();
+    }
+
+    void OnConnection()
+    {
+        auto conn = new Connection();
+        conn->Owner = this;
+        conn->AcceptTime = moe::UV::RunLoop::Now();
+        ::uv_tcp_init(moe::UV::RunLoop::GetCurrentUVLoop(), &conn->Handle);
+        conn->Handle.data = conn;
+        conn->WriteRequest.data = conn;
+        m_stConnections.push_back(conn);
+
+        auto ret = ::uv_accept(reinterpret_cast<uv_stream_t*>(m_pListener), conn->GetStream());
+        if (ret != 0 || m_stConnections.size() > kMaxConnections)
+        {
+            // 超出连接上限时也要accept，否则连接会一直堆积在backlog中
+            RemoveConnection(conn);
+            return;
+        }
+
+        ret = ::uv_read_start(conn->GetStream(), OnAlloc, OnRead);
+        if (ret != 0)
+            RemoveConnection(conn);
+    }
+
+    void OnRequest(Connection* conn)
+    {
+        // 只解析请求行，忽略所有头部
+        const char* status = "200 OK";
+        std::string body;
+        auto lineEnd = std::find(conn->Request, conn->Request + conn->RequestSize, '\r');
+        std::string line(conn->Request, lineEnd);
+        auto methodEnd = line.find(' ');
+        auto pathEnd = methodEnd == std::string::npos ? std::string::npos : line.find_first_of(" ?", methodEnd + 1);
+        if (methodEnd == std::string::npos || pathEnd == std::string::npos)
+        {
+            status = "400 Bad Request";
+        }
+        else if (line.compare(0, methodEnd, "GET") != 0)
+        {
+            status = "405 Method Not Allowed";
+        }
+        else if (line.compare(methodEnd + 1, pathEnd - methodEnd - 1, "/metrics") != 0)
+        {
+            status = "404 Not Found";
+        }
+        else if (m_stOnRender)
+        {
+            body.reserve(m_uLastResponseSize);
+            m_stOnRender(body);
+            m_uLastResponseSize = body.size();
+        }
+
+        char header[256];
+        ::snprintf(header, sizeof(header), "HTTP/1.1 %s\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+            "Content-Length: %llu\r\nConnection: close\r\n\r\n", status, static_cast<unsigned long long>(body.size()));
+        conn->Response.reserve(::strlen(header) + body.size());
+        conn->Response.append(header);
+        conn->Response.append(body);
+
+        auto buf = ::uv_buf_init(&conn->Response[0], static_cast<unsigned>(conn->Response.size()));
+        auto ret = ::uv_write(&conn->WriteRequest, conn->GetStream(), &buf, 1, OnWrite);
+        if (ret != 0)
+            RemoveConnection(conn);
+    }
+
+    void OnTick()
+    {
+        auto now = moe::UV::RunLoop::Now();
+        auto connections = m_stConnections;
+        for (auto conn : connections)
+        {
+            if (now - conn->AcceptTime >= kRequestTimeoutMs)
+                RemoveConnection(conn);
+        }
+    }
+
+    void RemoveConnection(Connection* conn)
+    {
+        auto it = std::find(m_stConnections.begin(), m_stConnections.end(), conn);
+        if (it != m_stConnections.end())
+        {
+            *it = m_stConnections.back();
+            m_stConnections.pop_back();
+        }
+        CloseConnection(conn);
+    }
+
+    static void CloseConnection(Connection* conn)noexcept
+    {
+        if (conn->Closing)
+            return;
+        conn->Closing = true;
+        ::uv_close(reinterpret_cast<uv_handle_t*>(&conn->Handle), [](uv_handle_t* handle) {
+            delete static_cast<Connection*>(handle->data);
+        });
+    }
+
+    static void OnListenerConnection(uv_stream_t* server, int status)
+    {
+        auto self = static_cast<MetricsServer*>(server->data);
+        if (!self)
+            return;
+        if (status < 0)
+            MOE_LOG_ERROR("Metrics socket error: {0}", status);
+        else
+            self->OnConnection();
+    }
+
+    static void OnTimer(uv_timer_t* timer)
+    {
+        auto self = static_cast<MetricsServer*>(timer->data);
+        if (self)
+            self->OnTick();
+    }
+
+    static void OnAlloc(uv_handle_t* handle, size_t, uv_buf_t* buf)
+    {
+        auto conn = static_cast<Connection*>(handle->data);
+        *buf = ::uv_buf_init(conn->Request + conn->RequestSize, static_cast<unsigned>(kMaxRequestSize - conn->RequestSize));
+    }
+
+    static void OnRead(uv_stream_t* stream, ssize_t nread, const uv_buf_t*)
+    {
+        auto conn = static_cast<Connection*>(stream->data);
+        if (conn->Closing || !conn->Owner)
+            return;
+        if (nread < 0)
+        {
+            conn->Owner->RemoveConnection(conn);
+            return;
+        }
+
+        auto offset = conn->RequestSize;
+        conn->RequestSize += static_cast<size_t>(nread);
+
+        // 从本次数据之前三个字节开始查找，以覆盖被切开的分隔符
+        static const char kHeaderEnd[] = "\r\n\r\n";
+        auto searchBegin = conn->Request + (offset > 3 ? offset - 3 : 0);
+        auto end = conn->Request + conn->RequestSize;
+        if (std::search(searchBegin, end, kHeaderEnd, kHeaderEnd + 4) != end)
+        {
+            ::uv_read_stop(stream);
+            conn->Owner->OnRequest(conn);
+        }
+        else if (conn->RequestSize >= kMaxRequestSize)
+        {
+            conn->Owner->RemoveConnection(conn);
+        }
+    }
+
+    static void OnWrite(uv_write_t* req, int)
+    {
+        auto conn = static_cast<Connection*>(req->data);
+        if (conn->Owner)
+            conn->Owner->RemoveConnection(conn);
+        else
+            CloseConnection(conn);
+    }
+
+private:
+    uv_tcp_t* m_pListener = nullptr;
+    uv_timer_t* m_pTimer = nullptr;
+    OnRenderCallbackType m_stOnRender;
+    std::vector<Connection*> m_stConnections;
+    size_t m_uLastResponseSize = 0;
+};
@@ -0,0 +1,134 @@
+#pragma once
+#include <cstdint>
+#include <algorithm>
+
+#include "Histogram.hpp"
+
+/**
+ * @brief 单向时延统计（微秒）
+ */
+struct OneWayDelayStatistic
+{
+    uint32_t Count;
+    int64_t ClockOffset;  // 服务端时钟减客户端时钟的估计值（纳秒）
+    uint64_t ForwardTotal;
+    uint32_t ForwardMax;
+    uint32_t ForwardP99;
+    uint64_t ReverseTotal;
+    uint32_t ReverseMax;
+    uint32_t ReverseP99;
+    uint64_t DwellTotal;
+    uint32_t DwellMax;
+    uint32_t DwellP99;
+};
+
+/**
+ * @brief 基于服务端收发时间戳的单向时延估计
+ *
+ * 记T1为客户端发送、T2为服务端接收、T3为服务端发送、T4为客户端接收时间，则
+ *   RTT = (T4 - T1) - (T3 - T2)，时钟偏移 = ((T2 - T1) + (T3 - T4)) / 2
+ * 偏移在路径对称时准确，排队会使其偏向排队较重的一侧，因此与NTP的时钟过滤相同，只采用RTT最小的样本的偏移。
+ * 最小值在当前和上一个统计周期中选取，既能跟随时钟漂移，又不会在周期刚开始时失去估计。
+ */
+class OneWayDelayTracker
+{
+public:
+    /**
+     * @brief 记录一次探测，时间均为纳秒
+     */
+    void Record(uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4)noexcept
+    {
+        if (t4 < t1 || t3 < t2)
+            return;
+
+        auto dwell = t3 - t2;
+        auto rtt = t4 - t1;
+        rtt = rtt > dwell ? rtt - dwell : 0;
+
+        auto offset = (static_cast<int64_t>(t2 - t1) + static_cast<int64_t>(t3 - t4)) / 2;
+        if (rtt < m_ullCurrentMinRtt)
+        {
+            m_ullCurrentMinRtt = rtt;
+            m_llCurrentOffset = offset;
+        }
+
+        auto estimate = GetClockOffset();
+        auto forward = ClampToUs(static_cast<int64_t>(t2 - t1) - estimate);
+        auto reverse = ClampToUs(static_cast<int64_t>(t4 - t3) + estimate);
+        auto dwellUs = ClampToUs(static_cast<int64_t>(dwell));
+
+        ++m_uCount;
+        m_ullForwardTotal += forward;
+        m_ullReverseTotal += reverse;
+        m_ullDwellTotal += dwellUs;
+        m_stForward.Record(forward);
+        m_stReverse.Record(reverse);
+        m_stDwell.Record(dwellUs);
+    }
+
+    /**
+     * @brief 获取当前的时钟偏移估计（纳秒）
+     */
+    int64_t GetClockOffset()const noexcept
+    {
+        return m_ullCurrentMinRtt <= m_ullPreviousMinRtt ? m_llCurrentOffset : m_llPreviousOffset;
+    }
+
+    OneWayDelayStatistic GetStatistic()const noexcept
+    {
+        OneWayDelayStatistic desc {};
+        desc.Count = m_uCount;
+        desc.ClockOffset = GetClockOffset();
+        desc.ForwardTotal = m_ullForwardTotal;
+        desc.ForwardMax = static_cast<uint32_t>(m_stForward.GetMax());
+        desc.ForwardP99 = static_cast<uint32_t>(m_stForward.GetPercentile(99));
+        desc.ReverseTotal = m_ullReverseTotal;
+        desc.ReverseMax = static_cast<uint32_t>(m_stReverse.GetMax());
+        desc.ReverseP99 = static_cast<uint32_t>(m_stReverse.GetPercentile(99));
+        desc.DwellTotal = m_ullDwellTotal;
+        desc.DwellMax = static_cast<uint32_t>(m_stDwell.GetMax());
+        desc.DwellP99 = static_cast<uint32_t>(m_stDwell.GetPercentile(99));
+        return desc;
+    }
+
+    /**
+     * @brief 开始新的统计周期，保留上一周期的偏移估计
+     */
+    void Reset()noexcept
+    {
+        if (m_ullCurrentMinRtt != UINT64_MAX)
+        {
+            m_ullPreviousMinRtt = m_ullCurrentMinRtt;
+            m_llPreviousOffset = m_llCurrentOffset;
+        }
+        m_ullCurrentMinRtt = UINT64_MAX;
+        m_llCurrentOffset = 0;
+
+        m_uCount = 0;
+        m_ullForwardTotal = m_ullReverseTotal = m_ullDwellTotal = 0;
+        m_stForward.Reset();
+        m_stReverse.Reset();
+        m_stDwell.Reset();
+    }
+
+private:
+    static uint64_t ClampToUs(int64_t ns)noexcept
+    {
+        // 估计误差可能使单向时延为负，按0计
+        return ns <= 0 ? 0 : static_cast<uint64_t>(ns) / 1000;
+    }
+
+private:
+    uint64_t m_ullCurrentMinRtt = UINT64_MAX;  // 本周期最小RTT
+    int64_t m_llCurrentOffset = 0;  // 本周期最小RTT样本的偏移
+    uint64_t m_ullPreviousMinRtt = UINT64_MAX;
+    int64_t m_llPreviousOffset = 0;
+
+    uint32_t m_uCount = 0;
+    uint64_t m_ullForwardTotal = 0;
+    uint64_t m_ullReverseTotal = 0;
+    uint64_t m_ullDwellTotal = 0;
+    LatencyHistogram m_stForward;
+    LatencyHistogram m_stReverse;
+    LatencyHistogram m_stDwell;
+};
@@ -0,0 +1,416 @@
+#pragma once
+#ifdef __linux__
+#include <atomic>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <utility>
+
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/filter.h>
+
+#include <Moe.Core/Exception.hpp>
+
+#include "SocketUtils.hpp"
+#include "HiResClock.hpp"
+#include "PingPacket.hpp"
+
+/**
+ * @brief 基于PACKET_MMAP的UDP回射器
+ *
+ * 在指定网卡上用AF_PACKET的TPACKET_V2收发环直接处理发往探测端口的数据报：交换MAC/IP/端口后
+ * 写入发送环，一批数据报只需一次send()触发发送，发送绕过qdisc。经典BPF过滤器只放行目标端口的
+ * IPv4/IPv6 UDP报文（不含分片和IPv6扩展头），RX时间取自内核的收包时间戳。
+ *
+ * AF_PACKET只复制报文，内核协议栈仍会处理原报文，因此同时在该端口上绑定一个不读取的UDP socket，
+ * 避免内核回送ICMP端口不可达；该socket的接收队列满后内核直接丢弃。
+ * 需要CAP_NET_RAW。单线程运行，Run()在调用线程上循环直到Stop()。
+ */
+class PacketReflector
+{
+public:
+    static const uint32_t kFrameSize = 2048;  // 超过的报文（如巨帧）被忽略
+    static const uint32_t kBlockSize = 1 << 20;
+    static const uint32_t kBlockCount = 8;
+    static const uint32_t kFrameCount = kBlockSize / kFrameSize * kBlockCount;
+    static const uint32_t kMaxBatch = 256;
+    static const int kPollTimeoutMs = 100;
+
+public:
+    /**
+     * @param ifname 网卡名
+     * @param addr 占位UDP socket绑定的地址
+     * @param port 探测端口
+     * @param timestamps 是否为请求时间戳的探测写入服务端时间戳
+     */
+    PacketReflector(const std::string& ifname, const std::string& addr, uint16_t port, bool timestamps)
+        : m_bTimestamps(timestamps)
+    {
+        auto ifindex = ::if_nametoindex(ifname.c_str());
+        if (ifindex == 0)
+            MOE_THROW(moe::BadArgumentException, "Unknown interface {0}", ifname);
+
+        // 先以协议0创建，挂好过滤器和收发环之后再bind，避免收到未过滤的报文
+        m_iFd = ::socket(AF_PACKET, SOCK_RAW, 0);
+        if (m_iFd < 0)
+            MOE_THROW(moe::APIException, "socket(AF_PACKET) failed, errno {0} (CAP_NET_RAW required)", errno);
+
+        try
+        {
+            AttachFilter(port);
+            SetupRings();
+
+            sockaddr_ll sll;
+            ::memset(&sll, 0, sizeof(sll));
+            sll.sll_family = AF_PACKET;
+            sll.sll_protocol = htons(ETH_P_ALL);
+            sll.sll_ifindex = static_cast<int>(ifindex);
+            if (::bind(m_iFd, reinterpret_cast<sockaddr*>(&sll), sizeof(sll)) != 0)
+                MOE_THROW(moe::APIException, "Bind packet socket to {0} failed, errno {1}", ifname, errno);
+
+            m_iPlaceholderFd = SocketUtils::CreateBoundSocket(SOCK_DGRAM, addr, port, false);
+            int size = 1;
+            ::setsockopt(m_iPlaceholderFd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        }
+        catch (...)
+        {
+            Close();
+            throw;
+        }
+    }
+
+    PacketReflector(const PacketReflector&) = delete;
+    PacketReflector& operator=(const PacketReflector&) = delete;
+
+    ~PacketReflector()
+    {
+        Close();
+    }
+
+public:
+    uint64_t GetEchoCount()const noexcept { return m_ullEchoCount.load(std::memory_order_relaxed); }
+    uint64_t GetEchoBytes()const noexcept { return m_ullEchoBytes.load(std::memory_order_relaxed); }
+    uint64_t GetBatchCount()const noexcept { return m_ullBatchCount.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 发送环满而丢弃的回射数
+     */
+    uint64_t GetDropCount()const noexcept { return m_ullDropCount.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 运行回射循环
+     * @param cpu 绑定到的CPU，小于0时不绑定
+     * @param busyPoll 为true时空转轮询收包环，否则没有报文时在poll()上等待
+     *
+     * 忙轮询时回射的驻留时间最稳定，但会占满一个核，应与cpu一起使用。
+     */
+    void Run(int cpu, bool busyPoll)
+    {
+        if (cpu >= 0)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            auto ret = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+            if (ret != 0)
+                MOE_THROW(moe::APIException, "Pin reflector to cpu {0} failed, errno {1}", cpu, ret);
+        }
+
+        while (!m_bStopping.load(std::memory_order_relaxed))
+        {
+            auto count = Drain();
+            if (count == 0 && !busyPoll)
+            {
+                pollfd fds;
+                fds.fd = m_iFd;
+                fds.events = POLLIN;
+                fds.revents = 0;
+                ::poll(&fds, 1, kPollTimeoutMs);
+            }
+        }
+    }
+
+    void Stop()noexcept
+    {
+        m_bStopping.store(true, std::memory_order_relaxed);
+    }
+
+private:
+    void AttachFilter(uint16_t port)
+    {
+        // 以太网帧：IPv4/UDP且非分片，或IPv6且下一个头为UDP，目的端口匹配
+        sock_filter code[] = {
+            BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IP, 0, 7),
+            BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 23),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 11),
+            BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 20),
+            BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1FFF, 9, 0),
+            BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 14),
+            BPF_STMT(BPF_LD | BPF_H | BPF_IND, 16),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, port, 5, 6),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IPV6, 0, 5),
+            BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 20),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 3),
+            BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 56),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, port, 0, 1),
+            BPF_STMT(BPF_RET | BPF_K, 0xFFFF),
+            BPF_STMT(BPF_RET | BPF_K, 0),
+        };
+        sock_fprog prog;
+        prog.len = sizeof(code) / sizeof(code[0]);
+        prog.filter = code;
+        if (::setsockopt(m_iFd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) != 0)
+            MOE_THROW(moe::APIException, "Attach packet filter failed, errno {0}", errno);
+    }
+
+    void SetupRings()
+    {
+        int version = TPACKET_V2;
+        if (::setsockopt(m_iFd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0)
+            MOE_THROW(moe::APIException, "Set TPACKET_V2 failed, errno {0}", errno);
+
+        // 内核不支持时退回经过qdisc的发送，不影响正确性
+        int on = 1;
+        ::setsockopt(m_iFd, SOL_PACKET, PACKET_QDISC_BYPASS, &on, sizeof(on));
+
+        tpacket_req req;
+        req.tp_block_size = kBlockSize;
+        req.tp_block_nr = kBlockCount;
+        req.tp_frame_size = kFrameSize;
+        req.tp_frame_nr = kFrameCount;
+        if (::setsockopt(m_iFd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) != 0 ||
+            ::setsockopt(m_iFd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) != 0)
+        {
+            MOE_THROW(moe::APIException, "Setup packet rings failed, errno {0}", errno);
+        }
+
+        // 收包环在前，发包环紧随其后
+        m_uMapSize = static_cast<size_t>(kBlockSize) * kBlockCount * 2;
+        auto map = ::mmap(nullptr, m_uMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_iFd, 0);
+        if (map == MAP_FAILED)
+            MOE_THROW(moe::APIException, "mmap packet rings failed, errno {0}", errno);
+        m_pRxRing = static_cast<uint8_t*>(map);
+        m_pTxRing = m_pRxRing + m_uMapSize / 2;
+    }
+
+    void Close()noexcept
+    {
+        if (m_pRxRing)
+            ::munmap(m_pRxRing, m_uMapSize);
+        if (m_iFd >= 0)
+            ::close(m_iFd);
+        if (m_iPlaceholderFd >= 0)
+            ::close(m_iPlaceholderFd);
+        m_pRxRing = m_pTxRing = nullptr;
+        m_iFd = m_iPlaceholderFd = -1;
+    }
+
+    static tpacket2_hdr* GetFrame(uint8_t* ring, uint32_t index)noexcept
+    {
+        return reinterpret_cast<tpacket2_hdr*>(ring + static_cast<size_t>(index) * kFrameSize);
+    }
+
+    /**
+     * @brief 处理收包环中已就绪的报文
+     * @return 处理的报文数
+     */
+    uint32_t Drain()noexcept
+    {
+        uint32_t count = 0, queued = 0;
+        uint64_t bytes = 0;
+        while (count < kMaxBatch)
+        {
+            auto hdr = GetFrame(m_pRxRing, m_uRxIndex);
+            if (!(__atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+                break;
+
+            auto sll = reinterpret_cast<const sockaddr_ll*>(reinterpret_cast<uint8_t*>(hdr) + TPACKET_ALIGN(sizeof(tpacket2_hdr)));
+            if (sll->sll_pkttype == PACKET_HOST && hdr->tp_snaplen == hdr->tp_len)
+            {
+                auto rxTime = static_cast<uint64_t>(hdr->tp_sec) * 1000000000ull + hdr->tp_nsec;
+                auto partial = (hdr->tp_status & TP_STATUS_CSUMNOTREADY) != 0;
+                auto length = Reflect(reinterpret_cast<uint8_t*>(hdr) + hdr->tp_mac, hdr->tp_snaplen, rxTime, partial);
+                if (length > 0)
+                {
+                    ++queued;
+                    bytes += length;
+                }
+            }
+
+            __atomic_store_n(&hdr->tp_status, static_cast<uint32_t>(TP_STATUS_KERNEL), __ATOMIC_RELEASE);
+            m_uRxIndex = (m_uRxIndex + 1) % kFrameCount;
+            ++count;
+        }
+
+        if (queued > 0)
+        {
+            ::send(m_iFd, nullptr, 0, MSG_DONTWAIT);
+            m_ullEchoCount.fetch_add(queued, std::memory_order_relaxed);
+            m_ullEchoBytes.fetch_add(bytes, std::memory_order_relaxed);
+            m_ullBatchCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        return count;
+    }
+
+    /**
+     * @brief 将一个报文改写为回射写入发包环
+     * @return 排队发送的UDP负载长度，报文不合法或发包环满时返回0
+     */
+    size_t Reflect(const uint8_t* frame, size_t length, uint64_t rxTime, bool partialChecksum)noexcept
+    {
+        if (length < ETH_HLEN || length > kFrameSize - kTxDataOffset)
+            return 0;
+
+        auto tx = GetFrame(m_pTxRing, m_uTxIndex);
+        auto status = __atomic_load_n(&tx->tp_status, __ATOMIC_ACQUIRE);
+        if (status != TP_STATUS_AVAILABLE && status != TP_STATUS_WRONG_FORMAT)
+        {
+            m_ullDropCount.fetch_add(1, std::memory_order_relaxed);
+            return 0;
+        }
+
+        auto data = reinterpret_cast<uint8_t*>(tx) + kTxDataOffset;
+        ::memcpy(data, frame, length);
+        auto payload = Rewrite(data, length, rxTime, partialChecksum);
+        if (payload == 0)
+            return 0;
+
+        tx->tp_len = static_cast<uint32_t>(length);
+        __atomic_store_n(&tx->tp_status, static_cast<uint32_t>(TP_STATUS_SEND_REQUEST), __ATOMIC_RELEASE);
+        m_uTxIndex = (m_uTxIndex + 1) % kFrameCount;
+        return payload;
+    }
+
+    /**
+     * @brief 原地交换地址和端口，必要时写入时间戳并更新校验和
+     * @param length 帧长度，去掉以太网填充后写回
+     * @param partialChecksum UDP校验和尚未完成（本机发出、由网卡卸载计算，如回环上的报文）
+     * @return UDP负载长度，报文不合法时返回0
+     */
+    size_t Rewrite(uint8_t* frame, size_t& length, uint64_t rxTime, bool partialChecksum)noexcept
+    {
+        uint8_t mac[ETH_ALEN];
+        ::memcpy(mac, frame, ETH_ALEN);
+        ::memcpy(frame, frame + ETH_ALEN, ETH_ALEN);
+        ::memcpy(frame + ETH_ALEN, mac, ETH_ALEN);
+
+        auto ip = frame + ETH_HLEN;
+        auto ipLength = length - ETH_HLEN;
+        auto type = ReadU16(frame + 12);
+        uint8_t* udp = nullptr;
+        uint32_t pseudo = 0;
+        if (type == ETH_P_IP)
+        {
+            size_t ihl = (ip[0] & 0x0F) * 4u;
+            size_t total = ReadU16(ip + 2);
+            if (ihl < 20 || total < ihl + 8 || total > ipLength)
+                return 0;
+            length = ETH_HLEN + total;
+            SwapBytes(ip + 12, ip + 16, 4);
+            ip[8] = kReplyHopLimit;
+            ip[10] = ip[11] = 0;
+            WriteU16(ip + 10, Fold(Sum(ip, ihl, 0)));
+            udp = ip + ihl;
+            pseudo = Sum(ip + 12, 8, IPPROTO_UDP);
+        }
+        else if (type == ETH_P_IPV6)
+        {
+            size_t total = 40 + ReadU16(ip + 4);
+            if (total < 48 || total > ipLength)
+                return 0;
+            length = ETH_HLEN + total;
+            SwapBytes(ip + 8, ip + 24, 16);
+            ip[7] = kReplyHopLimit;
+            udp = ip + 40;
+            pseudo = Sum(ip + 8, 32, IPPROTO_UDP);
+        }
+        else
+        {
+            return 0;
+        }
+
+        size_t udpLength = ReadU16(udp + 4);
+        if (udpLength < 8 || udp + udpLength > frame + length)
+            return 0;
+        SwapBytes(udp, udp + 2, 2);
+
+        // 交换源和目的不改变校验和，只有写入时间戳或校验和未完成时需要重算
+        auto hasChecksum = type == ETH_P_IPV6 || ReadU16(udp + 6) != 0;
+        auto stamped = m_bTimestamps &&
+            PingPacketCodec::StampServerTimestamps(udp + 8, udpLength - 8, rxTime, HiResClock::RealtimeNow());
+        if ((stamped || partialChecksum) && hasChecksum)
+        {
+            udp[6] = udp[7] = 0;
+            auto sum = Fold(Sum(udp, udpLength, pseudo + static_cast<uint32_t>(udpLength)));
+            WriteU16(udp + 6, sum == 0 ? 0xFFFF : sum);
+        }
+        return udpLength - 8;
+    }
+
+    static uint16_t ReadU16(const uint8_t* p)noexcept
+    {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    static void WriteU16(uint8_t* p, uint16_t value)noexcept
+    {
+        p[0] = static_cast<uint8_t>(value >> 8);
+        p[1] = static_cast<uint8_t>(value);
+    }
+
+    static void SwapBytes(uint8_t* a, uint8_t* b, size_t length)noexcept
+    {
+        for (size_t i = 0; i < length; ++i)
+            std::swap(a[i], b[i]);
+    }
+
+    /**
+     * @brief 网络字节序的16位反码累加
+     */
+    static uint32_t Sum(const uint8_t* p, size_t length, uint32_t sum)noexcept
+    {
+        for (; length > 1; p += 2, length -= 2)
+            sum += ReadU16(p);
+        if (length > 0)
+            sum += static_cast<uint32_t>(p[0]) << 8;
+        return sum;
+    }
+
+    static uint16_t Fold(uint32_t sum)noexcept
+    {
+        while (sum >> 16)
+            sum = (sum & 0xFFFF) + (sum >> 16);
+        return static_cast<uint16_t>(~sum);
+    }
+
+private:
+    static const size_t kTxDataOffset = TPACKET2_HDRLEN - sizeof(sockaddr_ll);
+    static const uint8_t kReplyHopLimit = 64;
+
+    const bool m_bTimestamps;
+    int m_iFd = -1;
+    int m_iPlaceholderFd = -1;
+    uint8_t* m_pRxRing = nullptr;
+    uint8_t* m_pTxRing = nullptr;
+    size_t m_uMapSize = 0;
+    uint32_t m_uRxIndex = 0;
+    uint32_t m_uTxIndex = 0;
+
+    std::atomic<bool> m_bStopping { false };
+    std::atomic<uint64_t> m_ullEchoCount { 0 };
+    std::atomic<uint64_t> m_ullEchoBytes { 0 };
+    std::atomic<uint64_t> m_ullBatchCount { 0 };
+    std::atomic<uint64_t> m_ullDropCount { 0 };
+};
+#else
+class PacketReflector;
+#endif
@@ -0,0 +1,214 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+
+#include <Moe.Core/Mdr.hpp>
+#include <Moe.Core/Time.hpp>
+
+/**
+ * @brief PING包
+ *
+ * 可以使用Mdr或定长二进制格式编码，接收方按Magic自动识别。
+ */
+struct PingPacket
+{
+    MOE_DR_FIELDS(
+        (0, uint32_t, Seq),
+        (1, moe::Time::Tick, SendTime),
+        (2, uint64_t, SendTimeNs),  // 高精度模式下的发送时间（纳秒）
+        (3, uint32_t, TargetId),  // 多目标模式下用于分发共享Socket上的回包
+        (4, uint64_t, ServerRxTime),  // 服务端接收时间（纳秒，CLOCK_REALTIME），0表示未提供
+        (5, uint64_t, ServerTxTime)  // 服务端发送时间（纳秒，CLOCK_REALTIME）
+    )
+};
+
+/**
+ * @brief 定长二进制格式
+ *
+ * 所有字段为小端序，布局在编译期确定，编解码不分配内存也不抛出异常：
+ *
+ *   0  Magic        u32  "MPNG"
+ *   4  Version      u8
+ *   5  Flags        u8   FLAG_SERVER_TIMESTAMPS | FLAG_PADDED
+ *   6  PaddedLength u16  仅当设置FLAG_PADDED，含填充在内的总长度，否则为0
+ *   8  TargetId     u32
+ *   12 Seq          u32
+ *   16 SendTime     u64
+ *   24 SendTimeNs   u64
+ *   32 ServerRxTime u64  仅当设置FLAG_SERVER_TIMESTAMPS
+ *   40 ServerTxTime u64  仅当设置FLAG_SERVER_TIMESTAMPS
+ *
+ * 设置FLAG_PADDED时包尾以零填充至PaddedLength，用于按尺寸探测路径MTU，回包短于该长度视为被截断。
+ */
+namespace PingPacketCodec
+{
+    static const uint32_t kMagic = 0x474E504Du;
+    static const uint8_t kVersion = 1;
+
+    enum : uint8_t
+    {
+        FLAG_SERVER_TIMESTAMPS = 1u << 0,
+        FLAG_PADDED = 1u << 1,
+    };
+
+    template <typename T>
+    struct LittleEndian
+    {
+        static_assert(std::is_unsigned<T>::value, "Only unsigned integers are supported");
+
+        static void Store(uint8_t* p, T value)noexcept
+        {
+            for (size_t i = 0; i < sizeof(T); ++i)
+                p[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+
+        static T Load(const uint8_t* p)noexcept
+        {
+            T value = 0;
+            for (size_t i = 0; i < sizeof(T); ++i)
+                value |= static_cast<T>(static_cast<T>(p[i]) << (8 * i));
+            return value;
+        }
+    };
+
+    template <>
+    struct LittleEndian<uint8_t>
+    {
+        static void Store(uint8_t* p, uint8_t value)noexcept { *p = value; }
+        static uint8_t Load(const uint8_t* p)noexcept { return *p; }
+    };
+
+    template <size_t Offset, typename T>
+    struct Field
+    {
+        static const size_t kOffset = Offset;
+        static const size_t kEnd = Offset + sizeof(T);
+
+        static void Store(uint8_t* base, T value)noexcept { LittleEndian<T>::Store(base + Offset, value); }
+        static T Load(const uint8_t* base)noexcept { return LittleEndian<T>::Load(base + Offset); }
+    };
+
+    using MagicField = Field<0, uint32_t>;
+    using VersionField = Field<MagicField::kEnd, uint8_t>;
+    using FlagsField = Field<VersionField::kEnd, uint8_t>;
+    using PaddedLengthField = Field<FlagsField::kEnd, uint16_t>;
+    using TargetIdField = Field<PaddedLengthField::kEnd, uint32_t>;
+    using SeqField = Field<TargetIdField::kEnd, uint32_t>;
+    using SendTimeField = Field<SeqField::kEnd, uint64_t>;
+    using SendTimeNsField = Field<SendTimeField::kEnd, uint64_t>;
+    using ServerRxTimeField = Field<SendTimeNsField::kEnd, uint64_t>;
+    using ServerTxTimeField = Field<ServerRxTimeField::kEnd, uint64_t>;
+
+    static const size_t kBaseSize = SendTimeNsField::kEnd;
+    static const size_t kMaxSize = ServerTxTimeField::kEnd;
+
+    static const size_t kMaxPaddedSize = 9216;  // 覆盖9000字节的巨型帧
+
+    static_assert(kBaseSize == 32 && kMaxSize == 48, "Unexpected wire layout");
+
+    enum class DecodeResult
+    {
+        Ok,
+        NotBinary,  // Magic不匹配，应按Mdr解码
+        BadVersion,
+        Truncated,
+    };
+
+    /**
+     * @brief 判断数据是否为二进制格式
+     */
+    inline bool IsBinary(const uint8_t* data, size_t length)noexcept
+    {
+        return length >= MagicField::kEnd && MagicField::Load(data) == kMagic;
+    }
+
+    /**
+     * @brief 编码
+     * @param out 输出缓冲，至少kMaxSize字节，指定paddedLength时至少paddedLength字节
+     * @param requestServerTimestamps 即使时间戳为0也预留服务端时间戳块，请求反射端填写
+     * @param paddedLength 填充后的总长度，不超过头部长度时不填充
+     * @return 编码后的长度
+     *
+     * 填充区的内容不被写入，调用方复用同一块预先清零的缓冲即可。
+     */
+    inline size_t Encode(const PingPacket& packet, uint8_t* out, bool requestServerTimestamps = false,
+        size_t paddedLength = 0)noexcept
+    {
+        auto hasServerTimestamps = requestServerTimestamps || packet.ServerRxTime != 0 || packet.ServerTxTime != 0;
+        auto length = hasServerTimestamps ? kMaxSize : kBaseSize;
+        auto padded = paddedLength > length && paddedLength <= kMaxPaddedSize;
+
+        MagicField::Store(out, kMagic);
+        VersionField::Store(out, kVersion);
+        FlagsField::Store(out, static_cast<uint8_t>((hasServerTimestamps ? FLAG_SERVER_TIMESTAMPS : 0) |
+            (padded ? FLAG_PADDED : 0)));
+        PaddedLengthField::Store(out, padded ? static_cast<uint16_t>(paddedLength) : 0);
+        TargetIdField::Store(out, packet.TargetId);
+        SeqField::Store(out, packet.Seq);
+        SendTimeField::Store(out, packet.SendTime);
+        SendTimeNsField::Store(out, packet.SendTimeNs);
+        if (hasServerTimestamps)
+        {
+            ServerRxTimeField::Store(out, packet.ServerRxTime);
+            ServerTxTimeField::Store(out, packet.ServerTxTime);
+        }
+        return padded ? paddedLength : length;
+    }
+
+    /**
+     * @brief 获取二进制包声明的填充长度
+     * @return 未填充或不是二进制包时返回0
+     */
+    inline size_t GetPaddedLength(const uint8_t* data, size_t length)noexcept
+    {
+        if (length < kBaseSize || !IsBinary(data, length) || !(FlagsField::Load(data) & FLAG_PADDED))
+            return 0;
+        return PaddedLengthField::Load(data);
+    }
+
+    /**
+     * @brief 解码
+     */
+    inline DecodeResult Decode(const uint8_t* data, size_t length, PingPacket& packet)noexcept
+    {
+        if (!IsBinary(data, length))
+            return DecodeResult::NotBinary;
+        if (length < kBaseSize)
+            return DecodeResult::Truncated;
+        if (VersionField::Load(data) != kVersion)
+            return DecodeResult::BadVersion;
+
+        auto flags = FlagsField::Load(data);
+        packet.TargetId = TargetIdField::Load(data);
+        packet.Seq = SeqField::Load(data);
+        packet.SendTime = SendTimeField::Load(data);
+        packet.SendTimeNs = SendTimeNsField::Load(data);
+        packet.ServerRxTime = packet.ServerTxTime = 0;
+        if (flags & FLAG_SERVER_TIMESTAMPS)
+        {
+            if (length < kMaxSize)
+                return DecodeResult::Truncated;
+            packet.ServerRxTime = ServerRxTimeField::Load(data);
+            packet.ServerTxTime = ServerTxTimeField::Load(data);
+        }
+        return DecodeResult::Ok;
+    }
+
+    /**
+     * @brief 反射端原地写入服务端时间戳
+     *
+     * 只处理预留了时间戳块的二进制包，其他数据保持原样回射。
+     * @return 是否写入
+     */
+    inline bool StampServerTimestamps(uint8_t* data, size_t length, uint64_t rxTime, uint64_t txTime)noexcept
+    {
+        if (length < kMaxSize || !IsBinary(data, length) || VersionField::Load(data) != kVersion)
+            return false;
+        if (!(FlagsField::Load(data) & FLAG_SERVER_TIMESTAMPS))
+            return false;
+
+        ServerRxTimeField::Store(data, rxTime);
+        ServerTxTimeField::Store(data, txTime);
+        return true;
+    }
+}
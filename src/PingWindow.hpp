@@ -0,0 +1,160 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief 探测窗口
+ *
+ * 以Seq为下标的2的幂环形缓冲，每个槽位记录探测包的发送时间。
+ * 窗口内的探测按发送顺序排列，超时判定为O(超时包数)，稳态下不产生分配。
+ * 所有时间使用同一个时钟（纳秒）。
+ */
+class PingWindow
+{
+    enum : uint8_t
+    {
+        SLOT_PENDING = 0,
+        SLOT_RECEIVED = 1,
+    };
+
+    struct Slot
+    {
+        uint64_t SendTime;
+        uint32_t Seq;
+        uint8_t State;
+    };
+
+public:
+    /**
+     * @brief 计算容纳给定超时和间隔所需的容量
+     */
+    static size_t GetCapacityFor(uint64_t timeout, uint64_t interval)noexcept
+    {
+        auto required = interval == 0 ? kMaxCapacity : timeout / interval + 2;
+        size_t capacity = kMinCapacity;
+        while (capacity < required && capacity < kMaxCapacity)
+            capacity <<= 1;
+        return capacity;
+    }
+
+    static const size_t kMinCapacity = 16;
+    static const size_t kMaxCapacity = 1u << 20;
+
+public:
+    /**
+     * @param capacity 容量，必须为2的幂
+     * @param timeout 超时（纳秒）
+     */
+    PingWindow(size_t capacity, uint64_t timeout)
+        : m_stSlots(capacity), m_uMask(static_cast<uint32_t>(capacity - 1)), m_ullTimeout(timeout) {}
+
+public:
+    /**
+     * @brief 获取窗口内（已发送且未超时）的探测数
+     */
+    uint32_t GetSize()const noexcept { return m_uNextSeq - m_uOldestSeq; }
+
+    /**
+     * @brief 获取下一个探测的Seq
+     */
+    uint32_t GetNextSeq()const noexcept { return m_uNextSeq; }
+
+    /**
+     * @brief 记录一个新的探测
+     * @param onLost 对被判定丢失的探测的回调，参数为Seq和发送时间
+     * @return 因窗口已满而被提前判定丢失的探测数（0或1）
+     */
+    template <typename TCallback>
+    uint32_t Push(uint64_t now, TCallback&& onLost)
+    {
+        uint32_t lost = 0;
+        if (GetSize() > m_uMask)
+        {
+            // 环已满，最老的探测只能视为丢失
+            const auto& oldest = m_stSlots[m_uOldestSeq & m_uMask];
+            if (oldest.State == SLOT_PENDING)
+            {
+                lost = 1;
+                onLost(oldest.Seq, oldest.SendTime);
+            }
+            ++m_uOldestSeq;
+        }
+
+        auto& slot = m_stSlots[m_uNextSeq & m_uMask];
+        slot.SendTime = now;
+        slot.Seq = m_uNextSeq;
+        slot.State = SLOT_PENDING;
+        ++m_uNextSeq;
+        return lost;
+    }
+
+    uint32_t Push(uint64_t now)noexcept
+    {
+        return Push(now, [](uint32_t, uint64_t) {});
+    }
+
+    /**
+     * @brief 标记探测已收到
+     * @param sendTime 若不为空，返回探测的发送时间
+     * @return 若不在窗口内或重复则返回false
+     */
+    bool Ack(uint32_t seq, uint64_t* sendTime = nullptr)noexcept
+    {
+        if (seq - m_uOldestSeq >= GetSize())
+            return false;
+
+        auto& slot = m_stSlots[seq & m_uMask];
+        if (slot.Seq != seq || slot.State != SLOT_PENDING)
+            return false;
+
+        slot.State = SLOT_RECEIVED;
+        if (sendTime)
+            *sendTime = slot.SendTime;
+        return true;
+    }
+
+    /**
+     * @brief 移出所有已到期的探测
+     * @param onLost 对其中未收到回包的探测的回调，参数为Seq和发送时间
+     * @return 其中未收到回包（丢失）的探测数
+     */
+    template <typename TCallback>
+    uint32_t Expire(uint64_t now, TCallback&& onLost)
+    {
+        uint32_t lost = 0;
+        while (m_uOldestSeq != m_uNextSeq)
+        {
+            auto& slot = m_stSlots[m_uOldestSeq & m_uMask];
+            if (slot.SendTime + m_ullTimeout > now)
+                break;
+            if (slot.State == SLOT_PENDING)
+            {
+                ++lost;
+                onLost(slot.Seq, slot.SendTime);
+            }
+            ++m_uOldestSeq;
+        }
+        return lost;
+    }
+
+    uint32_t Expire(uint64_t now)noexcept
+    {
+        return Expire(now, [](uint32_t, uint64_t) {});
+    }
+
+    /**
+     * @brief 丢弃窗口内所有探测
+     */
+    void Clear()noexcept
+    {
+        m_uOldestSeq = m_uNextSeq;
+    }
+
+private:
+    std::vector<Slot> m_stSlots;
+    const uint32_t m_uMask;
+    const uint64_t m_ullTimeout;
+
+    uint32_t m_uOldestSeq = 0;  // 窗口内最老的Seq
+    uint32_t m_uNextSeq = 0;  // 下一个要发还未发的Seq
+};
@@ -0,0 +1,318 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+#include <Moe.Core/Time.hpp>
+
+#include "Histogram.hpp"
+#include "PingWindow.hpp"
+#include "PingPacket.hpp"
+#include "OneWayDelay.hpp"
+#include "BurstTracker.hpp"
+#include "SampleLog.hpp"
+#include "SlidingWindow.hpp"
+#include "Metrics.hpp"
+
+/**
+ * @brief 统计数据
+ *
+ * 时延单位均为微秒，非高精度模式下为毫秒精度的采样乘以1000。
+ */
+struct PingStatistic
+{
+    uint32_t TotalPacket;
+    uint32_t PacketLost;
+    uint32_t AvailablePacket;
+    uint64_t LatencyTotal;
+    uint32_t MaxLatency;
+    uint32_t MinLatency;
+    uint32_t P50Latency;
+    uint32_t P90Latency;
+    uint32_t P99Latency;
+    uint32_t P999Latency;
+};
+
+/**
+ * @brief 一个负载尺寸上的统计，时延单位为微秒
+ */
+struct SizeBucketStatistic
+{
+    uint32_t TotalPacket;
+    uint32_t PacketLost;
+    uint32_t AvailablePacket;
+    uint32_t SendError;  // 本地拒绝发送，如超过出接口MTU
+    uint64_t LatencyTotal;
+    uint32_t MaxLatency;
+    uint32_t MinLatency;
+};
+
+/**
+ * @brief 自启动起累计的探测计数，供指标端点读取
+ */
+struct PingCounters
+{
+    uint64_t Sent = 0;
+    uint64_t Lost = 0;
+    Metrics::LatencyBuckets Latency;
+};
+
+class Pinger
+{
+public:
+    /**
+     * @param interval 发包间隔（微秒）
+     * @param timeout 超时（毫秒）
+     * @param hiRes 是否使用高精度时间戳计算时延
+     * @param windows 滑动窗口长度（毫秒）
+     * @param oneWay 是否根据服务端时间戳统计单向时延，要求hiRes且时钟为CLOCK_REALTIME
+     * @param burst 每个间隔连续发送的探测数，大于1时按组统计丢包、抖动和乱序
+     *
+     * 发包时机由外部的ProbeScheduler决定，突发模式下调用方每个间隔连续调用burst次Send。
+     */
+    Pinger(uint32_t interval, uint32_t timeout, bool hiRes, const std::vector<uint32_t>& windows, bool oneWay = false,
+        uint32_t burst = 1)
+        : m_bHiRes(hiRes),
+        m_stPingWindow(PingWindow::GetCapacityFor(timeout * 1000ull, std::max(interval / std::max(burst, 1u), 1u)),
+            timeout * 1000000ull)
+    {
+        m_stWindows.reserve(windows.size());
+        for (auto window : windows)
+            m_stWindows.emplace_back(window);
+
+        // 单向统计额外占用三个直方图，只在启用时分配
+        if (hiRes && oneWay)
+            m_pOneWayDelay.reset(new OneWayDelayTracker());
+        if (burst > 1)
+            m_pBurst.reset(new BurstTracker(burst, PingWindow::GetCapacityFor(timeout * 1000ull, std::max(interval / burst, 1u))));
+    }
+    
+public:
+    /**
+     * @brief 生成下一个PING包
+     * @param now 当前时间（毫秒）
+     * @param hiResNow 高精度时钟的当前时间（纳秒），同时用于判定超时
+     */
+    PingPacket Send(moe::Time::Tick now, uint64_t hiResNow)
+    {
+        // 处理超时
+        auto onLost = [this](uint32_t seq, uint64_t sendTime) {
+            RecordSample(seq, sendTime, true, 0);
+            if (!m_stSizeBuckets.empty())
+                ++GetSizeBucket(seq).PacketLost;
+            if (m_pBurst)
+                m_pBurst->OnLost(seq);
+        };
+        RecordLoss(now, m_stPingWindow.Expire(hiResNow, onLost));
+
+        // 发送PING包
+        PingPacket packet {};
+        packet.Seq = m_stPingWindow.GetNextSeq();
+        packet.SendTime = now;
+        packet.SendTimeNs = m_bHiRes ? hiResNow : 0;
+
+        RecordLoss(now, m_stPingWindow.Push(hiResNow, onLost));
+
+        m_uTotalPacket += 1;
+        ++m_stCounters.Sent;
+        if (!m_stSizeBuckets.empty())
+            ++GetSizeBucket(packet.Seq).TotalPacket;
+        return packet;
+    }
+
+    /**
+     * @param now 当前时间（毫秒）
+     * @param hiResNow 高精度时钟的接收时间（纳秒），与发送时使用同一时钟
+     */
+    void Recv(const PingPacket& packet, moe::Time::Tick now, uint64_t hiResNow)
+    {
+        uint64_t sendTime = 0;
+        if (!m_stPingWindow.Ack(packet.Seq, &sendTime))
+            return;
+
+        uint32_t elapsed = 0;  // us
+        if (m_bHiRes)
+            elapsed = hiResNow > packet.SendTimeNs ? static_cast<uint32_t>((hiResNow - packet.SendTimeNs) / 1000) : 0;
+        else
+            elapsed = static_cast<uint32_t>(now - packet.SendTime) * 1000;
+
+        m_uAvailablePacket += 1;
+        m_ullLatencyTotal += elapsed;
+        m_uMaxLatency = std::max(m_uMaxLatency, elapsed);
+        m_uMinLatency = std::min(m_uMinLatency, elapsed);
+        m_stHistogram.Record(elapsed);
+        m_stCounters.Latency.Record(elapsed);
+        for (auto& window : m_stWindows)
+            window.RecordLatency(now, elapsed);
+        RecordSample(packet.Seq, sendTime, false, elapsed);
+        if (!m_stSizeBuckets.empty())
+        {
+            auto& bucket = GetSizeBucket(packet.Seq);
+            bucket.AvailablePacket += 1;
+            bucket.LatencyTotal += elapsed;
+            bucket.MaxLatency = std::max(bucket.MaxLatency, elapsed);
+            bucket.MinLatency = bucket.AvailablePacket == 1 ? elapsed : std::min(bucket.MinLatency, elapsed);
+        }
+        if (m_pBurst)
+            m_pBurst->OnReceived(packet.Seq, elapsed);
+
+        if (m_pOneWayDelay && packet.ServerRxTime != 0)
+            m_pOneWayDelay->Record(packet.SendTimeNs, packet.ServerRxTime, packet.ServerTxTime, hiResNow);
+    }
+
+    PingStatistic GetStatistic()
+    {
+        PingStatistic desc {};
+        desc.TotalPacket = m_uTotalPacket;
+        desc.PacketLost = m_uPacketLost;
+        desc.AvailablePacket = m_uAvailablePacket;
+        desc.LatencyTotal = m_ullLatencyTotal;
+        desc.MaxLatency = m_uAvailablePacket == 0 ? 0 : m_uMaxLatency;
+        desc.MinLatency = m_uAvailablePacket == 0 ? 0 : m_uMinLatency;
+        desc.P50Latency = static_cast<uint32_t>(m_stHistogram.GetPercentile(50));
+        desc.P90Latency = static_cast<uint32_t>(m_stHistogram.GetPercentile(90));
+        desc.P99Latency = static_cast<uint32_t>(m_stHistogram.GetPercentile(99));
+        desc.P999Latency = static_cast<uint32_t>(m_stHistogram.GetPercentile(99.9));
+        return desc;
+    }
+
+    /**
+     * @brief 获取滑动窗口统计
+     * @param now 当前时间（毫秒）
+     */
+    SlidingWindowStatistic GetWindowStatistic(size_t index, moe::Time::Tick now)const noexcept
+    {
+        return m_stWindows[index].GetStatistic(now);
+    }
+
+    size_t GetWindowCount()const noexcept { return m_stWindows.size(); }
+
+    /**
+     * @brief 按负载尺寸分桶统计
+     *
+     * 序号为seq的探测计入第seq % count个桶，调用方按同样的规则选择负载尺寸。为0时不分桶。
+     */
+    void SetSizeBucketCount(size_t count)
+    {
+        m_stSizeBuckets.assign(count, SizeBucketStatistic {});
+    }
+
+    size_t GetSizeBucketCount()const noexcept { return m_stSizeBuckets.size(); }
+
+    const SizeBucketStatistic& GetSizeBucketStatistic(size_t index)const noexcept { return m_stSizeBuckets[index]; }
+
+    /**
+     * @brief 记录一次被本地拒绝的发送
+     *
+     * 探测仍在途，到期后照常计为丢包。
+     */
+    void RecordSendError(uint32_t seq)noexcept
+    {
+        if (!m_stSizeBuckets.empty())
+            ++GetSizeBucket(seq).SendError;
+    }
+
+    const PingCounters& GetCounters()const noexcept { return m_stCounters; }
+
+    /**
+     * @brief 开始新的统计周期
+     *
+     * 在途的探测保留，其结果计入下一个周期。
+     */
+    void ResetStatistic()
+    {
+        m_uTotalPacket = 0;
+        m_uPacketLost = 0;
+        m_uAvailablePacket = 0;
+        m_ullLatencyTotal = 0;
+        m_uMaxLatency = 0;
+        m_uMinLatency = std::numeric_limits<uint32_t>::max();
+        m_stHistogram.Reset();
+        if (m_pOneWayDelay)
+            m_pOneWayDelay->Reset();
+        std::fill(m_stSizeBuckets.begin(), m_stSizeBuckets.end(), SizeBucketStatistic {});
+        if (m_pBurst)
+            m_pBurst->Reset();
+    }
+
+    /**
+     * @brief 获取时延分布（微秒）
+     */
+    const LatencyHistogram& GetHistogram()const noexcept { return m_stHistogram; }
+
+    /**
+     * @brief 将每个探测的结果写入样本文件
+     * @param clockToRealtime 所用高精度时钟到CLOCK_REALTIME的偏移（纳秒）
+     */
+    void SetSampleLog(SampleLog::Writer* writer, uint32_t targetId, uint8_t proto, int64_t clockToRealtime)noexcept
+    {
+        m_pSampleLog = writer;
+        m_uSampleTargetId = targetId;
+        m_uSampleProto = proto;
+        m_llClockToRealtime = clockToRealtime;
+    }
+
+    /**
+     * @brief 获取单向时延统计，未启用时返回nullptr
+     */
+    const OneWayDelayTracker* GetOneWayDelay()const noexcept { return m_pOneWayDelay.get(); }
+
+    /**
+     * @brief 获取突发统计，未启用时返回nullptr
+     */
+    const BurstTracker* GetBurst()const noexcept { return m_pBurst.get(); }
+
+private:
+    SizeBucketStatistic& GetSizeBucket(uint32_t seq)noexcept
+    {
+        return m_stSizeBuckets[seq % m_stSizeBuckets.size()];
+    }
+
+    void RecordLoss(moe::Time::Tick now, uint32_t count)noexcept
+    {
+        m_uPacketLost += count;
+        m_stCounters.Lost += count;
+        for (auto& window : m_stWindows)
+            window.RecordLoss(now, count);
+    }
+
+    void RecordSample(uint32_t seq, uint64_t sendTime, bool lost, uint32_t rtt)
+    {
+        if (!m_pSampleLog)
+            return;
+
+        SampleLog::Sample sample;
+        sample.TargetId = m_uSampleTargetId;
+        sample.Proto = m_uSampleProto;
+        sample.Lost = lost;
+        sample.Seq = seq;
+        sample.SendTime = static_cast<uint64_t>(static_cast<int64_t>(sendTime) + m_llClockToRealtime) / 1000;
+        sample.Rtt = rtt;
+        m_pSampleLog->Record(sample);
+    }
+
+private:
+    const bool m_bHiRes = false;
+
+    PingWindow m_stPingWindow;
+
+    uint32_t m_uTotalPacket = 0;  // 总包量
+    uint32_t m_uPacketLost = 0;  // 丢包量
+    uint32_t m_uAvailablePacket = 0;  // 有效采样包
+    uint64_t m_ullLatencyTotal = 0;  // 总时延
+    uint32_t m_uMaxLatency = 0;  // 最大时延
+    uint32_t m_uMinLatency = std::numeric_limits<uint32_t>::max();  // 最小时延
+    LatencyHistogram m_stHistogram;  // 时延分布
+    std::unique_ptr<OneWayDelayTracker> m_pOneWayDelay;  // 单向时延
+    std::unique_ptr<BurstTracker> m_pBurst;  // 突发统计
+    std::vector<SlidingWindow> m_stWindows;  // 滑动窗口
+    PingCounters m_stCounters;  // 累计计数
+    std::vector<SizeBucketStatistic> m_stSizeBuckets;  // 按负载尺寸的统计
+
+    SampleLog::Writer* m_pSampleLog = nullptr;
+    uint32_t m_uSampleTargetId = 0;
+    uint8_t m_uSampleProto = 0;
+    int64_t m_llClockToRealtime = 0;
+};
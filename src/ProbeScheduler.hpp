@@ -0,0 +1,299 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+#include <Moe.Core/Exception.hpp>
+#include <Moe.UV/RunLoop.hpp>
+
+#include "HiResClock.hpp"
+#include "FdWatcher.hpp"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include <sys/prctl.h>
+#endif
+
+/**
+ * @brief 探测调度统计
+ */
+struct ProbeSchedulerStatistic
+{
+    uint64_t FireCount;  // 触发次数
+    uint64_t DriftTotal;  // 实际触发时间相对计划时间的总偏移（纳秒）
+    uint64_t MaxDrift;  // 最大偏移（纳秒）
+    uint64_t MissedCount;  // 因落后超过一个周期而跳过的探测
+};
+
+/**
+ * @brief 高精度探测调度器
+ *
+ * 管理任意数量的周期性探测，每个探测的下一次计划时间由上一次的计划时间累加得出，因此回调延迟不会累积为周期漂移。
+ * 所有探测按计划时间放在一个最小堆中，只使用一个定时器，调度代价为O(log 探测数)，适合上万个目标。
+ * Linux下使用绝对时间的timerfd（纳秒精度），其他平台退化为uv_timer（毫秒精度）。
+ */
+class ProbeScheduler
+{
+    struct Entry
+    {
+        uint64_t Interval;
+        uint64_t NextTime;  // 下一次计划触发时间（纳秒）
+        uint32_t Generation;  // 删除时递增，用于识别堆中失效的项
+        bool Active;
+    };
+
+    struct HeapItem
+    {
+        uint64_t Time;
+        uint32_t Id;
+        uint32_t Generation;
+
+        bool operator<(const HeapItem& rhs)const noexcept { return Time > rhs.Time; }  // 最小堆
+    };
+
+public:
+    using OnProbeCallbackType = std::function<void(uint32_t id, uint64_t scheduledTime, uint64_t now)>;
+
+    /**
+     * @brief 落后超过该周期数时放弃补发，直接对齐到当前时间
+     */
+    static const uint64_t kMaxCatchUpIntervals = 1;
+
+    /**
+     * @brief 单次触发最多处理的探测数，避免大量探测同时到期时长时间阻塞事件循环
+     */
+    static const uint32_t kMaxProbesPerFire = 256;
+
+public:
+    ProbeScheduler()
+    {
+#ifdef __linux__
+        m_iTimerFd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (m_iTimerFd < 0)
+            MOE_THROW(moe::APIException, "timerfd_create failed, errno {0}", errno);
+
+        // 降低内核定时器松弛量（默认50us）以减小触发抖动
+        ::prctl(PR_SET_TIMERSLACK, 1000ul, 0, 0, 0);
+
+        m_pWatcher.reset(new FdWatcher(m_iTimerFd));
+        m_pWatcher->SetOnEventCallback([this](int, int) { OnTimerFd(); });
+#else
+        m_pTimer = new uv_timer_t();
+        ::uv_timer_init(moe::UV::RunLoop::GetCurrentUVLoop(), m_pTimer);
+        m_pTimer->data = this;
+#endif
+    }
+
+    ProbeScheduler(const ProbeScheduler&) = delete;
+    ProbeScheduler& operator=(const ProbeScheduler&) = delete;
+
+    ~ProbeScheduler()
+    {
+#ifdef __linux__
+        m_pWatcher.reset();
+        ::close(m_iTimerFd);
+#else
+        m_pTimer->data = nullptr;
+        ::uv_close(reinterpret_cast<uv_handle_t*>(m_pTimer), [](uv_handle_t* handle) {
+            delete reinterpret_cast<uv_timer_t*>(handle);
+        });
+#endif
+    }
+
+public:
+    /**
+     * @brief 获取已添加的探测数
+     */
+    size_t GetSize()const noexcept { return m_stEntries.size() - m_stFreeIds.size(); }
+
+    void SetOnProbeCallback(const OnProbeCallbackType& callback) { m_stOnProbe = callback; }
+
+    /**
+     * @brief 添加一个周期性探测
+     * @param interval 周期（纳秒）
+     * @param offset 首次触发相对当前时间的偏移（纳秒），用于错开多个探测
+     * @return 探测ID，删除后可能被复用
+     */
+    uint32_t Add(uint64_t interval, uint64_t offset = 0)
+    {
+        if (interval == 0)
+            MOE_THROW(moe::BadArgumentException, "Probe interval must be greater than 0");
+
+        uint32_t id = 0;
+        if (!m_stFreeIds.empty())
+        {
+            id = m_stFreeIds.back();
+            m_stFreeIds.pop_back();
+        }
+        else
+        {
+            id = static_cast<uint32_t>(m_stEntries.size());
+            m_stEntries.push_back(Entry {0, 0, 0, false});
+        }
+
+        auto& entry = m_stEntries[id];
+        entry.Interval = interval;
+        entry.NextTime = HiResClock::Now() + offset;
+        entry.Active = true;
+        Push(id);
+
+        if (m_bRunning)
+            Arm();
+        return id;
+    }
+
+    /**
+     * @brief 删除探测
+     *
+     * 堆中的项在弹出时惰性丢弃。
+     */
+    void Remove(uint32_t id)
+    {
+        if (id >= m_stEntries.size() || !m_stEntries[id].Active)
+            return;
+
+        auto& entry = m_stEntries[id];
+        entry.Active = false;
+        ++entry.Generation;
+        m_stFreeIds.push_back(id);
+    }
+
+    /**
+     * @brief 开始调度
+     */
+    void Start()
+    {
+        m_bRunning = true;
+#ifdef __linux__
+        m_pWatcher->Start(UV_READABLE);
+#endif
+        Arm();
+    }
+
+    void Stop()noexcept
+    {
+        m_bRunning = false;
+#ifdef __linux__
+        itimerspec spec {};
+        ::timerfd_settime(m_iTimerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+        m_pWatcher->Stop();
+#else
+        ::uv_timer_stop(m_pTimer);
+#endif
+    }
+
+    ProbeSchedulerStatistic GetStatistic()const noexcept { return m_stStatistic; }
+    void ResetStatistic()noexcept { m_stStatistic = ProbeSchedulerStatistic(); }
+
+private:
+    void Push(uint32_t id)
+    {
+        const auto& entry = m_stEntries[id];
+        m_stHeap.push_back(HeapItem {entry.NextTime, id, entry.Generation});
+        std::push_heap(m_stHeap.begin(), m_stHeap.end());
+    }
+
+    void Arm()
+    {
+        // 丢弃堆顶已删除的项
+        while (!m_stHeap.empty() && m_stHeap.front().Generation != m_stEntries[m_stHeap.front().Id].Generation)
+        {
+            std::pop_heap(m_stHeap.begin(), m_stHeap.end());
+            m_stHeap.pop_back();
+        }
+        if (m_stHeap.empty())
+            return;
+
+        auto nextTime = m_stHeap.front().Time;
+#ifdef __linux__
+        itimerspec spec {};
+        spec.it_value.tv_sec = static_cast<time_t>(nextTime / 1000000000ull);
+        spec.it_value.tv_nsec = static_cast<long>(nextTime % 1000000000ull);
+        if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0)
+            spec.it_value.tv_nsec = 1;  // 全零表示停止定时器
+        ::timerfd_settime(m_iTimerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+#else
+        auto now = HiResClock::Now();
+        auto delay = nextTime > now ? (nextTime - now) / 1000000ull : 0;
+        ::uv_timer_start(m_pTimer, OnUvTimer, delay, 0);
+#endif
+    }
+
+    void Fire()
+    {
+        uint32_t processed = 0;
+        while (m_bRunning && !m_stHeap.empty() && processed < kMaxProbesPerFire)
+        {
+            // 毫秒精度的定时器可能提前触发
+            auto now = HiResClock::Now();
+            auto item = m_stHeap.front();
+            if (item.Time > now)
+                break;
+
+            std::pop_heap(m_stHeap.begin(), m_stHeap.end());
+            m_stHeap.pop_back();
+
+            auto& entry = m_stEntries[item.Id];
+            if (entry.Generation != item.Generation)
+                continue;
+
+            auto scheduled = entry.NextTime;
+            auto drift = now - scheduled;
+            ++m_stStatistic.FireCount;
+            m_stStatistic.DriftTotal += drift;
+            m_stStatistic.MaxDrift = std::max(m_stStatistic.MaxDrift, drift);
+
+            entry.NextTime += entry.Interval;
+            if (now >= entry.NextTime + kMaxCatchUpIntervals * entry.Interval)
+            {
+                // 落后太多（如进程被挂起），跳过错过的周期
+                auto missed = (now - entry.NextTime) / entry.Interval;
+                m_stStatistic.MissedCount += missed;
+                entry.NextTime += missed * entry.Interval;
+            }
+            Push(item.Id);
+            ++processed;
+
+            // 回调中可能添加或删除探测，此后不再持有entry的引用
+            if (m_stOnProbe)
+                m_stOnProbe(item.Id, scheduled, now);
+        }
+
+        if (m_bRunning)
+            Arm();
+    }
+
+#ifdef __linux__
+    void OnTimerFd()
+    {
+        uint64_t expirations = 0;
+        if (::read(m_iTimerFd, &expirations, sizeof(expirations)) != sizeof(expirations))
+            return;
+        Fire();
+    }
+#else
+    static void OnUvTimer(uv_timer_t* handle)
+    {
+        auto self = static_cast<ProbeScheduler*>(handle->data);
+        if (self)
+            self->Fire();
+    }
+#endif
+
+private:
+    std::vector<Entry> m_stEntries;
+    std::vector<uint32_t> m_stFreeIds;
+    std::vector<HeapItem> m_stHeap;
+    bool m_bRunning = false;
+    ProbeSchedulerStatistic m_stStatistic {};
+    OnProbeCallbackType m_stOnProbe;
+
+#ifdef __linux__
+    int m_iTimerFd = -1;
+    std::unique_ptr<FdWatcher> m_pWatcher;
+#else
+    uv_timer_t* m_pTimer = nullptr;
+#endif
+};
@@ -0,0 +1,478 @@
+#pragma once
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <memory>
+#include <algorithm>
+
+#include <Moe.Core/Exception.hpp>
+#include <Moe.Core/Logging.hpp>
+
+#include "PingPacket.hpp"
+#include "AsyncSink.hpp"
+
+/**
+ * @brief 逐探测样本文件
+ *
+ * 只追加的二进制文件，由文件头、数据块和目标记录组成，可以整体mmap后顺序遍历：
+ *
+ *   FileHeader  Magic "PSMP" u32, Version u16, HeaderSize u16, CreateTime u64（CLOCK_REALTIME，纳秒）
+ *   ChunkHeader Magic "CHNK" u32, PayloadSize u32, SampleCount u32, Reserved u32, FirstTime u64, LastTime u64
+ *   Payload     SampleCount个变长样本，之后以0填充到8字节对齐
+ *   TargetRecord Magic "TRGT" u32, PayloadSize u32, TargetId u32, Reserved u32, Time u64（微秒，CLOCK_REALTIME）
+ *   Payload     名字和地址（ip:port），各以0结尾，之后以0填充到8字节对齐
+ *
+ * 每次把TargetId分配给一个目标时写入目标记录（版本2起），其后该Id的样本都属于这个目标，Id被复用时以新的记录区分。
+ *
+ * 每个样本依次为以下varint：
+ *   Key          TargetId << 2 | Proto << 1 | Lost
+ *   Seq
+ *   SendTime     与块内上一个样本之差（微秒，zigzag），首个样本相对FirstTime
+ *   Rtt          往返时延（微秒），丢失时省略
+ *
+ * 样本在结果确定（收到回包或超时）时写入，因此块内的发送时间不保证单调。
+ */
+namespace SampleLog
+{
+    static const uint32_t kFileMagic = 0x504D5350u;
+    static const uint32_t kChunkMagic = 0x4B4E4843u;
+    static const uint32_t kTargetMagic = 0x54475254u;
+    static const uint16_t kVersion = 2;
+
+    enum : uint8_t
+    {
+        PROTO_TCP = 0,
+        PROTO_UDP = 1,
+    };
+
+    using FileMagicField = PingPacketCodec::Field<0, uint32_t>;
+    using FileVersionField = PingPacketCodec::Field<FileMagicField::kEnd, uint16_t>;
+    using FileHeaderSizeField = PingPacketCodec::Field<FileVersionField::kEnd, uint16_t>;
+    using FileCreateTimeField = PingPacketCodec::Field<FileHeaderSizeField::kEnd, uint64_t>;
+    static const size_t kFileHeaderSize = FileCreateTimeField::kEnd;
+
+    using ChunkMagicField = PingPacketCodec::Field<0, uint32_t>;
+    using ChunkPayloadSizeField = PingPacketCodec::Field<ChunkMagicField::kEnd, uint32_t>;
+    using ChunkSampleCountField = PingPacketCodec::Field<ChunkPayloadSizeField::kEnd, uint32_t>;
+    using ChunkReservedField = PingPacketCodec::Field<ChunkSampleCountField::kEnd, uint32_t>;
+    using ChunkFirstTimeField = PingPacketCodec::Field<ChunkReservedField::kEnd, uint64_t>;
+    using ChunkLastTimeField = PingPacketCodec::Field<ChunkFirstTimeField::kEnd, uint64_t>;
+    static const size_t kChunkHeaderSize = ChunkLastTimeField::kEnd;
+
+    using TargetMagicField = PingPacketCodec::Field<0, uint32_t>;
+    using TargetPayloadSizeField = PingPacketCodec::Field<TargetMagicField::kEnd, uint32_t>;
+    using TargetIdField = PingPacketCodec::Field<TargetPayloadSizeField::kEnd, uint32_t>;
+    using TargetReservedField = PingPacketCodec::Field<TargetIdField::kEnd, uint32_t>;
+    using TargetTimeField = PingPacketCodec::Field<TargetReservedField::kEnd, uint64_t>;
+    static const size_t kTargetHeaderSize = TargetTimeField::kEnd;
+
+    static_assert(kFileHeaderSize == 16 && kChunkHeaderSize == 32 && kTargetHeaderSize == 24, "Unexpected sample log layout");
+
+    static const size_t kMaxVarintSize = 10;
+    static const size_t kMaxSampleSize = 4 * kMaxVarintSize;
+
+    struct Sample
+    {
+        uint32_t TargetId;
+        uint8_t Proto;
+        bool Lost;
+        uint32_t Seq;
+        uint64_t SendTime;  // 微秒，CLOCK_REALTIME
+        uint32_t Rtt;  // 微秒
+    };
+
+    /**
+     * @brief TargetId与目标的对应关系，从Time起生效
+     */
+    struct TargetRecord
+    {
+        uint32_t TargetId;
+        uint64_t Time;  // 微秒，CLOCK_REALTIME
+        std::string Name;
+        std::string Address;
+    };
+
+    inline uint8_t* WriteVarint(uint8_t* p, uint64_t value)noexcept
+    {
+        while (value >= 0x80)
+        {
+            *p++ = static_cast<uint8_t>(value | 0x80);
+            value >>= 7;
+        }
+        *p++ = static_cast<uint8_t>(value);
+        return p;
+    }
+
+    /**
+     * @return 数据截断或过长时返回nullptr
+     */
+    inline const uint8_t* ReadVarint(const uint8_t* p, const uint8_t* end, uint64_t& value)noexcept
+    {
+        value = 0;
+        for (uint32_t shift = 0; shift < 64 && p < end; shift += 7)
+        {
+            auto byte = *p++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return p;
+        }
+        return nullptr;
+    }
+
+    inline uint64_t ZigZagEncode(int64_t value)noexcept
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    inline int64_t ZigZagDecode(uint64_t value)noexcept
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    /**
+     * @brief 样本写入器
+     *
+     * 在事件循环线程上把样本编码到当前块，块写满或调用Flush后交给后台线程写盘，编码单个样本只需若干字节操作。
+     */
+    class Writer
+    {
+    public:
+        static const size_t kChunkPayloadSize = 64 * 1024;
+        static const size_t kQueueCapacity = 256;  // 最多积压的块数
+
+    public:
+        Writer(const std::string& path, uint64_t createTime)
+        {
+            m_pFile = ::fopen(path.c_str(), "ab");
+            if (!m_pFile)
+                MOE_THROW(moe::IOException, "Cannot open sample file {0}, errno {1}", path, errno);
+
+            uint8_t header[kFileHeaderSize];
+            FileMagicField::Store(header, kFileMagic);
+            FileVersionField::Store(header, kVersion);
+            FileHeaderSizeField::Store(header, static_cast<uint16_t>(kFileHeaderSize));
+            FileCreateTimeField::Store(header, createTime);
+
+            // 追加到已有文件时从新的文件头开始，读取时跳过即可
+            if (::fwrite(header, sizeof(header), 1, m_pFile) != 1 || ::fflush(m_pFile) != 0)
+            {
+                ::fclose(m_pFile);
+                MOE_THROW(moe::IOException, "Write sample file {0} failed, errno {1}", path, errno);
+            }
+
+            m_pSink.reset(new AsyncSink<std::vector<uint8_t>*>(kQueueCapacity,
+                std::bind(&Writer::WriteChunk, this, std::placeholders::_1)));
+        }
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        ~Writer()
+        {
+            Flush();
+            m_pSink.reset();
+            ::fclose(m_pFile);
+        }
+
+    public:
+        uint64_t GetSampleCount()const noexcept { return m_ullSampleCount; }
+
+        /**
+         * @brief 因写盘跟不上而丢弃的样本数
+         */
+        uint64_t GetDropCount()const noexcept { return m_ullDropCount; }
+
+        void Record(const Sample& sample)
+        {
+            if (!m_pChunk)
+                StartChunk(sample.SendTime);
+            else if (m_pChunk->size() + kMaxSampleSize > kChunkHeaderSize + kChunkPayloadSize)
+            {
+                Flush();
+                StartChunk(sample.SendTime);
+            }
+
+            auto offset = m_pChunk->size();
+            m_pChunk->resize(offset + kMaxSampleSize);
+            auto begin = m_pChunk->data() + offset;
+            auto p = begin;
+
+            auto key = (static_cast<uint64_t>(sample.TargetId) << 2) | (static_cast<uint64_t>(sample.Proto & 1) << 1) |
+                (sample.Lost ? 1u : 0u);
+            p = WriteVarint(p, key);
+            p = WriteVarint(p, sample.Seq);
+            p = WriteVarint(p, ZigZagEncode(static_cast<int64_t>(sample.SendTime - m_ullPrevTime)));
+            if (!sample.Lost)
+                p = WriteVarint(p, sample.Rtt);
+            m_pChunk->resize(offset + static_cast<size_t>(p - begin));
+
+            m_ullPrevTime = sample.SendTime;
+            m_ullLastTime = std::max(m_ullLastTime, sample.SendTime);
+            ++m_uChunkSampleCount;
+            ++m_ullSampleCount;
+        }
+
+        /**
+         * @brief 记录TargetId被分配给了哪个目标
+         *
+         * 先封闭当前块，保证此前该Id的样本在文件中位于记录之前。
+         */
+        void RecordTarget(uint32_t id, const std::string& name, const std::string& address, uint64_t time)
+        {
+            Flush();
+
+            auto payloadSize = name.size() + address.size() + 2;
+            auto record = new std::vector<uint8_t>(kTargetHeaderSize + ((payloadSize + 7) & ~static_cast<size_t>(7)), 0);
+            auto header = record->data();
+            TargetMagicField::Store(header, kTargetMagic);
+            TargetPayloadSizeField::Store(header, static_cast<uint32_t>(payloadSize));
+            TargetIdField::Store(header, id);
+            TargetReservedField::Store(header, 0);
+            TargetTimeField::Store(header, time);
+            ::memcpy(header + kTargetHeaderSize, name.data(), name.size());
+            ::memcpy(header + kTargetHeaderSize + name.size() + 1, address.data(), address.size());
+
+            if (!m_pSink->Push(record))
+            {
+                MOE_LOG_ERROR("Sample file queue is full, target record of id {0} dropped", id);
+                delete record;
+            }
+        }
+
+        /**
+         * @brief 封闭当前块并提交写盘
+         */
+        void Flush()
+        {
+            if (!m_pChunk)
+                return;
+
+            auto chunk = m_pChunk.release();
+            auto payloadSize = chunk->size() - kChunkHeaderSize;
+            chunk->resize(kChunkHeaderSize + ((payloadSize + 7) & ~static_cast<size_t>(7)), 0);
+
+            auto header = chunk->data();
+            ChunkMagicField::Store(header, kChunkMagic);
+            ChunkPayloadSizeField::Store(header, static_cast<uint32_t>(payloadSize));
+            ChunkSampleCountField::Store(header, m_uChunkSampleCount);
+            ChunkReservedField::Store(header, 0);
+            ChunkFirstTimeField::Store(header, m_ullFirstTime);
+            ChunkLastTimeField::Store(header, m_ullLastTime);
+
+            if (!m_pSink->Push(chunk))
+            {
+                m_ullDropCount += m_uChunkSampleCount;
+                delete chunk;
+            }
+        }
+
+    private:
+        void StartChunk(uint64_t firstTime)
+        {
+            m_pChunk.reset(new std::vector<uint8_t>());
+            m_pChunk->reserve(kChunkHeaderSize + kChunkPayloadSize);
+            m_pChunk->resize(kChunkHeaderSize);
+            m_uChunkSampleCount = 0;
+            m_ullFirstTime = m_ullPrevTime = m_ullLastTime = firstTime;
+        }
+
+        void WriteChunk(std::vector<uint8_t>* chunk)
+        {
+            std::unique_ptr<std::vector<uint8_t>> guard(chunk);
+            if (::fwrite(chunk->data(), chunk->size(), 1, m_pFile) != 1 || ::fflush(m_pFile) != 0)
+                MOE_LOG_ERROR("Write sample file failed, errno {0}", errno);
+        }
+
+    private:
+        FILE* m_pFile = nullptr;
+        std::unique_ptr<AsyncSink<std::vector<uint8_t>*>> m_pSink;
+
+        std::unique_ptr<std::vector<uint8_t>> m_pChunk;  // 正在编码的块，含块头
+        uint32_t m_uChunkSampleCount = 0;
+        uint64_t m_ullFirstTime = 0;
+        uint64_t m_ullPrevTime = 0;
+        uint64_t m_ullLastTime = 0;
+
+        uint64_t m_ullSampleCount = 0;
+        uint64_t m_ullDropCount = 0;
+    };
+
+    /**
+     * @brief 样本读取器
+     *
+     * 在内存中的文件映像上顺序遍历，不做任何拷贝。
+     */
+    class Reader
+    {
+    public:
+        Reader(const uint8_t* data, size_t size)
+            : m_pData(data), m_pEnd(data + size) {}
+
+    public:
+        /**
+         * @brief 遍历所有样本
+         * @return 文件完好时返回true，有损坏或截断的部分被跳过时返回false
+         */
+        template <typename TCallback>
+        bool ForEach(TCallback&& callback)const
+        {
+            return ForEach(callback, [](const TargetRecord&) {});
+        }
+
+        /**
+         * @brief 按文件顺序遍历所有样本和目标记录
+         * @param[out] skipped 因损坏而跳过的字节数
+         *
+         * 遇到损坏的部分时向后逐字节寻找下一个能完整解析的文件头、块或目标记录并从那里继续，
+         * 例如被中途杀死的进程留下的半个块之后由下一次运行追加的数据仍然可读。
+         */
+        template <typename TCallback, typename TTargetCallback>
+        bool ForEach(TCallback&& callback, TTargetCallback&& onTarget, size_t* skipped = nullptr)const
+        {
+            size_t damaged = 0;
+            auto p = m_pData;
+            while (p < m_pEnd)
+            {
+                auto size = Parse(p, callback, onTarget);
+                if (size > 0)
+                {
+                    p += size;
+                    continue;
+                }
+
+                auto next = Resync(p + 1);
+                damaged += static_cast<size_t>(next - p);
+                p = next;
+            }
+            if (skipped)
+                *skipped = damaged;
+            return damaged == 0;
+        }
+
+    private:
+        /**
+         * @brief 解析p处的文件头、块或目标记录
+         * @return 占用的字节数，无法解析时返回0
+         */
+        template <typename TCallback, typename TTargetCallback>
+        size_t Parse(const uint8_t* p, TCallback& callback, TTargetCallback& onTarget)const
+        {
+            auto remain = static_cast<size_t>(m_pEnd - p);
+            if (remain >= kFileHeaderSize && FileMagicField::Load(p) == kFileMagic)
+            {
+                auto version = FileVersionField::Load(p);
+                auto headerSize = static_cast<size_t>(FileHeaderSizeField::Load(p));
+                if (version == 0 || version > kVersion || headerSize < kFileHeaderSize || headerSize > remain)
+                    return 0;
+                return headerSize;
+            }
+
+            if (remain >= kTargetHeaderSize && TargetMagicField::Load(p) == kTargetMagic)
+            {
+                auto recordSize = kTargetHeaderSize + ((static_cast<size_t>(TargetPayloadSizeField::Load(p)) + 7) &
+                    ~static_cast<size_t>(7));
+                if (recordSize > remain || !DecodeTarget(p, onTarget))
+                    return 0;
+                return recordSize;
+            }
+
+            if (remain >= kChunkHeaderSize && ChunkMagicField::Load(p) == kChunkMagic)
+            {
+                // 被截断的块后面紧跟下一次运行追加的数据时长度检查仍会通过，因此先完整校验再输出样本
+                auto payloadSize = static_cast<size_t>(ChunkPayloadSizeField::Load(p));
+                auto paddedSize = (payloadSize + 7) & ~static_cast<size_t>(7);
+                if (remain - kChunkHeaderSize < paddedSize)
+                    return 0;
+                auto padding = p + kChunkHeaderSize + payloadSize;
+                if (std::any_of(padding, p + kChunkHeaderSize + paddedSize, [](uint8_t byte) { return byte != 0; }))
+                    return 0;
+                auto ignoreSample = [](const Sample&) {};
+                if (!DecodeChunk(p, ignoreSample) || !DecodeChunk(p, callback))
+                    return 0;
+                return kChunkHeaderSize + paddedSize;
+            }
+            return 0;
+        }
+
+        /**
+         * @brief 从p起寻找下一个能完整解析的位置，找不到时返回末尾
+         *
+         * 候选位置先不带回调试解析一遍，避免在找到可解析的位置之前产生回调。
+         */
+        const uint8_t* Resync(const uint8_t* p)const
+        {
+            auto ignoreSample = [](const Sample&) {};
+            auto ignoreTarget = [](const TargetRecord&) {};
+            for (; p + sizeof(uint32_t) <= m_pEnd; ++p)
+            {
+                auto magic = FileMagicField::Load(p);
+                if ((magic == kFileMagic || magic == kChunkMagic || magic == kTargetMagic) &&
+                    Parse(p, ignoreSample, ignoreTarget) > 0)
+                {
+                    return p;
+                }
+            }
+            return m_pEnd;
+        }
+
+        template <typename TCallback>
+        static bool DecodeTarget(const uint8_t* header, TCallback& callback)
+        {
+            auto begin = reinterpret_cast<const char*>(header + kTargetHeaderSize);
+            auto end = begin + TargetPayloadSizeField::Load(header);
+            auto nameEnd = std::find(begin, end, '\0');
+            if (nameEnd == end)
+                return false;
+            auto addressEnd = std::find(nameEnd + 1, end, '\0');
+            if (addressEnd == end)
+                return false;
+
+            TargetRecord record;
+            record.TargetId = TargetIdField::Load(header);
+            record.Time = TargetTimeField::Load(header);
+            record.Name.assign(begin, nameEnd);
+            record.Address.assign(nameEnd + 1, addressEnd);
+            callback(record);
+            return true;
+        }
+
+        template <typename TCallback>
+        static bool DecodeChunk(const uint8_t* chunk, TCallback& callback)
+        {
+            auto p = chunk + kChunkHeaderSize;
+            auto end = p + ChunkPayloadSizeField::Load(chunk);
+            auto count = ChunkSampleCountField::Load(chunk);
+            auto time = ChunkFirstTimeField::Load(chunk);
+
+            Sample sample {};
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                uint64_t key = 0, seq = 0, delta = 0, rtt = 0;
+                if (!(p = ReadVarint(p, end, key)) || !(p = ReadVarint(p, end, seq)) || !(p = ReadVarint(p, end, delta)))
+                    return false;
+
+                sample.TargetId = static_cast<uint32_t>(key >> 2);
+                sample.Proto = static_cast<uint8_t>((key >> 1) & 1);
+                sample.Lost = (key & 1) != 0;
+                sample.Seq = static_cast<uint32_t>(seq);
+                time += static_cast<uint64_t>(ZigZagDecode(delta));
+                sample.SendTime = time;
+                sample.Rtt = 0;
+                if (!sample.Lost)
+                {
+                    if (!(p = ReadVarint(p, end, rtt)))
+                        return false;
+                    sample.Rtt = static_cast<uint32_t>(rtt);
+                }
+                callback(sample);
+            }
+            return p == end;
+        }
+
+    private:
+        const uint8_t* m_pData;
+        const uint8_t* m_pEnd;
+    };
+}
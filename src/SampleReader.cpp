@@ -0,0 +1,287 @@
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <vector>
+
+#include <Moe.Core/Logging.hpp>
+#include <Moe.Core/CmdParser.hpp>
+
+#include "SampleLog.hpp"
+#include "Histogram.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+using namespace moe;
+
+struct Configure
+{
+    std::string Input;
+    bool Dump;
+    uint32_t Target;
+};
+
+//////////////////////////////////////////////////////////////////////////////// MappedFile
+
+/**
+ * @brief 只读文件映像
+ *
+ * POSIX下使用mmap，其他平台整体读入内存。
+ */
+class MappedFile
+{
+public:
+    MappedFile(const std::string& path)
+    {
+#ifndef _WIN32
+        m_iFd = ::open(path.c_str(), O_RDONLY);
+        if (m_iFd < 0)
+            MOE_THROW(IOException, "Cannot open {0}, errno {1}", path, errno);
+
+        struct stat st;
+        if (::fstat(m_iFd, &st) != 0)
+        {
+            ::close(m_iFd);
+            MOE_THROW(IOException, "Cannot stat {0}, errno {1}", path, errno);
+        }
+
+        m_uSize = static_cast<size_t>(st.st_size);
+        if (m_uSize > 0)
+        {
+            auto data = ::mmap(nullptr, m_uSize, PROT_READ, MAP_PRIVATE, m_iFd, 0);
+            if (data == MAP_FAILED)
+            {
+                ::close(m_iFd);
+                MOE_THROW(IOException, "Cannot map {0}, errno {1}", path, errno);
+            }
+            ::madvise(data, m_uSize, MADV_SEQUENTIAL);
+            m_pData = static_cast<const uint8_t*>(data);
+        }
+#else
+        auto file = ::fopen(path.c_str(), "rb");
+        if (!file)
+            MOE_THROW(IOException, "Cannot open {0}, errno {1}", path, errno);
+
+        uint8_t buffer[64 * 1024];
+        size_t count = 0;
+        while ((count = ::fread(buffer, 1, sizeof(buffer), file)) > 0)
+            m_stBuffer.insert(m_stBuffer.end(), buffer, buffer + count);
+        ::fclose(file);
+
+        m_pData = m_stBuffer.data();
+        m_uSize = m_stBuffer.size();
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+#ifndef _WIN32
+        if (m_pData)
+            ::munmap(const_cast<uint8_t*>(m_pData), m_uSize);
+        ::close(m_iFd);
+#endif
+    }
+
+public:
+    const uint8_t* GetData()const noexcept { return m_pData; }
+    size_t GetSize()const noexcept { return m_uSize; }
+
+private:
+    const uint8_t* m_pData = nullptr;
+    size_t m_uSize = 0;
+#ifndef _WIN32
+    int m_iFd = -1;
+#else
+    std::vector<uint8_t> m_stBuffer;
+#endif
+};
+
+//////////////////////////////////////////////////////////////////////////////// Aggregate
+
+/**
+ * @brief 单个目标单个协议的汇总
+ */
+struct Aggregate
+{
+    uint64_t Total = 0;
+    uint64_t Lost = 0;
+    uint64_t RttTotal = 0;
+    uint64_t FirstTime = UINT64_MAX;
+    uint64_t LastTime = 0;
+    LatencyHistogram Histogram;
+};
+
+/**
+ * @param targets 按出现顺序的目标，同一Id被复用时各占一项；聚合按(下标 << 1 | 协议)索引
+ */
+static void PrintAggregates(const std::vector<SampleLog::TargetRecord>& targets,
+    const std::map<uint64_t, std::unique_ptr<Aggregate>>& aggregates)
+{
+    printf("target|name|address|proto|total|lost|loss%%|avg(us)|min(us)|p50(us)|p90(us)|p99(us)|p99.9(us)|max(us)|duration(s)\n");
+    for (const auto& it : aggregates)
+    {
+        const auto& agg = *it.second;
+        const auto& target = targets[it.first >> 1];
+        auto received = agg.Total - agg.Lost;
+        printf("%u|%s|%s|%s|%llu|%llu|%.2f|%.2f|%llu|%llu|%llu|%llu|%llu|%llu|%.1f\n",
+            target.TargetId, target.Name.c_str(), target.Address.c_str(), (it.first & 1) == SampleLog::PROTO_UDP ? "UDP" : "TCP",
+            static_cast<unsigned long long>(agg.Total), static_cast<unsigned long long>(agg.Lost),
+            agg.Total == 0 ? 0. : 100. * agg.Lost / agg.Total,
+            received == 0 ? 0. : static_cast<double>(agg.RttTotal) / received,
+            static_cast<unsigned long long>(agg.Histogram.GetMin()),
+            static_cast<unsigned long long>(agg.Histogram.GetPercentile(50)),
+            static_cast<unsigned long long>(agg.Histogram.GetPercentile(90)),
+            static_cast<unsigned long long>(agg.Histogram.GetPercentile(99)),
+            static_cast<unsigned long long>(agg.Histogram.GetPercentile(99.9)),
+            static_cast<unsigned long long>(agg.Histogram.GetMax()),
+            agg.LastTime > agg.FirstTime ? (agg.LastTime - agg.FirstTime) / 1000000. : 0.);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////// App
+
+static void InitLogger()
+{
+    auto& logger = Logging::GetInstance();
+
+    // 样本输出到stdout，日志只输出到stderr
+    auto formatter = make_shared<Logging::PlainFormatter>();
+    auto stderrLogger = make_shared<Logging::TerminalSink>(Logging::TerminalSink::OutputType::StdErr);
+    stderrLogger->SetMinLevel(Logging::Level::Debug);
+    stderrLogger->SetMaxLevel(Logging::Level::Fatal);
+    stderrLogger->SetFormatter(formatter);
+    logger.AppendSink(stderrLogger);
+
+    // 设置调试级别
+    logger.SetMinLevel(Logging::Level::Debug);
+
+    // 提交改动
+    logger.Commit();
+}
+
+static Configure ParseCommandline(int argc, const char* argv[])
+{
+    Configure cfg;
+    bool needHelp = false;
+
+    CmdParser parser;
+    parser << CmdParser::Option(cfg.Input, "input", 'i', "Specific the sample file written by PingClient --samples");
+    parser << CmdParser::Option(cfg.Dump, "dump", 'd', "Print every sample instead of the per-target summary", false);
+    parser << CmdParser::Option(cfg.Target, "target", 't', "Only read samples of the given target id", UINT32_MAX);
+    parser << CmdParser::Option(needHelp, "help", 'h', "Show this help", false);
+
+    try
+    {
+        parser(argc, argv);
+    }
+    catch (const ExceptionBase& ex)
+    {
+        fprintf(stderr, "%s\n\n", ex.GetDescription().c_str());
+        needHelp = true;
+    }
+
+    if (needHelp)
+    {
+        auto name = PathUtils::GetFileName(argv[0]);
+        auto nameStr = string(name.GetBuffer(), name.GetSize());
+
+        fprintf(stderr, "%s\n", parser.BuildUsageText(nameStr.c_str()).c_str());
+        fprintf(stderr, "%s\n", parser.BuildOptionsText(2, 10).c_str());
+        exit(1);
+    }
+
+    InitLogger();
+    return cfg;
+}
+
+int main(int argc, const char* argv[])
+{
+    try
+    {
+        Configure cfg = ParseCommandline(argc, argv);
+
+        MappedFile file(cfg.Input);
+        SampleLog::Reader reader(file.GetData(), file.GetSize());
+
+        uint64_t count = 0;
+        std::map<uint64_t, std::unique_ptr<Aggregate>> aggregates;
+        std::vector<SampleLog::TargetRecord> targets;
+        std::unordered_map<uint32_t, size_t> currentTargets;  // TargetId -> targets中当前对应的项
+        auto onTarget = [&](const SampleLog::TargetRecord& record) {
+            if (cfg.Target != UINT32_MAX && record.TargetId != cfg.Target)
+                return;
+            currentTargets[record.TargetId] = targets.size();
+            targets.push_back(record);
+            if (cfg.Dump)
+            {
+                printf("#target|%llu|%u|%s|%s\n", static_cast<unsigned long long>(record.Time), record.TargetId,
+                    record.Name.c_str(), record.Address.c_str());
+            }
+        };
+
+        if (cfg.Dump)
+            printf("time(us)|target|proto|seq|rtt(us)\n");
+        size_t skipped = 0;
+        auto ok = reader.ForEach([&](const SampleLog::Sample& sample) {
+            if (cfg.Target != UINT32_MAX && sample.TargetId != cfg.Target)
+                return;
+            ++count;
+
+            if (cfg.Dump)
+            {
+                printf("%llu|%u|%s|%u|", static_cast<unsigned long long>(sample.SendTime), sample.TargetId,
+                    sample.Proto == SampleLog::PROTO_UDP ? "UDP" : "TCP", sample.Seq);
+                if (sample.Lost)
+                    printf("lost\n");
+                else
+                    printf("%u\n", sample.Rtt);
+                return;
+            }
+
+            // 版本1的文件没有目标记录，按Id汇总
+            auto current = currentTargets.find(sample.TargetId);
+            if (current == currentTargets.end())
+            {
+                current = currentTargets.emplace(sample.TargetId, targets.size()).first;
+                targets.push_back(SampleLog::TargetRecord { sample.TargetId, 0, string(), string() });
+            }
+            auto& agg = aggregates[(static_cast<uint64_t>(current->second) << 1) | sample.Proto];
+            if (!agg)
+                agg.reset(new Aggregate());
+            ++agg->Total;
+            agg->FirstTime = std::min(agg->FirstTime, sample.SendTime);
+            agg->LastTime = std::max(agg->LastTime, sample.SendTime);
+            if (sample.Lost)
+            {
+                ++agg->Lost;
+                return;
+            }
+            agg->RttTotal += sample.Rtt;
+            agg->Histogram.Record(sample.Rtt);
+        }, onTarget, &skipped);
+
+        if (!cfg.Dump)
+            PrintAggregates(targets, aggregates);
+        if (!ok)
+            MOE_LOG_ERROR("Sample file is truncated or corrupted, skipped {0} damaged byte(s), read {1} sample(s)", skipped, count);
+    }
+    catch (const moe::ExceptionBase& ex)
+    {
+        MOE_LOG_EXCEPTION(ex);
+        return -1;
+    }
+    catch (const std::exception& ex)
+    {
+        MOE_LOG_FATAL("Unhandled exception: {0}", ex.what());
+        return -1;
+    }
+    return 0;
+}
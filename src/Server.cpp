@@ -1,12 +1,34 @@
+#include <atomic>
+#include <thread>
+#include <cstring>
+
 #include <Moe.Core/Logging.hpp>
 #include <Moe.Core/CmdParser.hpp>
 #include <Moe.Core/Mdr.hpp>
 
 #include <Moe.UV/Timer.hpp>
 #include <Moe.UV/RunLoop.hpp>
-#include <Moe.UV/TcpSocket.hpp>
 #include <Moe.UV/UdpSocket.hpp>
 
+#include "SocketUtils.hpp"
+#include "FdWatcher.hpp"
+#include "UdpBatch.hpp"
+#include "UdpRing.hpp"
+#include "PacketReflector.hpp"
+#include "BufferPool.hpp"
+#include "TimerWheel.hpp"
+#include "IntrusiveList.hpp"
+#include "SlabAllocator.hpp"
+#include "HiResClock.hpp"
+#include "TcpFraming.hpp"
+#include "PingPacket.hpp"
+#include "Metrics.hpp"
+#include "MetricsServer.hpp"
+#include "SnapshotBuffer.hpp"
+#include "SourceLimiter.hpp"
+#include "LoopMonitor.hpp"
+#include "CpuAffinity.hpp"
+
 using namespace std;
 using namespace moe;
 using namespace UV;
@@ -15,103 +37,720 @@ struct Configure
 {
     std::string ListenAddr;
     uint16_t ListenPort;
+    uint32_t Workers;
+    uint32_t UdpBatch;
+    bool IoUring;
+    uint32_t IdleTimeout;
+    bool Timestamps;
+    std::string MetricsListen;
+    uint16_t MetricsPort;
+    std::string Reflector;  // 网卡名，非空时UDP由PacketReflector回射
+    int32_t ReflectorCpu;
+    bool ReflectorBusyPoll;
+    uint32_t RateLimit;  // 每个来源的UDP限速（包/秒）
+    uint32_t RateBurst;
+    uint32_t SourceTableSize;
+    uint32_t TopTalkers;
+    bool LoopStats;
+    std::string CpuAffinity;  // 工作线程依次绑定的CPU列表
+    int32_t NumaNode;
+    std::string RxQueues;  // 网卡名，非空时工作线程按RX队列中断所在的CPU放置
 };
 
-//////////////////////////////////////////////////////////////////////////////// Server
+/**
+ * @brief 是否启用按来源的UDP计数
+ */
+static bool IsSourceAccountingEnabled(const Configure& cfg)noexcept
+{
+    return cfg.RateLimit != 0 || cfg.TopTalkers != 0;
+}
 
-class Server
+//////////////////////////////////////////////////////////////////////////////// WorkerStatistic
+
+/**
+ * @brief 工作线程一个统计周期的报告，包括热点来源和事件循环自身开销
+ */
+struct WorkerReport
 {
-    struct Session
+    uint64_t Epoch = 0;
+    uint64_t SourceCount = 0;
+    uint64_t EvictionCount = 0;  // 累计值
+    std::vector<SourceLimiter::Talker> Talkers;
+    bool HasLoop = false;
+    LoopMonitor::Statistic Loop {};
+};
+
+/**
+ * @brief 工作线程统计数据
+ *
+ * 由各工作线程独立写入，0号工作线程定期汇总输出。
+ */
+struct WorkerStatistic
+{
+    std::atomic<uint32_t> SessionCount { 0 };
+    std::atomic<uint64_t> TcpEchoCount { 0 };
+    std::atomic<uint64_t> TcpEchoBytes { 0 };
+    std::atomic<uint64_t> UdpEchoCount { 0 };
+    std::atomic<uint64_t> UdpEchoBytes { 0 };
+    std::atomic<uint64_t> UdpBatchCount { 0 };  // 每次批量收发（io_uring下为每次提交）计1，非批量模式下每个数据报计1
+    std::atomic<uint64_t> UdpDropCount { 0 };  // 发送缓冲满而丢弃的回射
+    std::atomic<uint64_t> UdpRateLimitedCount { 0 };  // 超出来源限速而不回射的数据报
+    std::atomic<uint64_t> EchoBufferCount { 0 };  // 当前持有的回射缓冲块数
+    std::atomic<uint64_t> EchoBufferAcquireCount { 0 };  // 累计获取回射缓冲次数
+    std::atomic<uint64_t> EchoBufferHeapAllocCount { 0 };  // 累计向堆申请回射缓冲次数
+
+    std::atomic<uint64_t> ReportEpoch { 0 };  // 由0号工作线程递增，请求本线程发布报告
+    SnapshotBuffer<WorkerReport> Report;  // 本线程发布，0号工作线程汇总
+};
+
+using WorkerStatisticList = std::vector<std::unique_ptr<WorkerStatistic>>;
+
+/**
+ * @brief 工作线程统计数据快照（用于汇总和计算速率）
+ */
+struct WorkerStatisticSnapshot
+{
+    uint64_t SessionCount = 0;
+    uint64_t TcpEchoCount = 0;
+    uint64_t TcpEchoBytes = 0;
+    uint64_t UdpEchoCount = 0;
+    uint64_t UdpEchoBytes = 0;
+    uint64_t UdpBatchCount = 0;
+    uint64_t UdpDropCount = 0;
+    uint64_t UdpRateLimitedCount = 0;
+    uint64_t EchoBufferCount = 0;
+    uint64_t EchoBufferAcquireCount = 0;
+    uint64_t EchoBufferHeapAllocCount = 0;
+
+    void Accumulate(const WorkerStatistic& stat)noexcept
     {
-        TcpSocket Socket;
+        SessionCount += stat.SessionCount.load(memory_order_relaxed);
+        TcpEchoCount += stat.TcpEchoCount.load(memory_order_relaxed);
+        TcpEchoBytes += stat.TcpEchoBytes.load(memory_order_relaxed);
+        UdpEchoCount += stat.UdpEchoCount.load(memory_order_relaxed);
+        UdpEchoBytes += stat.UdpEchoBytes.load(memory_order_relaxed);
+        UdpBatchCount += stat.UdpBatchCount.load(memory_order_relaxed);
+        UdpDropCount += stat.UdpDropCount.load(memory_order_relaxed);
+        UdpRateLimitedCount += stat.UdpRateLimitedCount.load(memory_order_relaxed);
+        EchoBufferCount += stat.EchoBufferCount.load(memory_order_relaxed);
+        EchoBufferAcquireCount += stat.EchoBufferAcquireCount.load(memory_order_relaxed);
+        EchoBufferHeapAllocCount += stat.EchoBufferHeapAllocCount.load(memory_order_relaxed);
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////////// Worker
+
+class Worker
+{
+    using EchoBufferPool = BufferPool<uv_write_t>;
+    using EchoBuffer = EchoBufferPool::Block;
+
+    static const size_t kEchoBufferSize = 16 * 1024;
+    static const size_t kMaxFreeEchoBuffers = 1024;
+    static const size_t kMaxPendingWriteBytes = 1024 * 1024;  // 超出后暂停读取，直到对端收走回射数据
+    static const size_t kIdleWheelSlots = 512;
+    static const size_t kMaxStampDatagramSize = 9216;  // 需要写入时间戳的UDP数据报上限（巨帧）
+    static const Time::Tick kReportCollectTimeout = 5000;  // 等待其他工作线程发布报告的时限
+
+    /**
+     * @brief TCP会话
+     *
+     * 由SlabAllocator分配，存活时位于m_stLiveSessions，开始关闭后移入m_stDeadSessions，句柄关闭回调中释放。
+     * 所有libuv回调通过handle->data定位会话，不产生额外分配。
+     */
+    struct Session :
+        public TimerWheelNode,
+        public IntrusiveListNode
+    {
+        uv_tcp_t Handle;
+        Worker* Owner;
         Time::Tick LastAlive;
-        bool Dead;
+        bool Dead;  // 已经开始关闭，句柄关闭后即被释放
+        bool ReadPaused;
+        bool FramingLost;  // 无法识别帧边界后不再写入时间戳
+        TcpFraming::Scanner FrameScanner;
+        char PeerName[SocketUtils::kMaxAddressStringLength];
+
+        Session(Worker* owner)
+            : Owner(owner), LastAlive(0), Dead(true), ReadPaused(false), FramingLost(false)
+        {
+            ::uv_tcp_init(RunLoop::GetCurrentUVLoop(), &Handle);
+            Handle.data = this;
+            PeerName[0] = '\0';
+        }
 
-        Session(TcpSocket&& socket)
-            : Socket(std::move(socket)), LastAlive(0), Dead(true) {}
+        uv_stream_t* GetStream()noexcept { return reinterpret_cast<uv_stream_t*>(&Handle); }
 
-        void OnTcpError(int error)
+        void StartRead()
+        {
+            auto ret = ::uv_read_start(GetStream(), OnAlloc, OnRead);
+            if (ret != 0)
+                OnTcpError(ret);
+        }
+
+        void Close()
         {
-            MOE_LOG_ERROR("Socket {0} error: {1}", Socket.GetPeerName(), error);
+            if (Dead)
+                return;
             Dead = true;
+            Owner->m_stIdleWheel.Cancel(this);
+            Owner->m_stLiveSessions.Remove(this);
+            Owner->m_stDeadSessions.PushBack(this);
+            ::uv_close(reinterpret_cast<uv_handle_t*>(&Handle), OnClosed);
         }
 
-        void OnTcpData(BytesView data)
+        void OnTcpError(int error)
         {
+            MOE_LOG_ERROR("Socket {0} error: {1}", PeerName, error);
+            Close();
+        }
+
+        void OnTcpData(EchoBuffer* buffer, size_t size)
+        {
+            LoopMonitor::Scope scope(Owner->m_pLoopMonitor.get(), LoopMonitor::CALLBACK_TCP_DATA);
+            if (Owner->m_pLoopMonitor)
+                Owner->m_pLoopMonitor->AddPackets(1);
             LastAlive = RunLoop::Now();
-            Socket.Write(data);
+
+            if (Owner->m_stConfig.Timestamps && !FramingLost)
+            {
+                // 跨读回调的帧无法原地修改，原样回射，客户端视为未提供时间戳
+                auto rxTime = HiResClock::RealtimeNow();
+                FramingLost = !FrameScanner.Scan(buffer->GetData(), size, [&](uint8_t* payload, size_t length) {
+                    PingPacketCodec::StampServerTimestamps(payload, length, rxTime, HiResClock::RealtimeNow());
+                });
+            }
+
+            // 读缓冲直接作为写请求提交，写完成后归还到池中
+            auto buf = ::uv_buf_init(reinterpret_cast<char*>(buffer->GetData()), static_cast<unsigned>(size));
+            buffer->AddRef();
+            buffer->Header.data = this;
+            auto ret = ::uv_write(&buffer->Header, GetStream(), &buf, 1, OnWrite);
+            if (ret != 0)
+            {
+                buffer->Release();
+                OnTcpError(ret);
+                return;
+            }
+
+            if (Handle.write_queue_size > kMaxPendingWriteBytes)
+            {
+                ::uv_read_stop(GetStream());
+                ReadPaused = true;
+            }
+
+            Owner->m_stStatistic.TcpEchoCount.fetch_add(1, memory_order_relaxed);
+            Owner->m_stStatistic.TcpEchoBytes.fetch_add(size, memory_order_relaxed);
         }
 
         void OnTcpDataEof()
         {
-            MOE_LOG_ERROR("Remote {0} close socket", Socket.GetPeerName());
-            Socket.Close();
-            Dead = true;
+            MOE_LOG_ERROR("Remote {0} close socket", PeerName);
+            Close();
+        }
+
+        static void OnAlloc(uv_handle_t* handle, size_t, uv_buf_t* buf)
+        {
+            auto self = static_cast<Session*>(handle->data);
+            auto buffer = self->Owner->m_stEchoBufferPool.Alloc();
+            *buf = ::uv_buf_init(reinterpret_cast<char*>(buffer->GetData()), static_cast<unsigned>(buffer->GetSize()));
+        }
+
+        static void OnRead(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf)
+        {
+            auto self = static_cast<Session*>(stream->data);
+            auto buffer = buf->base ? EchoBuffer::FromData(buf->base) : nullptr;
+
+            if (nread > 0)
+                self->OnTcpData(buffer, static_cast<size_t>(nread));
+            else if (nread == UV_EOF)
+                self->OnTcpDataEof();
+            else if (nread < 0)
+                self->OnTcpError(static_cast<int>(nread));
+
+            if (buffer)
+                buffer->Release();
+        }
+
+        static void OnWrite(uv_write_t* req, int status)
+        {
+            auto self = static_cast<Session*>(req->data);
+            reinterpret_cast<EchoBuffer*>(req)->Release();
+
+            if (status < 0)
+            {
+                if (status != UV_ECANCELED)
+                    self->OnTcpError(status);
+                return;
+            }
+
+            if (self->ReadPaused && !self->Dead && self->Handle.write_queue_size < kMaxPendingWriteBytes / 2)
+            {
+                self->ReadPaused = false;
+                self->StartRead();
+            }
+        }
+
+        static void OnClosed(uv_handle_t* handle)
+        {
+            auto self = static_cast<Session*>(handle->data);
+            self->Owner->FreeSession(self);
         }
     };
 
 public:
-    Server(const Configure& cfg)
-        : m_stConfig(cfg), m_stRunLoop(m_stObjectPool), m_stTimer(Timer::CreateTickTimer(1000)), m_stTcpSocket(TcpSocket::Create()),
-        m_stUdpSocket(UdpSocket::Create())
+    /**
+     * @brief 构造工作线程
+     * @param index 工作线程编号，0号工作线程负责汇总统计
+     * @param tcpFd 预先绑定的TCP监听socket，为-1时自行绑定
+     * @param udpFd 预先绑定的UDP socket，为-1时自行绑定
+     * @param reflector 报文回射器，仅传给0号工作线程用于汇总统计
+     *
+     * 必须在运行该工作线程的线程上构造。启用报文回射器时工作线程不处理UDP。
+     */
+    Worker(const Configure& cfg, uint32_t index, WorkerStatisticList& stats, int tcpFd, int udpFd,
+        const PacketReflector* reflector = nullptr)
+        : m_stConfig(cfg), m_uIndex(index), m_stStatistics(stats), m_stStatistic(*stats[index]), m_pReflector(reflector),
+        m_stRunLoop(m_stObjectPool),
+        m_stTimer(Timer::CreateTickTimer(1000)), m_stUdpSocket(UdpSocket::Create()),
+        m_stEchoBufferPool(kEchoBufferSize, kMaxFreeEchoBuffers), m_stIdleWheel(1000, kIdleWheelSlots, RunLoop::Now())
     {
-        m_stTimer.SetOnTimeCallback(bind(&Server::OnTick, this));
+        m_stTimer.SetOnTimeCallback(bind(&Worker::OnTick, this));
+
+        m_stUdpSocket.SetOnDataCallback(bind(&Worker::OnUdpData, this, placeholders::_1, placeholders::_2));
+        m_stUdpSocket.SetOnErrorCallback(bind(&Worker::OnUdpError, this, placeholders::_1));
+
+        // 会话直接使用libuv句柄，以便控制读写缓冲的分配
+        ::uv_tcp_init(RunLoop::GetCurrentUVLoop(), &m_stTcpListener);
+        m_stTcpListener.data = this;
+
+        int ret = 0;
+        if (tcpFd >= 0)
+        {
+            ret = ::uv_tcp_open(&m_stTcpListener, tcpFd);
+        }
+        else
+        {
+            sockaddr_storage addr;
+            SocketUtils::ParseAddress(m_stConfig.ListenAddr, m_stConfig.ListenPort, addr);
+            ret = ::uv_tcp_bind(&m_stTcpListener, reinterpret_cast<const sockaddr*>(&addr), 0);
+        }
+        if (ret != 0)
+            MOE_THROW(APIException, "Bind tcp socket error: {0}", ::uv_strerror(ret));
+
+        if (m_uIndex == 0 && m_stConfig.MetricsPort != 0)
+        {
+            m_pMetricsServer.reset(new MetricsServer(m_stConfig.MetricsListen, m_stConfig.MetricsPort));
+            m_pMetricsServer->SetOnRenderCallback(bind(&Worker::RenderMetrics, this, placeholders::_1));
+        }
+
+        if (m_stConfig.LoopStats)
+            m_pLoopMonitor.reset(new LoopMonitor());
+
+        if (!m_stConfig.Reflector.empty())
+            return;
+
+        if (IsSourceAccountingEnabled(m_stConfig))
+        {
+            if ((m_stConfig.SourceTableSize & (m_stConfig.SourceTableSize - 1)) != 0 ||
+                m_stConfig.SourceTableSize < SourceLimiter::kProbeWindow)
+            {
+                MOE_THROW(BadArgumentException, "Source table size must be a power of 2 and at least {0}",
+                    SourceLimiter::kProbeWindow);
+            }
+            m_pSourceLimiter.reset(new SourceLimiter(m_stConfig.SourceTableSize, m_stConfig.RateLimit,
+                m_stConfig.RateBurst));
+        }
 
-        m_stTcpSocket.SetOnConnectionCallback(bind(&Server::OnTcpConnection, this));
-        m_stTcpSocket.SetOnErrorCallback(bind(&Server::OnTcpError, this, placeholders::_1));
+#ifdef HAVE_IO_URING
+        if (m_stConfig.IoUring)
+        {
+            if (udpFd < 0)
+                udpFd = SocketUtils::CreateBoundSocket(SOCK_DGRAM, m_stConfig.ListenAddr, m_stConfig.ListenPort, false);
+            try
+            {
+                m_pUdpRing.reset(new UdpRing(udpFd, kUdpRingEntries, kUdpRingBuffers, kMaxStampDatagramSize, 0));
+                m_pUdpRing->SetOnDataCallback(bind(&Worker::OnUdpRingData, this, placeholders::_1, placeholders::_2,
+                    placeholders::_3, placeholders::_4));
+                m_pUdpRing->SetOnErrorCallback(bind(&Worker::OnUdpError, this, placeholders::_1));
+                return;
+            }
+            catch (const ExceptionBase& ex)
+            {
+                // 回退到下面的路径，已经绑定的socket继续沿用
+                if (m_uIndex == 0)
+                    MOE_LOG_WARN("io_uring unavailable, fallback to {0}: {1}", GetUdpBatchSize() > 0 ? "recvmmsg" : "libuv",
+                        ex.GetDescription());
+            }
+        }
+#endif
 
-        m_stUdpSocket.SetOnDataCallback(bind(&Server::OnUdpData, this, placeholders::_1, placeholders::_2));
-        m_stUdpSocket.SetOnErrorCallback(bind(&Server::OnUdpError, this, placeholders::_1));
+#ifdef __linux__
+        if (GetUdpBatchSize() > 0)
+        {
+            // 批量模式下直接操作socket，绕过UdpSocket
+            m_iUdpBatchFd = udpFd >= 0 ? udpFd : SocketUtils::CreateBoundSocket(SOCK_DGRAM, m_stConfig.ListenAddr,
+                m_stConfig.ListenPort, false);
+            m_pUdpBatch.reset(new UdpBatch(GetUdpBatchSize()));
+            m_pUdpKeep.reset(new bool[GetUdpBatchSize()]);
+            m_pUdpWatcher.reset(new FdWatcher(m_iUdpBatchFd));
+            m_pUdpWatcher->SetOnEventCallback(bind(&Worker::OnUdpBatchEvent, this, placeholders::_1, placeholders::_2));
+            return;
+        }
+#endif
 
-        m_stTcpSocket.Bind(EndPoint(m_stConfig.ListenAddr, m_stConfig.ListenPort), false);
-        m_stUdpSocket.Bind(EndPoint(m_stConfig.ListenAddr, m_stConfig.ListenPort));
+        if (udpFd >= 0)
+            m_stUdpSocket.Open(udpFd);
+        else
+            m_stUdpSocket.Bind(EndPoint(m_stConfig.ListenAddr, m_stConfig.ListenPort));
     }
 
 public:
     void Run()
     {
         m_stTimer.Start();
-        m_stTcpSocket.Listen();
-        m_stUdpSocket.StartRead();
+        if (m_pMetricsServer)
+            m_pMetricsServer->Start();
+        if (m_pLoopMonitor)
+            m_pLoopMonitor->Start();
+
+        auto ret = ::uv_listen(reinterpret_cast<uv_stream_t*>(&m_stTcpListener), SOMAXCONN, OnTcpListenerConnection);
+        if (ret != 0)
+            MOE_THROW(APIException, "Listen tcp socket error: {0}", ::uv_strerror(ret));
+
+        if (m_stConfig.Reflector.empty())
+        {
+#ifdef HAVE_IO_URING
+            if (m_pUdpRing)
+                m_pUdpRing->Start();
+            else
+#endif
+#ifdef __linux__
+            if (m_pUdpWatcher)
+                m_pUdpWatcher->Start(UV_READABLE);
+            else
+#endif
+                m_stUdpSocket.StartRead();
+        }
 
         m_stRunLoop.Run();
     }
 
 protected:
+    /**
+     * @brief 获取recvmmsg批量大小，为0时走UdpSocket
+     *
+     * UdpSocket不暴露对端的原始地址，按来源计数时至少以1为批量走recvmmsg路径。
+     */
+    uint32_t GetUdpBatchSize()const noexcept
+    {
+        return std::max(m_stConfig.UdpBatch, IsSourceAccountingEnabled(m_stConfig) ? 1u : 0u);
+    }
+
     void OnTick()
     {
+        LoopMonitor::Scope scope(m_pLoopMonitor.get(), LoopMonitor::CALLBACK_TICK);
         auto now = m_stRunLoop.Now();
-        for (auto it = m_stSessions.begin(); it != m_stSessions.end(); )
+
+        // 只访问到期的会话，活跃会话在此处惰性地重新调度
+        m_stIdleWheel.Advance(now, [this, now](TimerWheelNode* node) {
+            auto session = static_cast<Session*>(node);
+            auto deadline = session->LastAlive + m_stConfig.IdleTimeout;
+            if (deadline <= now)
+                session->Close();
+            else
+                m_stIdleWheel.Schedule(session, deadline);
+        });
+        m_stStatistic.SessionCount.store(static_cast<uint32_t>(m_stLiveSessions.GetSize()), memory_order_relaxed);
+        m_stStatistic.EchoBufferCount.store(m_stEchoBufferPool.GetBlockCount(), memory_order_relaxed);
+        m_stStatistic.EchoBufferAcquireCount.store(m_stEchoBufferPool.GetAcquireCount(), memory_order_relaxed);
+        m_stStatistic.EchoBufferHeapAllocCount.store(m_stEchoBufferPool.GetHeapAllocCount(), memory_order_relaxed);
+#ifdef HAVE_IO_URING
+        if (m_pUdpRing)
+        {
+            auto submits = m_pUdpRing->GetSubmitCount(), drops = m_pUdpRing->GetDropCount();
+            auto replies = m_pUdpRing->GetReplyCount(), replyBytes = m_pUdpRing->GetReplyBytes();
+            m_stStatistic.UdpBatchCount.fetch_add(submits - m_ullLastRingSubmitCount, memory_order_relaxed);
+            m_stStatistic.UdpDropCount.fetch_add(drops - m_ullLastRingDropCount, memory_order_relaxed);
+            m_stStatistic.UdpEchoCount.fetch_add(replies - m_ullLastRingReplyCount, memory_order_relaxed);
+            m_stStatistic.UdpEchoBytes.fetch_add(replyBytes - m_ullLastRingReplyBytes, memory_order_relaxed);
+            m_ullLastRingSubmitCount = submits;
+            m_ullLastRingDropCount = drops;
+            m_ullLastRingReplyCount = replies;
+            m_ullLastRingReplyBytes = replyBytes;
+        }
+#endif
+
+        if (m_uIndex == 0 && now >= m_ullNextStatTime)
         {
-            if ((*it)->Dead)
+            if (m_ullNextStatTime != 0)
+                LogStatistic(now);
+            else
+                m_ullLastStatTime = now;
+            m_ullNextStatTime = now + 60 * 1000;
+
+            // 请求所有工作线程发布本周期的报告，各自在下一次OnTick响应
+            if (IsReportEnabled())
             {
-                it = m_stSessions.erase(it);
-                continue;
+                ++m_ullReportEpoch;
+                m_ullReportRequestTime = now;
+                for (auto& stat : m_stStatistics)
+                    stat->ReportEpoch.store(m_ullReportEpoch, memory_order_relaxed);
             }
+        }
+
+        if (IsReportEnabled())
+            PublishReport();
+        if (m_uIndex == 0 && m_ullReportRequestTime != 0)
+            CollectReports(now);
+    }
+
+    /**
+     * @brief 是否需要各工作线程发布报告
+     */
+    bool IsReportEnabled()const noexcept
+    {
+        return m_stConfig.LoopStats || (m_stConfig.TopTalkers != 0 && m_stConfig.Reflector.empty());
+    }
+
+    /**
+     * @brief 响应0号工作线程的请求，发布本线程的报告并开始新的周期
+     */
+    void PublishReport()
+    {
+        auto epoch = m_stStatistic.ReportEpoch.load(memory_order_relaxed);
+        if (epoch == m_ullPublishedReportEpoch)
+            return;
+        m_ullPublishedReportEpoch = epoch;
+
+        auto& report = m_stStatistic.Report.GetBack();
+        report.Epoch = epoch;
+        report.Talkers.clear();
+        if (m_pSourceLimiter && m_stConfig.TopTalkers != 0)
+        {
+            report.SourceCount = m_pSourceLimiter->GetSourceCount();
+            report.EvictionCount = m_pSourceLimiter->GetEvictionCount();
+            m_pSourceLimiter->CollectTop(m_stConfig.TopTalkers, report.Talkers);
+        }
+        report.HasLoop = m_pLoopMonitor != nullptr;
+        if (m_pLoopMonitor)
+            report.Loop = m_pLoopMonitor->Collect();
+        m_stStatistic.Report.Publish();
+    }
+
+    /**
+     * @brief 汇总各工作线程的报告（仅0号工作线程）
+     *
+     * 所有工作线程都已发布本周期的报告或等待超时后输出，同一来源在多个工作线程上的计数相加。
+     */
+    void CollectReports(Time::Tick now)
+    {
+        size_t ready = 0;
+        for (auto& stat : m_stStatistics)
+        {
+            stat->Report.Consume();
+            if (stat->Report.GetFront().Epoch == m_ullReportEpoch)
+                ++ready;
+        }
+        if (ready < m_stStatistics.size() && now - m_ullReportRequestTime < kReportCollectTimeout)
+            return;
+        m_ullReportRequestTime = 0;
+
+        for (size_t i = 0; i < m_stStatistics.size(); ++i)
+        {
+            const auto& report = m_stStatistics[i]->Report.GetFront();
+            if (report.Epoch == m_ullReportEpoch && report.HasLoop)
+                LoopMonitor::Log(StringUtils::Format("Worker {0}", i), report.Loop);
+        }
+        if (m_stConfig.TopTalkers != 0 && m_stConfig.Reflector.empty())
+            LogTalkers(ready);
+    }
+
+    void LogTalkers(size_t ready)
+    {
+        uint64_t sources = 0, evictions = 0;
+        m_stMergedTalkers.clear();
+        for (auto& stat : m_stStatistics)
+        {
+            const auto& report = stat->Report.GetFront();
+            if (report.Epoch != m_ullReportEpoch)
+                continue;
+            sources += report.SourceCount;
+            evictions += report.EvictionCount;
+            m_stMergedTalkers.insert(m_stMergedTalkers.end(), report.Talkers.begin(), report.Talkers.end());
+        }
 
-            if ((*it)->LastAlive + 60 * 1000 <= now)
+        // 按地址排序后合并同一来源
+        auto byAddr = [](const SourceLimiter::Talker& lhs, const SourceLimiter::Talker& rhs) {
+            return ::memcmp(lhs.Addr, rhs.Addr, sizeof(lhs.Addr)) < 0;
+        };
+        std::sort(m_stMergedTalkers.begin(), m_stMergedTalkers.end(), byAddr);
+        size_t count = 0;
+        for (size_t i = 0; i < m_stMergedTalkers.size(); ++i)
+        {
+            auto& talker = m_stMergedTalkers[i];
+            if (count > 0 && ::memcmp(m_stMergedTalkers[count - 1].Addr, talker.Addr, sizeof(talker.Addr)) == 0)
             {
-                (*it)->Socket.Close();
-                (*it)->Dead = true;
+                m_stMergedTalkers[count - 1].Packets += talker.Packets;
+                m_stMergedTalkers[count - 1].Bytes += talker.Bytes;
+                m_stMergedTalkers[count - 1].Limited += talker.Limited;
+            }
+            else
+            {
+                m_stMergedTalkers[count++] = talker;
             }
-            ++it;
+        }
+        m_stMergedTalkers.resize(count);
+        std::sort(m_stMergedTalkers.begin(), m_stMergedTalkers.end(), [](const SourceLimiter::Talker& lhs,
+            const SourceLimiter::Talker& rhs) { return lhs.Packets > rhs.Packets; });
+
+        MOE_LOG_INFO("Top talkers ({0}/{1} workers), tracked sources {2}, evictions {3}", ready, m_stStatistics.size(),
+            sources, evictions);
+        char addr[INET6_ADDRSTRLEN];
+        for (size_t i = 0; i < std::min<size_t>(m_stConfig.TopTalkers, m_stMergedTalkers.size()); ++i)
+        {
+            const auto& talker = m_stMergedTalkers[i];
+            SourceLimiter::FormatAddress(talker.Addr, addr, sizeof(addr));
+            MOE_LOG_INFO("  #{0} {1}, packets {2}, bytes {3}, rate limited {4}", i + 1, addr, talker.Packets, talker.Bytes,
+                talker.Limited);
         }
     }
 
-    void OnTcpConnection()
+    void LogStatistic(Time::Tick now)
     {
-        auto session = make_shared<Session>(m_stTcpSocket.Accept());
-        MOE_LOG_INFO("Accept session from {0}, current session count {1}", session->Socket.GetPeerName(), m_stSessions.size() + 1);
+        WorkerStatisticSnapshot total;
+        for (auto& stat : m_stStatistics)
+            total.Accumulate(*stat);
 
-        session->LastAlive = RunLoop::Now();
+        auto seconds = (now - m_ullLastStatTime) / 1000.;
+        auto& last = m_stLastStatistic;
+        auto batches = total.UdpBatchCount - last.UdpBatchCount;
+        MOE_LOG_INFO("Workers {0}, sessions {1}, TCP echo {2:F1}/s ({3:F1}KB/s), UDP echo {4:F1}/s ({5:F1}KB/s), "
+            "avg batch {6:F2}, dropped {7}, rate limited {8}, echo buffers {9}, heap allocs {10}/{11}", m_stStatistics.size(),
+            total.SessionCount,
+            (total.TcpEchoCount - last.TcpEchoCount) / seconds, (total.TcpEchoBytes - last.TcpEchoBytes) / seconds / 1024.,
+            (total.UdpEchoCount - last.UdpEchoCount) / seconds, (total.UdpEchoBytes - last.UdpEchoBytes) / seconds / 1024.,
+            batches == 0 ? 0. : static_cast<double>(total.UdpEchoCount - last.UdpEchoCount) / batches,
+            total.UdpDropCount - last.UdpDropCount, total.UdpRateLimitedCount - last.UdpRateLimitedCount,
+            total.EchoBufferCount,
+            total.EchoBufferHeapAllocCount - last.EchoBufferHeapAllocCount,
+            total.EchoBufferAcquireCount - last.EchoBufferAcquireCount);
+
+#ifdef __linux__
+        if (m_pReflector)
+        {
+            auto echoes = m_pReflector->GetEchoCount() - m_ullLastReflectorEchoCount;
+            auto reflectorBatches = m_pReflector->GetBatchCount() - m_ullLastReflectorBatchCount;
+            MOE_LOG_INFO("Reflector echo {0:F1}/s ({1:F1}KB/s), avg batch {2:F2}, dropped {3}", echoes / seconds,
+                (m_pReflector->GetEchoBytes() - m_ullLastReflectorEchoBytes) / seconds / 1024.,
+                reflectorBatches == 0 ? 0. : static_cast<double>(echoes) / reflectorBatches,
+                m_pReflector->GetDropCount() - m_ullLastReflectorDropCount);
+            m_ullLastReflectorEchoCount = m_pReflector->GetEchoCount();
+            m_ullLastReflectorEchoBytes = m_pReflector->GetEchoBytes();
+            m_ullLastReflectorBatchCount = m_pReflector->GetBatchCount();
+            m_ullLastReflectorDropCount = m_pReflector->GetDropCount();
+        }
+#endif
+
+        m_ullLastStatTime = now;
+        m_stLastStatistic = total;
+    }
+
+    /**
+     * @brief 渲染指标（仅0号工作线程）
+     *
+     * 只读取各工作线程的原子计数，速率由采集端根据计数器计算。
+     */
+    void RenderMetrics(std::string& out)
+    {
+        Metrics::TextWriter writer(out);
+        std::vector<std::string> labels(m_stStatistics.size());
+        for (size_t i = 0; i < m_stStatistics.size(); ++i)
+            Metrics::AppendLabel(labels[i], "worker", StringUtils::Format("{0}", i).c_str());
+
+        auto emit = [&](const char* name, const char* type, const char* help, const std::atomic<uint64_t> WorkerStatistic::* field) {
+            writer.Declare(name, type, help);
+            for (size_t i = 0; i < m_stStatistics.size(); ++i)
+                writer.Sample(name, labels[i], (*m_stStatistics[i].*field).load(memory_order_relaxed));
+        };
+
+        writer.Declare("ping_server_sessions", "gauge", "Live TCP sessions");
+        for (size_t i = 0; i < m_stStatistics.size(); ++i)
+        {
+            writer.Sample("ping_server_sessions", labels[i],
+                static_cast<uint64_t>(m_stStatistics[i]->SessionCount.load(memory_order_relaxed)));
+        }
+        emit("ping_server_tcp_echo_total", "counter", "TCP reads echoed", &WorkerStatistic::TcpEchoCount);
+        emit("ping_server_tcp_echo_bytes_total", "counter", "TCP bytes echoed", &WorkerStatistic::TcpEchoBytes);
+        emit("ping_server_udp_echo_total", "counter", "UDP datagrams echoed", &WorkerStatistic::UdpEchoCount);
+        emit("ping_server_udp_echo_bytes_total", "counter", "UDP bytes echoed", &WorkerStatistic::UdpEchoBytes);
+        emit("ping_server_udp_batches_total", "counter", "UDP receive batches", &WorkerStatistic::UdpBatchCount);
+        emit("ping_server_udp_dropped_total", "counter", "UDP echoes dropped on a full send buffer",
+            &WorkerStatistic::UdpDropCount);
+        emit("ping_server_udp_rate_limited_total", "counter", "UDP datagrams not echoed due to the per-source rate limit",
+            &WorkerStatistic::UdpRateLimitedCount);
+        emit("ping_server_echo_buffers", "gauge", "Echo buffers currently held", &WorkerStatistic::EchoBufferCount);
+        emit("ping_server_echo_buffer_heap_allocs_total", "counter", "Echo buffers allocated from the heap",
+            &WorkerStatistic::EchoBufferHeapAllocCount);
+
+#ifdef __linux__
+        if (m_pReflector)
+        {
+            std::string none;
+            writer.Declare("ping_server_reflector_echo_total", "counter", "UDP datagrams echoed by the packet reflector");
+            writer.Sample("ping_server_reflector_echo_total", none, m_pReflector->GetEchoCount());
+            writer.Declare("ping_server_reflector_echo_bytes_total", "counter", "UDP payload bytes echoed by the packet reflector");
+            writer.Sample("ping_server_reflector_echo_bytes_total", none, m_pReflector->GetEchoBytes());
+            writer.Declare("ping_server_reflector_batches_total", "counter", "Packet reflector transmit batches");
+            writer.Sample("ping_server_reflector_batches_total", none, m_pReflector->GetBatchCount());
+            writer.Declare("ping_server_reflector_dropped_total", "counter", "Echoes dropped on a full transmit ring");
+            writer.Sample("ping_server_reflector_dropped_total", none, m_pReflector->GetDropCount());
+        }
+#endif
+
+        // 各工作线程最近一次发布的报告，由本线程在CollectReports中取走
+        if (m_stConfig.LoopStats)
+        {
+            LoopMonitor::RenderMetrics(writer, "ping_server", [&](const std::function<void(const std::string&,
+                const LoopMonitor::Statistic&)>& callback) {
+                for (size_t i = 0; i < m_stStatistics.size(); ++i)
+                    callback(labels[i], m_stStatistics[i]->Report.GetFront().Loop);
+            });
+        }
+    }
+
+    void OnTcpConnection()
+    {
+        auto session = m_stSessionAllocator.New(this);
         session->Dead = false;
+        m_stLiveSessions.PushBack(session);
+
+        auto ret = ::uv_accept(reinterpret_cast<uv_stream_t*>(&m_stTcpListener), session->GetStream());
+        if (ret != 0)
+        {
+            MOE_LOG_ERROR("Accept session error: {0}", ret);
+            session->Close();
+            return;
+        }
 
-        session->Socket.SetOnErrorCallback(bind(&Session::OnTcpError, session.get(), placeholders::_1));
-        session->Socket.SetOnDataCallback(bind(&Session::OnTcpData, session.get(), placeholders::_1));
-        session->Socket.SetOnEofCallback(bind(&Session::OnTcpDataEof, session.get()));
-        session->Socket.StartRead();
+        // 回射的探测包很小，关闭Nagle避免与客户端的延迟ACK叠加
+        ::uv_tcp_nodelay(&session->Handle, 1);
 
-        m_stSessions.emplace_back(session);
+        sockaddr_storage peer;
+        int peerLength = sizeof(peer);
+        if (::uv_tcp_getpeername(&session->Handle, reinterpret_cast<sockaddr*>(&peer), &peerLength) == 0)
+            SocketUtils::ToString(reinterpret_cast<const sockaddr*>(&peer), session->PeerName, sizeof(session->PeerName));
+        MOE_LOG_INFO("Accept session from {0}, current session count {1}", session->PeerName, m_stLiveSessions.GetSize());
+
+        session->LastAlive = RunLoop::Now();
+        m_stIdleWheel.Schedule(session, session->LastAlive + m_stConfig.IdleTimeout);
+        session->StartRead();
+    }
+
+    void FreeSession(Session* session)noexcept
+    {
+        m_stDeadSessions.Remove(session);
+        m_stSessionAllocator.Delete(session);
     }
 
     void OnTcpError(int err)
@@ -120,10 +759,122 @@ protected:
         ::abort();
     }
 
+    static void OnTcpListenerConnection(uv_stream_t* server, int status)
+    {
+        auto self = static_cast<Worker*>(server->data);
+        if (status < 0)
+            self->OnTcpError(status);
+        else
+            self->OnTcpConnection();
+    }
+
     void OnUdpData(const EndPoint& from, BytesView data)
     {
+        LoopMonitor::Scope scope(m_pLoopMonitor.get(), LoopMonitor::CALLBACK_UDP_DATA);
+        if (m_pLoopMonitor)
+            m_pLoopMonitor->AddPackets(1);
+
+        if (m_stConfig.Timestamps && data.GetSize() <= sizeof(m_stStampBuffer))
+        {
+            // UdpSocket交出的数据只读，拷贝到本地缓冲后写入时间戳
+            auto rxTime = HiResClock::RealtimeNow();
+            ::memcpy(m_stStampBuffer, data.GetBuffer(), data.GetSize());
+            if (PingPacketCodec::StampServerTimestamps(m_stStampBuffer, data.GetSize(), rxTime, HiResClock::RealtimeNow()))
+                data = BytesView(m_stStampBuffer, data.GetSize());
+        }
         m_stUdpSocket.Send(from, data);
+
+        m_stStatistic.UdpEchoCount.fetch_add(1, memory_order_relaxed);
+        m_stStatistic.UdpEchoBytes.fetch_add(data.GetSize(), memory_order_relaxed);
+        m_stStatistic.UdpBatchCount.fetch_add(1, memory_order_relaxed);
+    }
+
+#ifdef __linux__
+    void OnUdpBatchEvent(int status, int)
+    {
+        LoopMonitor::Scope scope(m_pLoopMonitor.get(), LoopMonitor::CALLBACK_UDP_DATA);
+        if (status < 0)
+            OnUdpError(status);
+
+        // 单次就绪最多处理若干批，避免饿死同一线程上的TCP会话
+        for (int round = 0; round < kMaxUdpBatchRounds; ++round)
+        {
+            auto count = m_pUdpBatch->Recv(m_iUdpBatchFd);
+            if (count < 0)
+            {
+                MOE_LOG_ERROR("recvmmsg error: {0}", errno);
+                break;
+            }
+            if (count == 0)
+                break;
+            if (m_pLoopMonitor)
+                m_pLoopMonitor->AddPackets(static_cast<uint32_t>(count));
+
+            // 原地回射：长度和对端地址已经在槽位中
+            auto rxTime = m_stConfig.Timestamps ? HiResClock::RealtimeNow() : 0;
+            auto now = RunLoop::Now();
+            size_t limited = 0;
+            for (int i = 0; i < count; ++i)
+            {
+                auto length = m_pUdpBatch->GetLength(i);
+                m_pUdpBatch->SetLength(i, length);
+                m_pUdpKeep[i] = !m_pSourceLimiter || m_pSourceLimiter->Admit(
+                    reinterpret_cast<const sockaddr*>(&m_pUdpBatch->GetAddress(i)), length, now);
+                if (!m_pUdpKeep[i])
+                    ++limited;
+            }
+            if (m_stConfig.Timestamps)
+            {
+                // 同一批共享接收时间，发送时间取提交sendmmsg之前
+                auto txTime = HiResClock::RealtimeNow();
+                for (int i = 0; i < count; ++i)
+                {
+                    if (m_pUdpKeep[i])
+                        PingPacketCodec::StampServerTimestamps(m_pUdpBatch->GetData(i), m_pUdpBatch->GetLength(i), rxTime, txTime);
+                }
+            }
+            auto kept = limited == 0 ? static_cast<size_t>(count) : m_pUdpBatch->Compact(m_pUdpKeep.get(),
+                static_cast<size_t>(count));
+            uint64_t bytes = 0;
+            auto sent = m_pUdpBatch->Send(m_iUdpBatchFd, kept, &bytes);
+
+            m_stStatistic.UdpEchoCount.fetch_add(sent, memory_order_relaxed);
+            m_stStatistic.UdpEchoBytes.fetch_add(bytes, memory_order_relaxed);
+            m_stStatistic.UdpBatchCount.fetch_add(1, memory_order_relaxed);
+            m_stStatistic.UdpDropCount.fetch_add(kept - sent, memory_order_relaxed);
+            if (limited != 0)
+                m_stStatistic.UdpRateLimitedCount.fetch_add(limited, memory_order_relaxed);
+
+            if (static_cast<size_t>(count) < m_pUdpBatch->GetCapacity())
+                break;
+        }
     }
+#endif
+
+#ifdef HAVE_IO_URING
+    void OnUdpRingData(uint8_t* data, size_t length, const sockaddr* from, socklen_t)
+    {
+        LoopMonitor::Scope scope(m_pLoopMonitor.get(), LoopMonitor::CALLBACK_UDP_DATA);
+        if (m_pLoopMonitor)
+            m_pLoopMonitor->AddPackets(1);
+
+        if (m_pSourceLimiter && !m_pSourceLimiter->Admit(from, length, RunLoop::Now()))
+        {
+            m_stStatistic.UdpRateLimitedCount.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+
+        // 接收缓冲可写，直接原地写入时间戳并从同一缓冲回射
+        if (m_stConfig.Timestamps)
+        {
+            auto rxTime = HiResClock::RealtimeNow();
+            PingPacketCodec::StampServerTimestamps(data, length, rxTime, HiResClock::RealtimeNow());
+        }
+        // 回射个数和字节数在发送完成时由UdpRing计入，定时汇总到统计
+        if (!m_pUdpRing->Reply(length))
+            m_stStatistic.UdpDropCount.fetch_add(1, memory_order_relaxed);
+    }
+#endif
 
     void OnUdpError(int err)
     {
@@ -132,15 +883,215 @@ protected:
     }
 
 private:
-    Configure m_stConfig;
+    const Configure& m_stConfig;
+    const uint32_t m_uIndex;
+    WorkerStatisticList& m_stStatistics;
+    WorkerStatistic& m_stStatistic;
+    const PacketReflector* m_pReflector;
 
     ObjectPool m_stObjectPool;
     RunLoop m_stRunLoop;
     Timer m_stTimer;
-    TcpSocket m_stTcpSocket;
+    uv_tcp_t m_stTcpListener;
     UdpSocket m_stUdpSocket;
+    uint8_t m_stStampBuffer[kMaxStampDatagramSize];
+    EchoBufferPool m_stEchoBufferPool;
+    TimerWheel m_stIdleWheel;
+
+#ifdef __linux__
+    static const int kMaxUdpBatchRounds = 16;
+
+    int m_iUdpBatchFd = -1;
+    std::unique_ptr<UdpBatch> m_pUdpBatch;
+    std::unique_ptr<bool[]> m_pUdpKeep;  // 本批各数据报是否回射
+    std::unique_ptr<FdWatcher> m_pUdpWatcher;
+#endif
+
+#ifdef HAVE_IO_URING
+    static const uint32_t kUdpRingEntries = 256;
+    static const uint32_t kUdpRingBuffers = 512;
+
+    std::unique_ptr<UdpRing> m_pUdpRing;
+    uint64_t m_ullLastRingSubmitCount = 0;
+    uint64_t m_ullLastRingDropCount = 0;
+    uint64_t m_ullLastRingReplyCount = 0;
+    uint64_t m_ullLastRingReplyBytes = 0;
+#endif
+
+    std::unique_ptr<MetricsServer> m_pMetricsServer;  // 仅0号工作线程
+    std::unique_ptr<SourceLimiter> m_pSourceLimiter;
+    std::unique_ptr<LoopMonitor> m_pLoopMonitor;
+    uint64_t m_ullPublishedReportEpoch = 0;
+
+    SlabAllocator<Session> m_stSessionAllocator;
+    IntrusiveList<Session> m_stLiveSessions;
+    IntrusiveList<Session> m_stDeadSessions;  // 正在关闭，等待句柄关闭回调
+
+    // 汇总统计（仅0号工作线程）
+    Time::Tick m_ullNextStatTime = 0;
+    Time::Tick m_ullLastStatTime = 0;
+    WorkerStatisticSnapshot m_stLastStatistic;
+    uint64_t m_ullLastReflectorEchoCount = 0;
+    uint64_t m_ullLastReflectorEchoBytes = 0;
+    uint64_t m_ullLastReflectorBatchCount = 0;
+    uint64_t m_ullLastReflectorDropCount = 0;
+    uint64_t m_ullReportEpoch = 0;
+    Time::Tick m_ullReportRequestTime = 0;  // 为0时没有待汇总的请求
+    std::vector<SourceLimiter::Talker> m_stMergedTalkers;
+};
+
+//////////////////////////////////////////////////////////////////////////////// Server
+
+class Server
+{
+public:
+    Server(const Configure& cfg)
+        : m_stConfig(cfg)
+    {
+        if (m_stConfig.Workers == 0)
+            MOE_THROW(BadArgumentException, "Worker count must be greater than 0");
+#ifndef __linux__
+        if (m_stConfig.UdpBatch > 0)
+            MOE_THROW(BadArgumentException, "UDP batch mode is only supported on Linux");
+#endif
+#ifndef HAVE_IO_URING
+        if (m_stConfig.IoUring)
+            MOE_LOG_WARN("io_uring support is not compiled in, ignoring --io-uring");
+#endif
+#ifndef __linux__
+        if (IsSourceAccountingEnabled(m_stConfig))
+            MOE_THROW(BadArgumentException, "Per-source accounting is only supported on Linux");
+#endif
+        if (IsSourceAccountingEnabled(m_stConfig) && !m_stConfig.Reflector.empty())
+            MOE_LOG_WARN("Per-source accounting is not applied to the packet reflector");
+
+        if (!m_stConfig.Reflector.empty())
+        {
+#ifdef __linux__
+            m_pReflector.reset(new PacketReflector(m_stConfig.Reflector, m_stConfig.ListenAddr, m_stConfig.ListenPort,
+                m_stConfig.Timestamps));
+#else
+            MOE_THROW(BadArgumentException, "Packet reflector is only supported on Linux");
+#endif
+        }
+
+        for (uint32_t i = 0; i < m_stConfig.Workers; ++i)
+            m_stStatistics.emplace_back(new WorkerStatistic());
+
+        m_stPlacements = CpuAffinity::Plan(m_stConfig.Workers, m_stConfig.CpuAffinity, m_stConfig.NumaNode,
+            m_stConfig.RxQueues);
+        m_stProcessCpus = CpuAffinity::GetCurrentThreadCpus();
+
+        // 多个工作线程时各自持有SO_REUSEPORT的socket，由内核分发连接和数据报
+        if (m_stConfig.Workers > 1)
+        {
+            for (uint32_t i = 0; i < m_stConfig.Workers; ++i)
+            {
+                m_stTcpFds.push_back(SocketUtils::CreateBoundSocket(SOCK_STREAM, m_stConfig.ListenAddr,
+                    m_stConfig.ListenPort, true));
+                if (m_stConfig.Reflector.empty())
+                {
+                    m_stUdpFds.push_back(SocketUtils::CreateBoundSocket(SOCK_DGRAM, m_stConfig.ListenAddr,
+                        m_stConfig.ListenPort, true));
+                }
+
+                // 让在该CPU上软中断收到的连接和数据报优先交给绑定在该CPU上的工作线程
+                CpuAffinity::SetIncomingCpu(m_stTcpFds.back(), m_stPlacements[i].Cpu);
+                if (!m_stUdpFds.empty())
+                    CpuAffinity::SetIncomingCpu(m_stUdpFds.back(), m_stPlacements[i].Cpu);
+            }
+        }
+    }
+
+public:
+    void Run()
+    {
+        // 0号工作线程在主线程上运行，便于启动失败时直接抛出
+        ApplyPlacement(0);
+#ifdef __linux__
+        Worker worker(m_stConfig, 0, m_stStatistics, GetTcpFd(0), GetUdpFd(0), m_pReflector.get());
+        if (m_pReflector)
+        {
+            m_stThreads.emplace_back(&Server::ReflectorMain, this);
+            MOE_LOG_INFO("Packet reflector started on {0}", m_stConfig.Reflector);
+        }
+#else
+        Worker worker(m_stConfig, 0, m_stStatistics, GetTcpFd(0), GetUdpFd(0));
+#endif
+
+        for (uint32_t i = 1; i < m_stConfig.Workers; ++i)
+            m_stThreads.emplace_back(&Server::WorkerMain, this, i);
+        MOE_LOG_INFO("Server started with {0} worker(s)", m_stConfig.Workers);
+
+        worker.Run();
+
+        for (auto& t : m_stThreads)
+            t.join();
+    }
+
+protected:
+    int GetTcpFd(uint32_t index)const noexcept { return m_stTcpFds.empty() ? -1 : m_stTcpFds[index]; }
+    int GetUdpFd(uint32_t index)const noexcept { return m_stUdpFds.empty() ? -1 : m_stUdpFds[index]; }
+
+    /**
+     * @brief 在当前线程上应用工作线程的放置
+     *
+     * 必须在构造Worker之前调用，使RunLoop、对象池和收发缓冲在首次访问时分配在本地节点上。
+     */
+    void ApplyPlacement(uint32_t index)
+    {
+        const auto& placement = m_stPlacements[index];
+        if (!CpuAffinity::Apply(placement))
+            MOE_LOG_WARN("Cannot set memory policy to numa node {0} for worker {1}, errno {2}", placement.Node, index, errno);
+        MOE_LOG_INFO("Worker {0} placement: {1}", index, CpuAffinity::Describe(placement));
+    }
 
-    std::vector<std::shared_ptr<Session>> m_stSessions;
+    void WorkerMain(uint32_t index)
+    {
+        try
+        {
+            ApplyPlacement(index);
+            Worker worker(m_stConfig, index, m_stStatistics, GetTcpFd(index), GetUdpFd(index));
+            worker.Run();
+        }
+        catch (const ExceptionBase& ex)
+        {
+            MOE_LOG_EXCEPTION(ex);
+            MOE_LOG_FATAL("Worker {0} exited unexpectedly", index);
+            ::abort();
+        }
+    }
+
+#ifdef __linux__
+    void ReflectorMain()
+    {
+        try
+        {
+            // 线程继承了0号工作线程的绑定，未指定--reflector-cpu时恢复为进程原有的CPU集合
+            if (m_stConfig.ReflectorCpu < 0 && m_stPlacements[0].Cpu >= 0 && !m_stProcessCpus.empty())
+                CpuAffinity::PinCurrentThread(m_stProcessCpus);
+            m_pReflector->Run(m_stConfig.ReflectorCpu, m_stConfig.ReflectorBusyPoll);
+        }
+        catch (const ExceptionBase& ex)
+        {
+            MOE_LOG_EXCEPTION(ex);
+            MOE_LOG_FATAL("Packet reflector exited unexpectedly");
+            ::abort();
+        }
+    }
+#endif
+
+private:
+    Configure m_stConfig;
+    WorkerStatisticList m_stStatistics;
+    std::vector<int> m_stTcpFds;
+    std::vector<int> m_stUdpFds;
+    std::vector<CpuAffinity::Placement> m_stPlacements;
+    std::vector<int> m_stProcessCpus;
+#ifdef __linux__
+    std::unique_ptr<PacketReflector> m_pReflector;
+#endif
+    std::vector<std::thread> m_stThreads;
 };
 
 //////////////////////////////////////////////////////////////////////////////// App
@@ -179,6 +1130,40 @@ static Configure ParseCommandline(int argc, const char* argv[])
     CmdParser parser;
     parser << CmdParser::Option(cfg.ListenAddr, "listen", 'l', "Specific the server listen ip address", string("0.0.0.0"));
     parser << CmdParser::Option(cfg.ListenPort, "port", 'p', "Specific the server listen port (TCP & UDP)");
+    parser << CmdParser::Option(cfg.Workers, "workers", 'w', "Specific the worker thread count (SO_REUSEPORT)", 1u);
+    parser << CmdParser::Option(cfg.IdleTimeout, "idle-timeout", 't', "Specific the idle TCP session timeout (ms)", 60000u);
+    parser << CmdParser::Option(cfg.UdpBatch, "udp-batch", 'b', "Specific the UDP echo batch size (recvmmsg/sendmmsg), 0 to disable",
+        0u);
+    parser << CmdParser::Option(cfg.IoUring, "io-uring", 'U',
+        "Use io_uring for the UDP echo path (multishot recv, Linux 6.0+), fallback to --udp-batch or libuv if unavailable", false);
+    parser << CmdParser::Option(cfg.Timestamps, "timestamps", 'T',
+        "Write receive/transmit timestamps into probes that request them (TWAMP-light style reflector)", false);
+    parser << CmdParser::Option(cfg.MetricsPort, "metrics-port", 'm', "Specific the HTTP port serving /metrics, 0 to disable",
+        static_cast<uint16_t>(0));
+    parser << CmdParser::Option(cfg.MetricsListen, "metrics-listen", 'M', "Specific the ip address the metrics endpoint listens on",
+        string("127.0.0.1"));
+    parser << CmdParser::Option(cfg.Reflector, "reflector", 'X', "Echo UDP probes on the given interface with a PACKET_MMAP "
+        "reflector instead of the socket path (Linux, CAP_NET_RAW)", string());
+    parser << CmdParser::Option(cfg.ReflectorCpu, "reflector-cpu", 'C', "Specific the cpu the reflector thread is pinned to, "
+        "-1 to disable", static_cast<int32_t>(-1));
+    parser << CmdParser::Option(cfg.ReflectorBusyPoll, "reflector-busy-poll", 'P',
+        "Busy poll the reflector receive ring instead of sleeping in poll(), use with --reflector-cpu", false);
+    parser << CmdParser::Option(cfg.RateLimit, "rate-limit", 'r', "Specific the per-source UDP echo rate limit (packets/s) "
+        "on each worker, 0 to disable", 0u);
+    parser << CmdParser::Option(cfg.RateBurst, "rate-burst", 'B', "Specific the per-source burst size (packets), "
+        "0 for one second of --rate-limit", 0u);
+    parser << CmdParser::Option(cfg.SourceTableSize, "source-table", 'S', "Specific the per-worker source table capacity "
+        "(power of 2), least recently seen sources are evicted when full", 4096u);
+    parser << CmdParser::Option(cfg.TopTalkers, "top-talkers", 'N', "Log the N busiest UDP sources every statistic interval, "
+        "0 to disable", 0u);
+    parser << CmdParser::Option(cfg.LoopStats, "loop-stats", 'L', "Report event loop lag, callback durations and packets "
+        "per loop iteration of each worker every statistic interval", false);
+    parser << CmdParser::Option(cfg.CpuAffinity, "cpu-affinity", 'A', "Pin worker N to the N-th cpu of the list (e.g. 0-3,8), "
+        "wrapping around when there are more workers (Linux)", string());
+    parser << CmdParser::Option(cfg.NumaNode, "numa-node", 'n', "Prefer allocating worker memory on the given NUMA node, "
+        "also pins workers to its cpus when --cpu-affinity is empty, -1 to follow the cpu (Linux)", static_cast<int32_t>(-1));
+    parser << CmdParser::Option(cfg.RxQueues, "rx-queues", 'Q', "Place worker N on the cpu serving the N-th RX queue interrupt "
+        "of the given interface when no cpu is given, and report the queue of each worker (Linux)", string());
     parser << CmdParser::Option(needHelp, "help", 'h', "Show this help", false);
 
     try
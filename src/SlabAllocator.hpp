@@ -0,0 +1,87 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+/**
+ * @brief 定长对象的板式分配器
+ * @tparam T 对象类型
+ * @tparam SlabSize 每块板容纳的对象个数
+ *
+ * 对象按块连续分配并通过空闲链表复用，板只增不减，稳态下构造和析构对象不产生堆分配。非线程安全。
+ */
+template <typename T, size_t SlabSize = 256>
+class SlabAllocator
+{
+    union Slot
+    {
+        Slot* NextFree;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+    };
+
+public:
+    SlabAllocator() = default;
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+public:
+    size_t GetLiveCount()const noexcept { return m_uLiveCount; }
+    size_t GetCapacity()const noexcept { return m_stSlabs.size() * SlabSize; }
+    size_t GetSlabCount()const noexcept { return m_stSlabs.size(); }
+
+    /**
+     * @brief 构造一个对象
+     */
+    template <typename... TArgs>
+    T* New(TArgs&&... args)
+    {
+        if (!m_pFreeList)
+            Grow();
+
+        auto slot = m_pFreeList;
+        m_pFreeList = slot->NextFree;
+
+        try
+        {
+            auto obj = new(&slot->Storage) T(std::forward<TArgs>(args)...);
+            ++m_uLiveCount;
+            return obj;
+        }
+        catch (...)
+        {
+            slot->NextFree = m_pFreeList;
+            m_pFreeList = slot;
+            throw;
+        }
+    }
+
+    /**
+     * @brief 析构对象并归还槽位
+     */
+    void Delete(T* obj)noexcept
+    {
+        obj->~T();
+
+        auto slot = reinterpret_cast<Slot*>(obj);
+        slot->NextFree = m_pFreeList;
+        m_pFreeList = slot;
+        --m_uLiveCount;
+    }
+
+private:
+    void Grow()
+    {
+        std::unique_ptr<Slot[]> slab(new Slot[SlabSize]);
+        for (size_t i = 0; i < SlabSize; ++i)
+            slab[i].NextFree = (i + 1 < SlabSize) ? &slab[i + 1] : m_pFreeList;
+        m_pFreeList = &slab[0];
+        m_stSlabs.emplace_back(std::move(slab));
+    }
+
+private:
+    std::vector<std::unique_ptr<Slot[]>> m_stSlabs;
+    Slot* m_pFreeList = nullptr;
+    size_t m_uLiveCount = 0;
+};
@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+#include <algorithm>
+
+#include <Moe.Core/Time.hpp>
+
+/**
+ * @brief 滑动窗口统计（时延单位为微秒）
+ */
+struct SlidingWindowStatistic
+{
+    uint32_t Window;  // 窗口长度（毫秒）
+    uint64_t Lost;
+    uint64_t Received;
+    uint64_t LatencyTotal;
+    uint32_t MaxLatency;
+    uint32_t MinLatency;
+};
+
+/**
+ * @brief 滑动窗口聚合
+ *
+ * 窗口被等分为kSubBucketCount个子桶组成的环，样本按结果确定的时间计入当前子桶，
+ * 记录为O(1)，统计为O(子桶数)，与样本数无关。窗口以子桶宽度为步长滑动，因此统计覆盖的时间在
+ * (Window - Window / kSubBucketCount, Window]之间。丢包在超时后才能确定，计入判定时所在的子桶。
+ */
+class SlidingWindow
+{
+    struct Bucket
+    {
+        uint64_t Epoch = UINT64_MAX;  // 子桶对应的时间片编号
+        uint32_t Lost = 0;
+        uint32_t Received = 0;
+        uint64_t LatencyTotal = 0;
+        uint32_t MaxLatency = 0;
+        uint32_t MinLatency = UINT32_MAX;
+    };
+
+public:
+    static const uint32_t kSubBucketCount = 10;
+
+public:
+    /**
+     * @param window 窗口长度（毫秒），至少为kSubBucketCount
+     */
+    SlidingWindow(uint32_t window)
+        : m_uWindow(window > kSubBucketCount ? window : static_cast<uint32_t>(kSubBucketCount)), m_uBucketWidth(m_uWindow / kSubBucketCount) {}
+
+public:
+    uint32_t GetWindow()const noexcept { return m_uWindow; }
+
+    void RecordLoss(moe::Time::Tick now, uint32_t count)noexcept
+    {
+        if (count > 0)
+            Advance(now).Lost += count;
+    }
+
+    void RecordLatency(moe::Time::Tick now, uint32_t latency)noexcept
+    {
+        auto& bucket = Advance(now);
+        ++bucket.Received;
+        bucket.LatencyTotal += latency;
+        bucket.MaxLatency = std::max(bucket.MaxLatency, latency);
+        bucket.MinLatency = std::min(bucket.MinLatency, latency);
+    }
+
+    SlidingWindowStatistic GetStatistic(moe::Time::Tick now)const noexcept
+    {
+        SlidingWindowStatistic desc {};
+        desc.Window = m_uWindow;
+        desc.MinLatency = UINT32_MAX;
+
+        auto epoch = now / m_uBucketWidth;
+        for (const auto& bucket : m_stBuckets)
+        {
+            if (bucket.Epoch == UINT64_MAX || bucket.Epoch > epoch || epoch - bucket.Epoch >= kSubBucketCount)
+                continue;
+            desc.Lost += bucket.Lost;
+            desc.Received += bucket.Received;
+            desc.LatencyTotal += bucket.LatencyTotal;
+            desc.MaxLatency = std::max(desc.MaxLatency, bucket.MaxLatency);
+            desc.MinLatency = std::min(desc.MinLatency, bucket.MinLatency);
+        }
+        if (desc.Received == 0)
+            desc.MinLatency = 0;
+        return desc;
+    }
+
+    void Clear()noexcept
+    {
+        for (auto& bucket : m_stBuckets)
+            bucket = Bucket();
+    }
+
+private:
+    Bucket& Advance(moe::Time::Tick now)noexcept
+    {
+        auto epoch = now / m_uBucketWidth;
+        auto& bucket = m_stBuckets[epoch % kSubBucketCount];
+        if (bucket.Epoch != epoch)
+        {
+            // 环绕回来的子桶已经滑出窗口
+            bucket = Bucket();
+            bucket.Epoch = epoch;
+        }
+        return bucket;
+    }
+
+private:
+    const uint32_t m_uWindow;
+    const uint32_t m_uBucketWidth;
+    Bucket m_stBuckets[kSubBucketCount];
+};
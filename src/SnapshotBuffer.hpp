@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief 单生产者单消费者的无锁快照交换（三缓冲）
+ *
+ * 生产者在后台缓冲上填充完整的快照后发布，消费者取走最近一次发布的快照，双方都不会阻塞或重试。
+ * 消费者来不及取走时较旧的快照被覆盖，可通过快照内的序号发现。
+ * 三个缓冲在构造时由同一个初始值拷贝，生产者原地覆盖，容器的容量得以复用，稳态下不分配内存。
+ */
+template <typename T>
+class SnapshotBuffer
+{
+    static const size_t kCacheLineSize = 64;
+    static const uint32_t kIndexMask = 3;
+    static const uint32_t kDirtyBit = 4;  // 中间缓冲上有未被取走的快照
+
+public:
+    explicit SnapshotBuffer(const T& initial = T())
+        : m_stSlots { initial, initial, initial } {}
+
+    SnapshotBuffer(const SnapshotBuffer&) = delete;
+    SnapshotBuffer& operator=(const SnapshotBuffer&) = delete;
+
+public:
+    /**
+     * @brief 获取待填充的缓冲（仅生产者线程）
+     *
+     * 内容为若干次发布之前的旧快照，调用方需要覆盖所有字段。
+     */
+    T& GetBack()noexcept { return m_stSlots[m_uBack]; }
+
+    /**
+     * @brief 发布后台缓冲（仅生产者线程）
+     */
+    void Publish()noexcept
+    {
+        auto prev = m_uMiddle.exchange(m_uBack | kDirtyBit, std::memory_order_acq_rel);
+        m_uBack = prev & kIndexMask;
+    }
+
+    /**
+     * @brief 取走最近发布的快照（仅消费者线程）
+     * @return 自上次调用以来没有新的快照时返回false，GetFront保持不变
+     */
+    bool Consume()noexcept
+    {
+        if ((m_uMiddle.load(std::memory_order_relaxed) & kDirtyBit) == 0)
+            return false;
+        auto prev = m_uMiddle.exchange(m_uFront, std::memory_order_acq_rel);
+        m_uFront = prev & kIndexMask;
+        return true;
+    }
+
+    /**
+     * @brief 获取最近取走的快照（仅消费者线程）
+     */
+    const T& GetFront()const noexcept { return m_stSlots[m_uFront]; }
+
+private:
+    T m_stSlots[3];
+
+    char m_stPadding0[kCacheLineSize];
+    uint32_t m_uBack = 0;  // 生产者独占
+    char m_stPadding1[kCacheLineSize];
+    std::atomic<uint32_t> m_uMiddle { 1 };
+    char m_stPadding2[kCacheLineSize];
+    uint32_t m_uFront = 2;  // 消费者独占
+    char m_stPadding3[kCacheLineSize];
+};
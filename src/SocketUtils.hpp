@@ -0,0 +1,161 @@
+#pragma once
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+
+#include <Moe.Core/Exception.hpp>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+namespace SocketUtils
+{
+    /**
+     * @brief 解析IPv4/IPv6地址
+     * @param[out] out 输出地址
+     * @return 地址长度
+     */
+    inline socklen_t ParseAddress(const std::string& addr, uint16_t port, sockaddr_storage& out)
+    {
+        ::memset(&out, 0, sizeof(out));
+
+        auto v4 = reinterpret_cast<sockaddr_in*>(&out);
+        if (::inet_pton(AF_INET, addr.c_str(), &v4->sin_addr) == 1)
+        {
+            v4->sin_family = AF_INET;
+            v4->sin_port = htons(port);
+            return sizeof(sockaddr_in);
+        }
+
+        auto v6 = reinterpret_cast<sockaddr_in6*>(&out);
+        if (::inet_pton(AF_INET6, addr.c_str(), &v6->sin6_addr) == 1)
+        {
+            v6->sin6_family = AF_INET6;
+            v6->sin6_port = htons(port);
+            return sizeof(sockaddr_in6);
+        }
+
+        MOE_THROW(moe::BadArgumentException, "Invalid address {0}", addr);
+    }
+
+    /**
+     * @brief 地址格式化后的最大长度（含结尾0）
+     */
+    static const size_t kMaxAddressStringLength = INET6_ADDRSTRLEN + 8;
+
+    /**
+     * @brief 将地址格式化为ip:port形式
+     * @param[out] out 输出缓冲，至少kMaxAddressStringLength字节
+     */
+    inline void ToString(const sockaddr* addr, char* out, size_t size)noexcept
+    {
+        char buf[INET6_ADDRSTRLEN] = { 0 };
+        if (addr->sa_family == AF_INET)
+        {
+            auto v4 = reinterpret_cast<const sockaddr_in*>(addr);
+            ::inet_ntop(AF_INET, const_cast<in_addr*>(&v4->sin_addr), buf, sizeof(buf));
+            ::snprintf(out, size, "%s:%u", buf, static_cast<unsigned>(ntohs(v4->sin_port)));
+        }
+        else if (addr->sa_family == AF_INET6)
+        {
+            auto v6 = reinterpret_cast<const sockaddr_in6*>(addr);
+            ::inet_ntop(AF_INET6, const_cast<in6_addr*>(&v6->sin6_addr), buf, sizeof(buf));
+            ::snprintf(out, size, "[%s]:%u", buf, static_cast<unsigned>(ntohs(v6->sin6_port)));
+        }
+        else if (size > 0)
+        {
+            out[0] = '\0';
+        }
+    }
+
+    inline std::string ToString(const sockaddr* addr)
+    {
+        char buf[kMaxAddressStringLength];
+        ToString(addr, buf, sizeof(buf));
+        return buf;
+    }
+
+#ifndef _WIN32
+
+    /**
+     * @brief 创建一个非阻塞socket并绑定到指定地址
+     * @param type SOCK_STREAM或SOCK_DGRAM
+     * @param reusePort 是否设置SO_REUSEPORT
+     *
+     * 设置SO_REUSEPORT时多个socket可以绑定到同一地址，由内核按流哈希分发，用于多工作线程各自持有监听socket。
+     */
+    inline int CreateBoundSocket(int type, const std::string& addr, uint16_t port, bool reusePort)
+    {
+        sockaddr_storage storage;
+        auto len = ParseAddress(addr, port, storage);
+
+        int fd = ::socket(storage.ss_family, type, 0);
+        if (fd < 0)
+            MOE_THROW(moe::APIException, "socket() failed, errno {0}", errno);
+
+        int on = 1;
+        if (reusePort && (::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0 ||
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0))
+        {
+            auto err = errno;
+            ::close(fd);
+            MOE_THROW(moe::APIException, "setsockopt(SO_REUSEPORT) failed, errno {0}", err);
+        }
+
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&storage), len) != 0)
+        {
+            auto err = errno;
+            ::close(fd);
+            MOE_THROW(moe::APIException, "Bind {0}:{1} failed, errno {2}", addr, port, err);
+        }
+
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+        return fd;
+    }
+
+    /**
+     * @brief 为UDP socket设置DF
+     *
+     * Linux下使用PMTUDISC_PROBE：设置DF但不受内核缓存的路径MTU约束，每个探测都真实经过路径，
+     * 超过出接口MTU的包仍由本地以EMSGSIZE拒绝。
+     */
+    inline void SetDontFragment(int fd, int family)
+    {
+        int ret = -1;
+#if defined(IP_MTU_DISCOVER)
+        int probe = family == AF_INET6 ? IPV6_PMTUDISC_PROBE : IP_PMTUDISC_PROBE;
+        if (family == AF_INET6)
+            ret = ::setsockopt(fd, IPPROTO_IPV6, IPV6_MTU_DISCOVER, &probe, sizeof(probe));
+        else
+            ret = ::setsockopt(fd, IPPROTO_IP, IP_MTU_DISCOVER, &probe, sizeof(probe));
+#elif defined(IP_DONTFRAG)
+        int on = 1;
+        if (family == AF_INET6)
+            ret = ::setsockopt(fd, IPPROTO_IPV6, IPV6_DONTFRAG, &on, sizeof(on));
+        else
+            ret = ::setsockopt(fd, IPPROTO_IP, IP_DONTFRAG, &on, sizeof(on));
+#endif
+        if (ret != 0)
+            MOE_THROW(moe::APIException, "Cannot set DF on socket, errno {0}", errno);
+    }
+#else
+    inline int CreateBoundSocket(int, const std::string&, uint16_t, bool)
+    {
+        MOE_THROW(moe::APIException, "Raw socket is not supported on this platform");
+    }
+
+    inline void SetDontFragment(int, int)
+    {
+        MOE_THROW(moe::APIException, "DF is not supported on this platform");
+    }
+#endif
+}
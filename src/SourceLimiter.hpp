@@ -0,0 +1,216 @@
+#pragma once
+#include <vector>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+
+#include <Moe.Core/Time.hpp>
+
+#include "SocketUtils.hpp"
+
+/**
+ * @brief 按源IP计数和限速
+ *
+ * 固定容量的开放寻址哈希表，键为源IP（IPv4按IPv4映射地址存放），每个表项带一个令牌桶和本周期的计数。
+ * 只在哈希位置起的kProbeWindow个槽位内线性探测，表项从不删除而只被替换：窗口内没有空位时按CLOCK
+ * 算法淘汰最近未被访问的表项。逐包处理不分配内存，最坏情况下访问kProbeWindow个槽位。
+ * 非线程安全，每个工作线程各持一份，因此限速按工作线程独立生效。
+ */
+class SourceLimiter
+{
+public:
+    static const size_t kProbeWindow = 8;
+    static const uint64_t kTokenScale = 1000;  // 令牌以千分之一个包为单位，毫秒时钟下无需浮点
+
+    /**
+     * @brief 一个来源在本周期内的计数
+     */
+    struct Talker
+    {
+        uint8_t Addr[16];
+        uint64_t Packets;
+        uint64_t Bytes;
+        uint64_t Limited;
+    };
+
+private:
+    struct Entry
+    {
+        uint8_t Addr[16];
+        bool Used = false;
+        bool Referenced = false;  // CLOCK访问位
+        moe::Time::Tick LastRefill = 0;
+        uint64_t Tokens = 0;
+        uint64_t Packets = 0;
+        uint64_t Bytes = 0;
+        uint64_t Limited = 0;
+    };
+
+public:
+    /**
+     * @param capacity 表项数，必须为2的幂且不小于kProbeWindow
+     * @param rate 每个来源的限速（包/秒），为0时只计数不限速
+     * @param burst 令牌桶容量（包），为0时取一秒的量
+     */
+    SourceLimiter(size_t capacity, uint32_t rate, uint32_t burst)
+        : m_stEntries(capacity), m_uMask(capacity - 1), m_uRate(rate),
+        m_ullMaxTokens(std::max<uint64_t>(burst != 0 ? burst : rate, 1) * kTokenScale)
+    {
+        assert(capacity >= kProbeWindow && (capacity & (capacity - 1)) == 0);
+    }
+
+public:
+    size_t GetCapacity()const noexcept { return m_stEntries.size(); }
+    size_t GetSourceCount()const noexcept { return m_uUsedCount; }
+    uint64_t GetEvictionCount()const noexcept { return m_ullEvictionCount; }
+
+    /**
+     * @brief 记录一个数据报并判定是否放行
+     * @param addr 源地址
+     * @param bytes 数据报长度
+     * @param now 当前时间（毫秒）
+     * @return 超出限速时返回false
+     */
+    bool Admit(const sockaddr* addr, size_t bytes, moe::Time::Tick now)noexcept
+    {
+        uint8_t key[16];
+        if (!MakeKey(addr, key))
+            return true;
+
+        auto& entry = Lookup(key, now);
+        entry.Referenced = true;
+        ++entry.Packets;
+        entry.Bytes += bytes;
+        if (m_uRate == 0)
+            return true;
+
+        if (now > entry.LastRefill)
+        {
+            entry.Tokens = std::min(m_ullMaxTokens, entry.Tokens + (now - entry.LastRefill) * m_uRate);
+            entry.LastRefill = now;
+        }
+        if (entry.Tokens < kTokenScale)
+        {
+            ++entry.Limited;
+            return false;
+        }
+        entry.Tokens -= kTokenScale;
+        return true;
+    }
+
+    /**
+     * @brief 取出本周期包数最多的count个来源并开始新的周期
+     * @param[out] out 输出，按包数降序，容量在多次调用之间复用
+     */
+    void CollectTop(size_t count, std::vector<Talker>& out)
+    {
+        out.clear();
+        for (auto& entry : m_stEntries)
+        {
+            if (!entry.Used || entry.Packets == 0)
+                continue;
+
+            Talker talker;
+            ::memcpy(talker.Addr, entry.Addr, sizeof(talker.Addr));
+            talker.Packets = entry.Packets;
+            talker.Bytes = entry.Bytes;
+            talker.Limited = entry.Limited;
+            out.push_back(talker);
+            entry.Packets = entry.Bytes = entry.Limited = 0;
+        }
+
+        auto middle = out.begin() + static_cast<ptrdiff_t>(std::min(count, out.size()));
+        std::partial_sort(out.begin(), middle, out.end(), [](const Talker& lhs, const Talker& rhs) {
+            return lhs.Packets > rhs.Packets;
+        });
+        out.erase(middle, out.end());
+    }
+
+    /**
+     * @brief 格式化来源地址，IPv4映射地址还原为点分形式
+     * @param[out] out 输出缓冲，至少INET6_ADDRSTRLEN字节
+     */
+    static void FormatAddress(const uint8_t addr[16], char* out, size_t size)noexcept
+    {
+        static const uint8_t kMappedPrefix[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF };
+        if (::memcmp(addr, kMappedPrefix, sizeof(kMappedPrefix)) == 0)
+            ::inet_ntop(AF_INET, addr + sizeof(kMappedPrefix), out, static_cast<socklen_t>(size));
+        else
+            ::inet_ntop(AF_INET6, addr, out, static_cast<socklen_t>(size));
+    }
+
+private:
+    static bool MakeKey(const sockaddr* addr, uint8_t key[16])noexcept
+    {
+        if (addr->sa_family == AF_INET)
+        {
+            ::memset(key, 0, 10);
+            key[10] = key[11] = 0xFF;
+            ::memcpy(key + 12, &reinterpret_cast<const sockaddr_in*>(addr)->sin_addr, 4);
+            return true;
+        }
+        if (addr->sa_family == AF_INET6)
+        {
+            ::memcpy(key, &reinterpret_cast<const sockaddr_in6*>(addr)->sin6_addr, 16);
+            return true;
+        }
+        return false;
+    }
+
+    static size_t Hash(const uint8_t key[16])noexcept
+    {
+        uint64_t a, b;
+        ::memcpy(&a, key, 8);
+        ::memcpy(&b, key + 8, 8);
+        auto h = a * 0x9E3779B97F4A7C15ull ^ b * 0xC2B2AE3D27D4EB4Full;
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
+
+    Entry& Lookup(const uint8_t key[16], moe::Time::Tick now)noexcept
+    {
+        auto base = Hash(key);
+        for (size_t i = 0; i < kProbeWindow; ++i)
+        {
+            auto& entry = m_stEntries[(base + i) & m_uMask];
+            if (!entry.Used)
+            {
+                // 表项从不删除，遇到空位说明该来源不在表中
+                ++m_uUsedCount;
+                return Reset(entry, key, now);
+            }
+            if (::memcmp(entry.Addr, key, 16) == 0)
+                return entry;
+        }
+
+        // CLOCK：清除沿途的访问位，淘汰第一个未被访问的表项，全部被访问过时淘汰窗口内的第一个
+        Entry* victim = nullptr;
+        for (size_t i = 0; i < kProbeWindow && !victim; ++i)
+        {
+            auto& entry = m_stEntries[(base + i) & m_uMask];
+            if (!entry.Referenced)
+                victim = &entry;
+            entry.Referenced = false;
+        }
+        ++m_ullEvictionCount;
+        return Reset(victim ? *victim : m_stEntries[base & m_uMask], key, now);
+    }
+
+    Entry& Reset(Entry& entry, const uint8_t key[16], moe::Time::Tick now)noexcept
+    {
+        ::memcpy(entry.Addr, key, 16);
+        entry.Used = true;
+        entry.Referenced = false;
+        entry.LastRefill = now;
+        entry.Tokens = m_ullMaxTokens;
+        entry.Packets = entry.Bytes = entry.Limited = 0;
+        return entry;
+    }
+
+private:
+    std::vector<Entry> m_stEntries;
+    const size_t m_uMask;
+    const uint32_t m_uRate;
+    const uint64_t m_ullMaxTokens;
+    size_t m_uUsedCount = 0;
+    uint64_t m_ullEvictionCount = 0;
+};
@@ -0,0 +1,92 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cassert>
+
+/**
+ * @brief 有界单生产者单消费者无锁队列
+ *
+ * 容量为2的幂，生产者只写m_uTail，消费者只写m_uHead，两者之间以填充隔开以避免伪共享。
+ * 使用填充而非alignas，使对象在C++11下也可以直接new。
+ * 元素按值拷贝，适合POD记录。
+ */
+template <typename T>
+class SpscQueue
+{
+    static const size_t kCacheLineSize = 64;
+
+public:
+    /**
+     * @param capacity 容量，必须为2的幂
+     */
+    explicit SpscQueue(size_t capacity)
+        : m_stSlots(capacity), m_uMask(capacity - 1)
+    {
+        assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+public:
+    size_t GetCapacity()const noexcept { return m_stSlots.size(); }
+
+    /**
+     * @brief 获取队列中的元素数，任意线程调用时仅为近似值
+     */
+    size_t GetSize()const noexcept
+    {
+        return m_uTail.load(std::memory_order_acquire) - m_uHead.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief 入队（仅生产者线程）
+     * @return 队列已满时返回false
+     */
+    bool TryPush(const T& value)noexcept
+    {
+        auto tail = m_uTail.load(std::memory_order_relaxed);
+        if (tail - m_uCachedHead >= m_stSlots.size())
+        {
+            m_uCachedHead = m_uHead.load(std::memory_order_acquire);
+            if (tail - m_uCachedHead >= m_stSlots.size())
+                return false;
+        }
+
+        m_stSlots[tail & m_uMask] = value;
+        m_uTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 出队（仅消费者线程）
+     * @return 队列为空时返回false
+     */
+    bool TryPop(T& value)noexcept
+    {
+        auto head = m_uHead.load(std::memory_order_relaxed);
+        if (head == m_uCachedTail)
+        {
+            m_uCachedTail = m_uTail.load(std::memory_order_acquire);
+            if (head == m_uCachedTail)
+                return false;
+        }
+
+        value = m_stSlots[head & m_uMask];
+        m_uHead.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> m_stSlots;
+    const size_t m_uMask;
+
+    char m_stPadding0[kCacheLineSize];
+    std::atomic<size_t> m_uHead { 0 };  // 消费者写
+    size_t m_uCachedTail = 0;  // 消费者缓存的m_uTail
+    char m_stPadding1[kCacheLineSize];
+    std::atomic<size_t> m_uTail { 0 };  // 生产者写
+    size_t m_uCachedHead = 0;  // 生产者缓存的m_uHead
+    char m_stPadding2[kCacheLineSize];
+};
@@ -0,0 +1,190 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include <Moe.Core/StringUtils.hpp>
+
+/**
+ * @brief TCP帧编解码
+ *
+ * 每帧为2字节小端长度前缀加负载。服务端原样回射字节流，只在写入时间戳时需要识别帧边界。
+ */
+namespace TcpFraming
+{
+    static const size_t kHeaderSize = 2;
+    static const size_t kMaxPayloadSize = 9216;  // 与PingPacketCodec::kMaxPaddedSize一致
+
+    inline size_t GetPayloadLength(const uint8_t* header)noexcept
+    {
+        return static_cast<size_t>(header[0]) | (static_cast<size_t>(header[1]) << 8);
+    }
+
+    inline bool IsValidLength(size_t length)noexcept
+    {
+        return length > 0 && length <= kMaxPayloadSize;
+    }
+
+    /**
+     * @brief 写入帧头，用于负载已经就位在帧头之后的场合
+     */
+    inline void StoreHeader(uint8_t* header, size_t length)noexcept
+    {
+        header[0] = static_cast<uint8_t>(length & 0xFFu);
+        header[1] = static_cast<uint8_t>((length >> 8) & 0xFFu);
+    }
+
+    /**
+     * @brief 追加一帧到输出缓冲
+     */
+    inline void AppendFrame(std::vector<uint8_t>& out, const uint8_t* payload, size_t length)
+    {
+        auto offset = out.size();
+        out.resize(offset + kHeaderSize + length);
+        StoreHeader(out.data() + offset, length);
+        if (length > 0)
+            ::memcpy(out.data() + offset + kHeaderSize, payload, length);
+    }
+
+    /**
+     * @brief 帧边界扫描器
+     *
+     * 供回射端在不缓存数据的前提下跟踪帧边界，只对完整落在一次读回调内的帧回调，以便原地修改负载。
+     */
+    class Scanner
+    {
+    public:
+        /**
+         * @param callback 对每个完整落在data内的帧的回调，参数为负载指针和长度
+         * @return 遇到非法长度时返回false，此后的数据无法再识别帧边界
+         */
+        template <typename TCallback>
+        bool Scan(uint8_t* data, size_t length, TCallback&& callback)
+        {
+            auto p = data;
+            auto remain = length;
+            while (remain > 0)
+            {
+                // 跳过上一次读回调中未结束的帧
+                if (m_uSkip > 0)
+                {
+                    auto take = std::min(m_uSkip, remain);
+                    m_uSkip -= take;
+                    p += take;
+                    remain -= take;
+                    continue;
+                }
+
+                if (m_uHeaderBytes > 0 || remain < kHeaderSize)
+                {
+                    m_stHeader[m_uHeaderBytes++] = *p++;
+                    --remain;
+                    if (m_uHeaderBytes < kHeaderSize)
+                        continue;
+
+                    m_uHeaderBytes = 0;
+                    m_uSkip = GetPayloadLength(m_stHeader);
+                    if (!IsValidLength(m_uSkip))
+                        return false;
+                    continue;
+                }
+
+                auto payloadLength = GetPayloadLength(p);
+                if (!IsValidLength(payloadLength))
+                    return false;
+                if (remain < kHeaderSize + payloadLength)
+                {
+                    m_uSkip = payloadLength;
+                    p += kHeaderSize;
+                    remain -= kHeaderSize;
+                    continue;
+                }
+
+                callback(p + kHeaderSize, payloadLength);
+                p += kHeaderSize + payloadLength;
+                remain -= kHeaderSize + payloadLength;
+            }
+            return true;
+        }
+
+    private:
+        size_t m_uSkip = 0;  // 当前帧剩余未见的负载字节
+        size_t m_uHeaderBytes = 0;
+        uint8_t m_stHeader[kHeaderSize];
+    };
+
+    /**
+     * @brief 增量解码器
+     *
+     * 处理任意切分或合并的读回调。完整落在一次读回调内的帧直接引用输入数据，只有跨回调的残帧才会被缓存。
+     */
+    class Decoder
+    {
+    public:
+        /**
+         * @brief 输入一段字节流
+         * @param callback 对每个完整帧的回调，参数为负载
+         * @return 遇到非法长度时返回false，此时流已无法重新同步，调用方应断开连接
+         */
+        template <typename TCallback>
+        bool Feed(moe::BytesView data, TCallback&& callback)
+        {
+            auto p = data.GetBuffer();
+            auto remain = data.GetSize();
+
+            // 先补齐上一次残留的帧
+            while (!m_stPending.empty() && remain > 0)
+            {
+                size_t need = 0;
+                if (m_stPending.size() < kHeaderSize)
+                    need = kHeaderSize - m_stPending.size();
+                else
+                    need = kHeaderSize + GetPayloadLength(m_stPending.data()) - m_stPending.size();
+
+                auto take = std::min(need, remain);
+                m_stPending.insert(m_stPending.end(), p, p + take);
+                p += take;
+                remain -= take;
+
+                if (m_stPending.size() == kHeaderSize && !IsValidLength(GetPayloadLength(m_stPending.data())))
+                    return false;
+                if (m_stPending.size() > kHeaderSize &&
+                    m_stPending.size() == kHeaderSize + GetPayloadLength(m_stPending.data()))
+                {
+                    callback(moe::BytesView(m_stPending.data() + kHeaderSize, m_stPending.size() - kHeaderSize));
+                    m_stPending.clear();
+                }
+            }
+
+            // 输入中完整的帧无需拷贝
+            while (remain >= kHeaderSize)
+            {
+                auto length = GetPayloadLength(p);
+                if (!IsValidLength(length))
+                    return false;
+                if (remain < kHeaderSize + length)
+                    break;
+
+                callback(moe::BytesView(p + kHeaderSize, length));
+                p += kHeaderSize + length;
+                remain -= kHeaderSize + length;
+            }
+
+            if (remain > 0)
+                m_stPending.assign(p, p + remain);
+            return true;
+        }
+
+        /**
+         * @brief 丢弃残留数据，用于重连
+         */
+        void Reset()noexcept
+        {
+            m_stPending.clear();
+        }
+
+    private:
+        std::vector<uint8_t> m_stPending;
+    };
+}
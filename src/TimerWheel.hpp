@@ -0,0 +1,149 @@
+#pragma once
+#include <vector>
+#include <cassert>
+#include <algorithm>
+
+#include <Moe.Core/Time.hpp>
+
+/**
+ * @brief 时间轮节点
+ *
+ * 以侵入方式嵌入到被调度的对象中，调度和取消均为O(1)。
+ */
+struct TimerWheelNode
+{
+    TimerWheelNode* Prev = nullptr;
+    TimerWheelNode* Next = nullptr;
+    moe::Time::Tick Deadline = 0;
+
+    bool IsLinked()const noexcept { return Next != nullptr; }
+
+    void Unlink()noexcept
+    {
+        if (!Next)
+            return;
+        Prev->Next = Next;
+        Next->Prev = Prev;
+        Prev = Next = nullptr;
+    }
+};
+
+/**
+ * @brief 哈希时间轮
+ *
+ * 按Deadline / resolution散列到固定数量的槽中，推进时只访问到期的槽。
+ * 截止时间超出一整圈的节点在经过时重新入槽，因此推进的代价为O(到期节点 + 跨圈节点)。
+ */
+class TimerWheel
+{
+public:
+    /**
+     * @param resolution 槽的时间粒度
+     * @param slotCount 槽的数量
+     * @param now 当前时间
+     */
+    TimerWheel(moe::Time::Tick resolution, size_t slotCount, moe::Time::Tick now)
+        : m_ullResolution(resolution), m_stSlots(slotCount), m_ullCurrentTick(now / resolution)
+    {
+        assert(resolution > 0 && slotCount > 0);
+        for (auto& slot : m_stSlots)
+            slot.Prev = slot.Next = &slot;
+    }
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+public:
+    size_t GetSize()const noexcept { return m_uSize; }
+
+    /**
+     * @brief 调度节点，若节点已在轮上则重新调度
+     */
+    void Schedule(TimerWheelNode* node, moe::Time::Tick deadline)noexcept
+    {
+        Cancel(node);
+
+        // 已经过期的节点放到下一个要处理的槽
+        auto tick = std::max(deadline / m_ullResolution, m_ullCurrentTick);
+        auto& slot = m_stSlots[tick % m_stSlots.size()];
+
+        node->Deadline = deadline;
+        node->Prev = slot.Prev;
+        node->Next = &slot;
+        slot.Prev->Next = node;
+        slot.Prev = node;
+        ++m_uSize;
+    }
+
+    /**
+     * @brief 取消调度
+     */
+    void Cancel(TimerWheelNode* node)noexcept
+    {
+        if (!node->IsLinked())
+            return;
+        node->Unlink();
+        --m_uSize;
+    }
+
+    /**
+     * @brief 推进到指定时间
+     * @param callback 对每个到期节点的回调，回调时节点已从轮上移除，可以在回调中重新调度或销毁
+     */
+    template <typename TCallback>
+    void Advance(moe::Time::Tick now, TCallback&& callback)
+    {
+        auto target = now / m_ullResolution;
+        if (target < m_ullCurrentTick)
+            return;
+
+        // 跨越超过一圈时每个槽只需要处理一次
+        auto steps = std::min<moe::Time::Tick>(target - m_ullCurrentTick + 1, m_stSlots.size());
+        for (moe::Time::Tick i = 0; i < steps; ++i)
+        {
+            auto& slot = m_stSlots[(m_ullCurrentTick + i) % m_stSlots.size()];
+            if (slot.Next == &slot)
+                continue;
+
+            // 先将整个槽摘下，避免回调中重新调度到同一个槽导致死循环
+            TimerWheelNode pending;
+            pending.Prev = slot.Prev;
+            pending.Next = slot.Next;
+            pending.Prev->Next = &pending;
+            pending.Next->Prev = &pending;
+            slot.Prev = slot.Next = &slot;
+
+            while (pending.Next != &pending)
+            {
+                auto node = pending.Next;
+                node->Unlink();
+                --m_uSize;
+
+                if (node->Deadline <= now)
+                    callback(node);
+                else
+                    Reinsert(node, target);
+            }
+        }
+        m_ullCurrentTick = target + 1;
+    }
+
+private:
+    void Reinsert(TimerWheelNode* node, moe::Time::Tick target)noexcept
+    {
+        // 推进过程中m_ullCurrentTick尚未更新，需要基于目标刻度重新散列
+        auto tick = std::max(node->Deadline / m_ullResolution, target + 1);
+        auto& slot = m_stSlots[tick % m_stSlots.size()];
+        node->Prev = slot.Prev;
+        node->Next = &slot;
+        slot.Prev->Next = node;
+        slot.Prev = node;
+        ++m_uSize;
+    }
+
+private:
+    const moe::Time::Tick m_ullResolution;
+    std::vector<TimerWheelNode> m_stSlots;
+    moe::Time::Tick m_ullCurrentTick;  // 下一个要处理的刻度
+    size_t m_uSize = 0;
+};
@@ -0,0 +1,143 @@
+#pragma once
+#ifdef __linux__
+#include <functional>
+#include <memory>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <Moe.Core/Exception.hpp>
+#include <Moe.Core/StringUtils.hpp>
+
+#include "FdWatcher.hpp"
+
+/**
+ * @brief 带内核接收时间戳的UDP socket
+ *
+ * 通过SO_TIMESTAMPNS获取数据报进入协议栈的时间（CLOCK_REALTIME），从而排除事件循环调度带来的接收侧延迟。
+ */
+class TimestampedUdpSocket
+{
+public:
+    using OnDataCallbackType = std::function<void(const sockaddr* from, moe::BytesView data, uint64_t kernelTime)>;
+    using OnErrorCallbackType = std::function<void(int err)>;
+
+public:
+    TimestampedUdpSocket(int family)
+    {
+        m_iFd = ::socket(family, SOCK_DGRAM, 0);
+        if (m_iFd < 0)
+            MOE_THROW(moe::APIException, "socket() failed, errno {0}", errno);
+
+        int on = 1;
+        if (::setsockopt(m_iFd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) != 0)
+        {
+            auto err = errno;
+            ::close(m_iFd);
+            MOE_THROW(moe::APIException, "setsockopt(SO_TIMESTAMPNS) failed, errno {0}", err);
+        }
+        ::fcntl(m_iFd, F_SETFL, ::fcntl(m_iFd, F_GETFL) | O_NONBLOCK);
+
+        m_pWatcher.reset(new FdWatcher(m_iFd));
+        m_pWatcher->SetOnEventCallback([this](int status, int) { OnEvent(status); });
+    }
+
+    TimestampedUdpSocket(const TimestampedUdpSocket&) = delete;
+    TimestampedUdpSocket& operator=(const TimestampedUdpSocket&) = delete;
+
+    ~TimestampedUdpSocket()
+    {
+        m_pWatcher.reset();
+        ::close(m_iFd);
+    }
+
+public:
+    void SetOnDataCallback(const OnDataCallbackType& callback) { m_stOnData = callback; }
+    void SetOnErrorCallback(const OnErrorCallbackType& callback) { m_stOnError = callback; }
+
+    void StartRead()
+    {
+        m_pWatcher->Start(UV_READABLE);
+    }
+
+    /**
+     * @brief 发送数据报
+     * @return 是否成功，发送缓冲满时返回false
+     */
+    bool Send(const sockaddr* addr, socklen_t len, moe::BytesView data)
+    {
+        auto ret = ::sendto(m_iFd, data.GetBuffer(), data.GetSize(), MSG_DONTWAIT, addr, len);
+        if (ret < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && m_stOnError)
+                m_stOnError(errno);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    void OnEvent(int status)
+    {
+        if (status < 0)
+        {
+            if (m_stOnError)
+                m_stOnError(status);
+            return;
+        }
+
+        sockaddr_storage from;
+        iovec iov;
+        iov.iov_base = m_stBuffer;
+        iov.iov_len = sizeof(m_stBuffer);
+
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(timespec))];
+        while (true)
+        {
+            msghdr msg {};
+            msg.msg_name = &from;
+            msg.msg_namelen = sizeof(from);
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+
+            auto ret = ::recvmsg(m_iFd, &msg, MSG_DONTWAIT);
+            if (ret < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && m_stOnError)
+                    m_stOnError(errno);
+                return;
+            }
+
+            uint64_t kernelTime = 0;
+            for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+            {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+                {
+                    timespec ts;
+                    ::memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                    kernelTime = static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+                }
+            }
+
+            if (m_stOnData)
+                m_stOnData(reinterpret_cast<const sockaddr*>(&from), moe::BytesView(m_stBuffer, static_cast<size_t>(ret)),
+                    kernelTime);
+        }
+    }
+
+private:
+    int m_iFd = -1;
+    std::unique_ptr<FdWatcher> m_pWatcher;
+    uint8_t m_stBuffer[2048];
+
+    OnDataCallbackType m_stOnData;
+    OnErrorCallbackType m_stOnError;
+};
+#endif
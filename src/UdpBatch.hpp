@@ -0,0 +1,171 @@
+#pragma once
+#include <vector>
+#include <cstring>
+#include <utility>
+#include <cerrno>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
+
+#ifdef __linux__
+/**
+ * @brief UDP批量收发缓冲
+ *
+ * 预分配N个数据报的缓冲和mmsghdr，一次recvmmsg/sendmmsg处理整批数据报，稳态下不产生任何分配。
+ * 每个槽位同时保存对端地址，因此接收后原地修改长度即可直接用于回射。
+ */
+class UdpBatch
+{
+public:
+    static const size_t kDefaultDatagramSize = 9216;
+
+public:
+    UdpBatch(size_t capacity, size_t datagramSize = kDefaultDatagramSize)
+        : m_uDatagramSize(datagramSize), m_stBuffer(capacity * datagramSize), m_stAddrs(capacity), m_stIovecs(capacity),
+        m_stMessages(capacity)
+    {
+        for (size_t i = 0; i < capacity; ++i)
+        {
+            m_stIovecs[i].iov_base = m_stBuffer.data() + i * datagramSize;
+            m_stIovecs[i].iov_len = datagramSize;
+
+            auto& hdr = m_stMessages[i].msg_hdr;
+            ::memset(&hdr, 0, sizeof(hdr));
+            hdr.msg_name = &m_stAddrs[i];
+            hdr.msg_namelen = sizeof(sockaddr_storage);
+            hdr.msg_iov = &m_stIovecs[i];
+            hdr.msg_iovlen = 1;
+        }
+    }
+
+public:
+    size_t GetCapacity()const noexcept { return m_stMessages.size(); }
+    size_t GetDatagramSize()const noexcept { return m_uDatagramSize; }
+
+    /**
+     * @brief 获取第i个数据报的缓冲区
+     */
+    uint8_t* GetData(size_t i)noexcept { return m_stBuffer.data() + i * m_uDatagramSize; }
+
+    /**
+     * @brief 获取第i个数据报的长度（接收后）
+     */
+    size_t GetLength(size_t i)const noexcept { return m_stMessages[i].msg_len; }
+
+    /**
+     * @brief 设置第i个数据报待发送的长度
+     */
+    void SetLength(size_t i, size_t length)noexcept { m_stIovecs[i].iov_len = length; }
+
+    /**
+     * @brief 获取第i个数据报的对端地址
+     */
+    sockaddr_storage& GetAddress(size_t i)noexcept { return m_stAddrs[i]; }
+
+    /**
+     * @brief 设置第i个数据报的对端地址
+     */
+    void SetAddress(size_t i, const sockaddr* addr, socklen_t len)noexcept
+    {
+        ::memcpy(&m_stAddrs[i], addr, len);
+        m_stMessages[i].msg_hdr.msg_namelen = len;
+    }
+
+    /**
+     * @brief 非阻塞地接收至多GetCapacity()个数据报
+     * @return 接收到的数据报个数，没有数据时返回0，出错返回-1并设置errno
+     */
+    int Recv(int fd)noexcept
+    {
+        for (size_t i = 0; i < m_stMessages.size(); ++i)
+        {
+            // Compact会交换mmsghdr，接收前恢复槽位的对应关系
+            m_stIovecs[i].iov_len = m_uDatagramSize;
+            m_stMessages[i].msg_hdr.msg_name = &m_stAddrs[i];
+            m_stMessages[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+            m_stMessages[i].msg_hdr.msg_iov = &m_stIovecs[i];
+            m_stMessages[i].msg_hdr.msg_flags = 0;
+        }
+
+        auto ret = ::recvmmsg(fd, m_stMessages.data(), static_cast<unsigned>(m_stMessages.size()), MSG_DONTWAIT, nullptr);
+        if (ret < 0)
+            return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+        return ret;
+    }
+
+    /**
+     * @brief 丢弃不回射的数据报，其余数据报按原顺序移到最前
+     * @param keep 前count个数据报是否保留
+     * @return 保留的数据报个数，随后以该值调用Send
+     *
+     * 只交换mmsghdr，数据和地址原地不动。压缩后按槽位编号的访问不再对应发送顺序，直到下一次Recv。
+     */
+    size_t Compact(const bool* keep, size_t count)noexcept
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (!keep[i])
+                continue;
+            if (kept != i)
+                std::swap(m_stMessages[kept], m_stMessages[i]);
+            ++kept;
+        }
+        return kept;
+    }
+
+    /**
+     * @brief 发送前count个数据报
+     * @param onError 对未能发出的数据报的回调，参数为其在本批中的位置和errno
+     * @param sentBytes 非空时累加成功发送的字节数
+     * @return 成功发送的数据报个数
+     *
+     * 发送缓冲已满时剩余的数据报被丢弃，单个数据报发送出错时跳过该数据报（对于探测包这等价于网络丢包）。
+     */
+    template <typename TOnError>
+    size_t Send(int fd, size_t count, TOnError&& onError, uint64_t* sentBytes = nullptr)
+    {
+        size_t index = 0, sent = 0;
+        while (index < count)
+        {
+            auto ret = ::sendmmsg(fd, m_stMessages.data() + index, static_cast<unsigned>(count - index), MSG_DONTWAIT);
+            if (ret < 0)
+            {
+                auto err = errno;
+                if (err == EINTR)
+                    continue;
+                if (err == EAGAIN || err == EWOULDBLOCK)
+                {
+                    for (; index < count; ++index)
+                        onError(index, err);
+                    break;
+                }
+                onError(index++, err);
+                continue;
+            }
+            if (sentBytes)
+            {
+                for (auto i = index; i < index + static_cast<size_t>(ret); ++i)
+                    *sentBytes += m_stMessages[i].msg_len;
+            }
+            index += static_cast<size_t>(ret);
+            sent += static_cast<size_t>(ret);
+        }
+        return sent;
+    }
+
+    size_t Send(int fd, size_t count, uint64_t* sentBytes = nullptr)noexcept
+    {
+        return Send(fd, count, [](size_t, int) {}, sentBytes);
+    }
+
+private:
+    size_t m_uDatagramSize = 0;
+    std::vector<uint8_t> m_stBuffer;
+    std::vector<sockaddr_storage> m_stAddrs;
+    std::vector<iovec> m_stIovecs;
+    std::vector<mmsghdr> m_stMessages;
+};
+#endif
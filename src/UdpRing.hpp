@@ -0,0 +1,597 @@
+#pragma once
+#ifdef HAVE_IO_URING
+#include <memory>
+#include <vector>
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <functional>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <linux/io_uring.h>
+
+#include <Moe.Core/Exception.hpp>
+#include <Moe.UV/RunLoop.hpp>
+
+#include "FdWatcher.hpp"
+
+/**
+ * @brief 基于io_uring的UDP收发引擎
+ *
+ * 接收使用单个多发（multishot）recvmsg请求，数据报直接落入通过IORING_REGISTER_PBUF_RING注册的缓冲环，
+ * 稳态下接收不需要任何系统调用。发送的SQE先在用户态排队，每轮事件循环通过一次io_uring_enter批量提交。
+ * 回射可以直接从接收缓冲发出（Reply），发送完成后缓冲才归还内核。
+ * 完成队列的就绪通过FdWatcher监视ring fd驱动，与同一RunLoop上的其他句柄共存。
+ *
+ * 依赖内核6.0+（多发recvmsg），构造失败时抛出异常，调用方应回退到非io_uring路径。
+ * socket的所有权不转移。必须在所属RunLoop的线程上构造和析构。
+ */
+class UdpRing
+{
+    enum : uint64_t
+    {
+        TAG_RECV = 1,
+        TAG_REPLY = 2,
+        TAG_SEND = 3,
+        TAG_CANCEL = 4,
+    };
+
+    struct MessageSlot
+    {
+        msghdr Header;
+        iovec Iov;
+    };
+
+public:
+    static const size_t kMaxNameSize = sizeof(sockaddr_storage);
+
+    using OnDataCallbackType = std::function<void(uint8_t* data, size_t length, const sockaddr* addr, socklen_t addrLength)>;
+    using OnErrorCallbackType = std::function<void(int err)>;
+
+public:
+    /**
+     * @brief 检查内核是否满足要求
+     */
+    static bool IsSupported()noexcept
+    {
+        utsname name;
+        unsigned major = 0, minor = 0;
+        if (::uname(&name) != 0 || ::sscanf(name.release, "%u.%u", &major, &minor) != 2)
+            return false;
+        return major >= 6;
+    }
+
+    /**
+     * @param fd 已绑定的UDP socket
+     * @param entries SQ深度
+     * @param bufferCount 接收缓冲个数，必须为2的幂
+     * @param datagramSize 单个数据报上限，超过的数据报被截断并丢弃
+     * @param sendSlots 拷贝发送（Send）可同时在途的个数
+     */
+    UdpRing(int fd, uint32_t entries, uint32_t bufferCount, size_t datagramSize, uint32_t sendSlots)
+        : m_iSocket(fd), m_uBufferCount(bufferCount),
+        m_uBufferSize(sizeof(io_uring_recvmsg_out) + kMaxNameSize + datagramSize), m_uDatagramSize(datagramSize)
+    {
+        if (bufferCount == 0 || (bufferCount & (bufferCount - 1)) != 0 || bufferCount > 32768)
+            MOE_THROW(moe::BadArgumentException, "Invalid io_uring buffer count {0}", bufferCount);
+        if (!IsSupported())
+            MOE_THROW(moe::APIException, "io_uring multishot recvmsg requires Linux 6.0+");
+
+        try
+        {
+            SetupRing(entries);
+            SetupBufferRing();
+        }
+        catch (...)
+        {
+            Close();
+            throw;
+        }
+
+        // 接收请求的msghdr只用于告诉内核地址和控制消息的预留长度
+        ::memset(&m_stRecvHeader, 0, sizeof(m_stRecvHeader));
+        m_stRecvHeader.msg_namelen = kMaxNameSize;
+
+        m_stReplySlots.resize(bufferCount);
+        m_stSendSlots.resize(sendSlots);
+        m_stSendBuffer.resize(sendSlots * (kMaxNameSize + datagramSize));
+        m_stFreeSendSlots.reserve(sendSlots);
+        for (uint32_t i = sendSlots; i-- > 0; )
+            m_stFreeSendSlots.push_back(i);
+    }
+
+    UdpRing(const UdpRing&) = delete;
+    UdpRing& operator=(const UdpRing&) = delete;
+
+    ~UdpRing()
+    {
+        if (m_pPrepare)
+        {
+            m_pPrepare->data = nullptr;
+            ::uv_close(reinterpret_cast<uv_handle_t*>(m_pPrepare), [](uv_handle_t* handle) {
+                delete reinterpret_cast<uv_prepare_t*>(handle);
+            });
+        }
+        m_pWatcher.reset();
+        Drain();
+        Close();
+    }
+
+public:
+    void SetOnDataCallback(const OnDataCallbackType& callback) { m_stOnData = callback; }
+    void SetOnErrorCallback(const OnErrorCallbackType& callback) { m_stOnError = callback; }
+
+    size_t GetDatagramSize()const noexcept { return m_uDatagramSize; }
+
+    /**
+     * @brief 累计调用io_uring_enter的次数
+     */
+    uint64_t GetSubmitCount()const noexcept { return m_ullSubmitCount; }
+
+    /**
+     * @brief 累计因截断、SQ满或发送失败而丢弃的数据报数
+     */
+    uint64_t GetDropCount()const noexcept { return m_ullDropCount; }
+
+    /**
+     * @brief 累计发送成功的回射（Reply）个数和字节数，以完成事件为准
+     */
+    uint64_t GetReplyCount()const noexcept { return m_ullReplyCount; }
+    uint64_t GetReplyBytes()const noexcept { return m_ullReplyBytes; }
+
+    /**
+     * @brief 挂起接收并挂接到当前线程的RunLoop
+     *
+     * 不调用Start时也可以手动交替调用Poll和Flush驱动（如基准测试）。
+     */
+    void Start()
+    {
+        m_pWatcher.reset(new FdWatcher(m_iRing));
+        m_pWatcher->SetOnEventCallback([this](int status, int) {
+            if (status < 0)
+            {
+                if (m_stOnError)
+                    m_stOnError(status);
+                return;
+            }
+            Poll();
+            Flush();
+        });
+
+        m_pPrepare = new uv_prepare_t();
+        ::uv_prepare_init(moe::UV::RunLoop::GetCurrentUVLoop(), m_pPrepare);
+        m_pPrepare->data = this;
+
+        if (!m_bRecvArmed)
+            ArmRecv();
+        Flush();
+        m_pWatcher->Start(UV_READABLE);
+        ::uv_prepare_start(m_pPrepare, OnPrepare);
+    }
+
+    /**
+     * @brief 拷贝数据并排队发送
+     * @return 槽位或SQ耗尽时返回false
+     *
+     * 实际提交发生在本轮事件循环结束前，同一轮内的发送共用一次系统调用。
+     */
+    bool Send(const sockaddr* addr, socklen_t addrLength, const uint8_t* data, size_t length)noexcept
+    {
+        if (m_stFreeSendSlots.empty() || length > m_uDatagramSize || addrLength > kMaxNameSize)
+            return false;
+        auto sqe = AcquireSqe();
+        if (!sqe)
+            return false;
+
+        auto index = m_stFreeSendSlots.back();
+        m_stFreeSendSlots.pop_back();
+
+        auto buffer = m_stSendBuffer.data() + index * (kMaxNameSize + m_uDatagramSize);
+        ::memcpy(buffer, addr, addrLength);
+        ::memcpy(buffer + kMaxNameSize, data, length);
+        PrepareSendMsg(sqe, m_stSendSlots[index], buffer, addrLength, buffer + kMaxNameSize, length, TAG_SEND, index);
+        return true;
+    }
+
+    /**
+     * @brief 将当前正在回调的数据报原样发回来源地址
+     * @param length 发送长度，不超过收到的长度
+     * @return SQ耗尽时返回false
+     *
+     * 只能在OnData回调中调用，且每个数据报至多调用一次。缓冲在发送完成后归还。
+     */
+    bool Reply(size_t length)noexcept
+    {
+        if (!m_pCurrent || m_bCurrentHeld)
+            return false;
+        auto sqe = AcquireSqe();
+        if (!sqe)
+            return false;
+
+        PrepareSendMsg(sqe, m_stReplySlots[m_uCurrentBuffer], m_pCurrentName, m_uCurrentNameLength, m_pCurrent, length,
+            TAG_REPLY, m_uCurrentBuffer);
+        m_bCurrentHeld = true;
+        return true;
+    }
+
+    /**
+     * @brief 提交所有排队的SQE
+     */
+    void Flush()noexcept
+    {
+        while (m_uPendingSubmit > 0)
+        {
+            auto ret = static_cast<int>(::syscall(__NR_io_uring_enter, m_iRing, m_uPendingSubmit, 0, 0, nullptr, 0));
+            if (ret < 0)
+            {
+                // EAGAIN/EBUSY：内核暂时无法接收更多请求，留到下一轮
+                if (errno != EINTR)
+                    break;
+                continue;
+            }
+            ++m_ullSubmitCount;
+            m_uPendingSubmit -= static_cast<uint32_t>(ret);
+            if (ret == 0)
+                break;
+        }
+    }
+
+    /**
+     * @brief 处理所有已完成的CQE，必要时重新挂起接收
+     */
+    void Poll()
+    {
+        auto head = *m_pCqHead;
+        while (true)
+        {
+            auto tail = __atomic_load_n(m_pCqTail, __ATOMIC_ACQUIRE);
+            if (head == tail)
+                break;
+            for (; head != tail; ++head)
+            {
+                auto cqe = m_pCqes[head & *m_pCqMask];
+                HandleCompletion(cqe);
+            }
+            __atomic_store_n(m_pCqHead, head, __ATOMIC_RELEASE);
+        }
+
+        // 多发请求被内核终止（如缓冲耗尽）后，待有缓冲归还时重新挂起
+        if (!m_bRecvArmed && m_uFreeBuffers > 0)
+            ArmRecv();
+    }
+
+private:
+    void SetupRing(uint32_t entries)
+    {
+        io_uring_params params;
+        ::memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = std::max(entries, m_uBufferCount) * 2;
+        m_iRing = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (m_iRing < 0)
+            MOE_THROW(moe::APIException, "io_uring_setup failed, errno {0}", errno);
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP))
+            MOE_THROW(moe::APIException, "io_uring kernel features missing");
+
+        m_uRingMapSize = std::max(params.sq_off.array + params.sq_entries * sizeof(uint32_t),
+            params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+        m_pRingMap = ::mmap(nullptr, m_uRingMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_iRing,
+            IORING_OFF_SQ_RING);
+        if (m_pRingMap == MAP_FAILED)
+        {
+            m_pRingMap = nullptr;
+            MOE_THROW(moe::APIException, "mmap io_uring rings failed, errno {0}", errno);
+        }
+
+        m_uSqeMapSize = params.sq_entries * sizeof(io_uring_sqe);
+        auto sqes = ::mmap(nullptr, m_uSqeMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_iRing,
+            IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+            MOE_THROW(moe::APIException, "mmap io_uring sqes failed, errno {0}", errno);
+        m_pSqes = static_cast<io_uring_sqe*>(sqes);
+
+        auto base = static_cast<uint8_t*>(m_pRingMap);
+        m_pSqHead = reinterpret_cast<uint32_t*>(base + params.sq_off.head);
+        m_pSqTail = reinterpret_cast<uint32_t*>(base + params.sq_off.tail);
+        m_pSqMask = reinterpret_cast<uint32_t*>(base + params.sq_off.ring_mask);
+        m_pSqArray = reinterpret_cast<uint32_t*>(base + params.sq_off.array);
+        m_pCqHead = reinterpret_cast<uint32_t*>(base + params.cq_off.head);
+        m_pCqTail = reinterpret_cast<uint32_t*>(base + params.cq_off.tail);
+        m_pCqMask = reinterpret_cast<uint32_t*>(base + params.cq_off.ring_mask);
+        m_pCqes = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+        m_uSqEntries = params.sq_entries;
+    }
+
+    void SetupBufferRing()
+    {
+        m_stBuffers.resize(m_uBufferCount * m_uBufferSize);
+
+        // 缓冲环本身需要页对齐
+        m_uBufRingMapSize = m_uBufferCount * sizeof(io_uring_buf);
+        auto ring = ::mmap(nullptr, m_uBufRingMapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ring == MAP_FAILED)
+            MOE_THROW(moe::APIException, "mmap io_uring buffer ring failed, errno {0}", errno);
+        m_pBufRing = static_cast<io_uring_buf_ring*>(ring);
+
+        io_uring_buf_reg reg;
+        ::memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = reinterpret_cast<uint64_t>(m_pBufRing);
+        reg.ring_entries = m_uBufferCount;
+        reg.bgid = kBufferGroup;
+        if (::syscall(__NR_io_uring_register, m_iRing, IORING_REGISTER_PBUF_RING, &reg, 1) != 0)
+            MOE_THROW(moe::APIException, "io_uring register buffer ring failed, errno {0}", errno);
+
+        for (uint32_t i = 0; i < m_uBufferCount; ++i)
+            RecycleBuffer(static_cast<uint16_t>(i));
+    }
+
+    /**
+     * @brief 取消多发接收并等待所有在途请求结束
+     *
+     * 关闭ring fd后取消是异步的，内核仍可能向接收缓冲写入或从发送缓冲读取，
+     * 因此释放缓冲之前必须收割到接收请求的最后一个CQE（不带IORING_CQE_F_MORE）以及所有发送的CQE。
+     */
+    void Drain()noexcept
+    {
+        if (m_iRing < 0)
+            return;
+
+        // 析构过程中到达的数据报直接归还缓冲
+        m_stOnData = nullptr;
+        m_stOnError = nullptr;
+
+        bool cancelQueued = false;
+        while (m_bRecvArmed || m_uFreeBuffers < m_uBufferCount || m_stFreeSendSlots.size() < m_stSendSlots.size())
+        {
+            if (m_bRecvArmed && !cancelQueued)
+            {
+                auto sqe = AcquireSqe();
+                if (sqe)
+                {
+                    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                    sqe->fd = -1;
+                    sqe->addr = TAG_RECV << 32;
+                    sqe->user_data = TAG_CANCEL << 32;
+                    cancelQueued = true;
+                }
+            }
+            Flush();
+
+            auto ret = ::syscall(__NR_io_uring_enter, m_iRing, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (ret < 0 && errno != EINTR)
+                break;
+
+            auto head = *m_pCqHead;
+            auto tail = __atomic_load_n(m_pCqTail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head)
+                HandleCompletion(m_pCqes[head & *m_pCqMask]);
+            __atomic_store_n(m_pCqHead, head, __ATOMIC_RELEASE);
+        }
+    }
+
+    void Close()noexcept
+    {
+        // 关闭ring fd会取消所有在途请求，缓冲必须先由Drain收回
+        if (m_pBufRing)
+            ::munmap(m_pBufRing, m_uBufRingMapSize);
+        if (m_pSqes)
+            ::munmap(m_pSqes, m_uSqeMapSize);
+        if (m_pRingMap)
+            ::munmap(m_pRingMap, m_uRingMapSize);
+        if (m_iRing >= 0)
+            ::close(m_iRing);
+        m_pBufRing = nullptr;
+        m_pSqes = nullptr;
+        m_pRingMap = nullptr;
+        m_iRing = -1;
+    }
+
+    io_uring_sqe* AcquireSqe()noexcept
+    {
+        auto tail = *m_pSqTail;
+        if (tail - __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE) >= m_uSqEntries)
+        {
+            // SQ已满，先提交再重试一次
+            Flush();
+            if (tail - __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE) >= m_uSqEntries)
+            {
+                ++m_ullDropCount;
+                return nullptr;
+            }
+        }
+
+        auto index = tail & *m_pSqMask;
+        auto sqe = &m_pSqes[index];
+        ::memset(sqe, 0, sizeof(*sqe));
+        m_pSqArray[index] = index;
+        __atomic_store_n(m_pSqTail, tail + 1, __ATOMIC_RELEASE);
+        ++m_uPendingSubmit;
+        return sqe;
+    }
+
+    void PrepareSendMsg(io_uring_sqe* sqe, MessageSlot& slot, void* name, socklen_t nameLength, void* data, size_t length,
+        uint64_t tag, uint32_t index)noexcept
+    {
+        slot.Iov.iov_base = data;
+        slot.Iov.iov_len = length;
+        ::memset(&slot.Header, 0, sizeof(slot.Header));
+        slot.Header.msg_name = name;
+        slot.Header.msg_namelen = nameLength;
+        slot.Header.msg_iov = &slot.Iov;
+        slot.Header.msg_iovlen = 1;
+
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = m_iSocket;
+        sqe->addr = reinterpret_cast<uint64_t>(&slot.Header);
+        sqe->len = 1;
+        sqe->user_data = (tag << 32) | index;
+    }
+
+    void ArmRecv()noexcept
+    {
+        auto sqe = AcquireSqe();
+        if (!sqe)
+            return;
+        sqe->opcode = IORING_OP_RECVMSG;
+        sqe->fd = m_iSocket;
+        sqe->addr = reinterpret_cast<uint64_t>(&m_stRecvHeader);
+        sqe->len = 1;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = kBufferGroup;
+        sqe->user_data = TAG_RECV << 32;
+        m_bRecvArmed = true;
+    }
+
+    void RecycleBuffer(uint16_t bid)noexcept
+    {
+        // 不能使用bufs成员：__DECLARE_FLEX_ARRAY在C++下会引入一个非零大小的空结构体，使数组偏移8字节
+        auto& buf = reinterpret_cast<io_uring_buf*>(m_pBufRing)[m_uBufTail & (m_uBufferCount - 1)];
+        buf.addr = reinterpret_cast<uint64_t>(m_stBuffers.data() + static_cast<size_t>(bid) * m_uBufferSize);
+        buf.len = static_cast<uint32_t>(m_uBufferSize);
+        buf.bid = bid;
+        ++m_uBufTail;
+        __atomic_store_n(&m_pBufRing->tail, m_uBufTail, __ATOMIC_RELEASE);
+        ++m_uFreeBuffers;
+    }
+
+    void HandleCompletion(const io_uring_cqe& cqe)
+    {
+        auto tag = cqe.user_data >> 32;
+        auto index = static_cast<uint32_t>(cqe.user_data);
+        switch (tag)
+        {
+            case TAG_RECV:
+                HandleRecv(cqe);
+                break;
+            case TAG_REPLY:
+                if (cqe.res < 0)
+                {
+                    ++m_ullDropCount;
+                }
+                else
+                {
+                    ++m_ullReplyCount;
+                    m_ullReplyBytes += static_cast<uint64_t>(cqe.res);
+                }
+                RecycleBuffer(static_cast<uint16_t>(index));
+                break;
+            case TAG_SEND:
+                if (cqe.res < 0)
+                    ++m_ullDropCount;
+                m_stFreeSendSlots.push_back(index);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void HandleRecv(const io_uring_cqe& cqe)
+    {
+        if (!(cqe.flags & IORING_CQE_F_MORE))
+            m_bRecvArmed = false;
+        if (cqe.res < 0)
+        {
+            // ENOBUFS时数据报仍留在socket缓冲中，缓冲归还后重新挂起即可
+            if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED && m_stOnError)
+                m_stOnError(cqe.res);
+            return;
+        }
+        if (!(cqe.flags & IORING_CQE_F_BUFFER))
+            return;
+
+        auto bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        --m_uFreeBuffers;
+
+        // 缓冲布局：io_uring_recvmsg_out | 地址（预留kMaxNameSize） | 数据
+        auto buffer = m_stBuffers.data() + static_cast<size_t>(bid) * m_uBufferSize;
+        auto out = reinterpret_cast<const io_uring_recvmsg_out*>(buffer);
+        if ((out->flags & MSG_TRUNC) || out->namelen > kMaxNameSize)
+        {
+            ++m_ullDropCount;
+            RecycleBuffer(bid);
+            return;
+        }
+
+        m_uCurrentBuffer = bid;
+        m_pCurrentName = buffer + sizeof(io_uring_recvmsg_out);
+        m_uCurrentNameLength = out->namelen;
+        m_pCurrent = buffer + sizeof(io_uring_recvmsg_out) + kMaxNameSize;
+        m_bCurrentHeld = false;
+        if (m_stOnData)
+            m_stOnData(m_pCurrent, out->payloadlen, reinterpret_cast<const sockaddr*>(m_pCurrentName), m_uCurrentNameLength);
+        m_pCurrent = nullptr;
+
+        if (!m_bCurrentHeld)
+            RecycleBuffer(bid);
+    }
+
+    static void OnPrepare(uv_prepare_t* handle)
+    {
+        auto self = static_cast<UdpRing*>(handle->data);
+        if (self)
+            self->Flush();
+    }
+
+private:
+    static const uint16_t kBufferGroup = 0;
+
+    const int m_iSocket;
+    const uint32_t m_uBufferCount;
+    const size_t m_uBufferSize;
+    const size_t m_uDatagramSize;
+
+    int m_iRing = -1;
+    void* m_pRingMap = nullptr;
+    size_t m_uRingMapSize = 0;
+    io_uring_sqe* m_pSqes = nullptr;
+    size_t m_uSqeMapSize = 0;
+    uint32_t m_uSqEntries = 0;
+    uint32_t* m_pSqHead = nullptr;
+    uint32_t* m_pSqTail = nullptr;
+    uint32_t* m_pSqMask = nullptr;
+    uint32_t* m_pSqArray = nullptr;
+    uint32_t* m_pCqHead = nullptr;
+    uint32_t* m_pCqTail = nullptr;
+    uint32_t* m_pCqMask = nullptr;
+    io_uring_cqe* m_pCqes = nullptr;
+    uint32_t m_uPendingSubmit = 0;
+
+    // 接收缓冲环
+    io_uring_buf_ring* m_pBufRing = nullptr;
+    size_t m_uBufRingMapSize = 0;
+    uint16_t m_uBufTail = 0;
+    uint32_t m_uFreeBuffers = 0;
+    std::vector<uint8_t> m_stBuffers;
+    msghdr m_stRecvHeader;
+    bool m_bRecvArmed = false;
+
+    // 当前回调中的数据报
+    uint16_t m_uCurrentBuffer = 0;
+    uint8_t* m_pCurrentName = nullptr;
+    socklen_t m_uCurrentNameLength = 0;
+    uint8_t* m_pCurrent = nullptr;
+    bool m_bCurrentHeld = false;
+
+    // 发送
+    std::vector<MessageSlot> m_stReplySlots;  // 与接收缓冲一一对应
+    std::vector<MessageSlot> m_stSendSlots;
+    std::vector<uint8_t> m_stSendBuffer;
+    std::vector<uint32_t> m_stFreeSendSlots;
+
+    uint64_t m_ullSubmitCount = 0;
+    uint64_t m_ullDropCount = 0;
+    uint64_t m_ullReplyCount = 0;
+    uint64_t m_ullReplyBytes = 0;
+
+    OnDataCallbackType m_stOnData;
+    OnErrorCallbackType m_stOnError;
+    std::unique_ptr<FdWatcher> m_pWatcher;
+    uv_prepare_t* m_pPrepare = nullptr;
+};
+#endif